@@ -0,0 +1,152 @@
+#ifndef ADU_SIGNAL_H
+#define ADU_SIGNAL_H
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "cal_base.h"
+#include "ts_generator.h"
+
+/*!
+ * @file adu_signal.h
+ * @brief synthetic MT signal of one channel, generated block by block for the adu_sim streaming simulator
+ */
+
+/*!
+ * \brief The sim_signal struct describes the signal of a channel; noise is given at the output (mV),
+ * tones (sinusoids and power line) in field units (nT for H, mV/km for E) and are passed through the sensor transfer function
+ */
+struct sim_signal {
+  double white = 0.1;                           //!< white noise rms in mV
+  double red = 1.0;                             //!< red noise rms in mV (AR(1), flat below red_corner, 1/f above)
+  double red_corner = 1.0;                      //!< Hz
+  double line_freq = 50.0;                      //!< power line frequency, 0 is off
+  double line_ampl = 0.0;                       //!< amplitude of the power line fundamental
+  size_t line_harmonics = 4;                    //!< odd harmonics 3, 5, 7 ... with amplitude 1 / n, below Nyquist only
+  std::vector<std::pair<double, double>> sines; //!< frequency and amplitude
+  double spike_rate = 0.0;                      //!< spikes per second
+  double spike_ampl = 0.0;                      //!< amplitude of a spike in mV, random sign
+};
+
+/*!
+ * \brief The sim_generator class generates consecutive blocks of a channel; the signal is continuous across blocks
+ */
+class sim_generator {
+public:
+  /*!
+   * \brief sim_generator
+   * \param sig signal description
+   * \param sample_rate Hz
+   * \param seed each channel should have its own seed
+   * \param cal sensor calibration; sensors known by cal_synthetic.h (MFS-06e, MFS-07e, FGS ...) scale and shift the tones; nullptr or E channels: tones as given
+   */
+  sim_generator(const sim_signal &sig, const double &sample_rate, const uint64_t &seed, const std::shared_ptr<calibration> &cal = nullptr) : sig(sig), sample_rate(sample_rate), red_noise(3 * seed), white_noise(3 * seed + 1, 0.0, sig.white), spike_key(3 * seed + 2) {
+    if (sample_rate <= 0.0)
+      throw std::runtime_error("sim_generator: sample rate must be > 0");
+
+    // AR(1): y = a y + b w, with stationary rms = red
+    this->ar_a = std::exp(-2.0 * M_PI * sig.red_corner / sample_rate);
+    this->ar_b = sig.red * std::sqrt(1.0 - this->ar_a * this->ar_a);
+
+    std::vector<std::pair<double, double>> tones(sig.sines);
+    if ((sig.line_freq > 0.0) && (sig.line_ampl != 0.0)) {
+      tones.emplace_back(sig.line_freq, sig.line_ampl);
+      for (size_t h = 1; h <= sig.line_harmonics; ++h) {
+        const double n = double(2 * h + 1);
+        tones.emplace_back(n * sig.line_freq, sig.line_ampl / n);
+      }
+    }
+    std::vector<double> freqs;
+    for (const auto &t : tones) {
+      if ((t.first > 0.0) && (t.first < sample_rate / 2.0)) {
+        freqs.push_back(t.first);
+        this->ampl.push_back(t.second);
+      }
+    }
+    std::vector<std::complex<double>> trf(freqs.size(), std::complex<double>(1.0, 0.0));
+    if ((cal != nullptr) && freqs.size()) {
+      try {
+        calibration tcal(cal->sensor, 0, cal->chopper, CalibrationType::mtx);
+        tcal.gen_cal_sensor(freqs);
+        tcal.set_theo_as_caldata();
+        std::vector<double> f;
+        tcal.get_cplx_cal(f, trf);
+      } catch (...) {
+        // no synthetic model for this sensor (e.g. EFP-06) - the tones are the output
+        trf.assign(freqs.size(), std::complex<double>(1.0, 0.0));
+      }
+    }
+    // a tone is the imaginary part of a rotating phasor: one complex multiplication per sample
+    for (size_t i = 0; i < freqs.size(); ++i) {
+      this->ampl[i] *= std::abs(trf[i]);
+      this->phasor.push_back(std::polar(1.0, std::arg(trf[i])));
+      this->step.push_back(std::polar(1.0, 2.0 * M_PI * freqs[i] / sample_rate));
+    }
+    if (sig.spike_rate > 0.0)
+      this->next_spike = this->spike_gap();
+  }
+
+  /*!
+   * \brief next fills the next block; the size of block is kept
+   */
+  void next(std::vector<double> &block) {
+    this->drive.resize(block.size());
+    this->red_noise.next(this->drive);
+    this->white_noise.next(block);
+    for (size_t i = 0; i < block.size(); ++i) {
+      this->red_state = this->ar_a * this->red_state + this->ar_b * this->drive[i];
+      block[i] += this->red_state;
+    }
+    for (size_t i = 0; i < this->phasor.size(); ++i) {
+      auto z = this->phasor[i];
+      const auto w = this->step[i];
+      const double a = this->ampl[i];
+      for (auto &v : block) {
+        v += a * z.imag();
+        z *= w;
+      }
+      this->phasor[i] = z / std::abs(z); // keep the phasor on the unit circle
+    }
+    if (this->sig.spike_rate > 0.0) {
+      while (this->next_spike < this->pos + block.size()) {
+        block[this->next_spike - this->pos] += (tsgen::uniform(this->spike_key, this->spike_count++) < 0.5 ? -1.0 : 1.0) * this->sig.spike_ampl;
+        this->next_spike += this->spike_gap();
+      }
+    }
+    this->pos += block.size();
+  }
+
+  uint64_t samples() const {
+    return this->pos;
+  }
+
+private:
+  uint64_t spike_gap() {
+    // exponential waiting time, at least one sample
+    const double gap = -std::log(tsgen::uniform(this->spike_key, this->spike_count++)) * this->sample_rate / this->sig.spike_rate;
+    return uint64_t(gap) + 1;
+  }
+
+  sim_signal sig;
+  double sample_rate;
+  tsgen::normal_stream red_noise;   //!< drives the AR(1)
+  tsgen::normal_stream white_noise; //!< white part, sigma is white
+  std::vector<double> drive;        //!< red noise input of a block
+  uint64_t spike_key;               //!< counter based stream for the spikes
+  uint64_t spike_count = 0;         //!< position in that stream
+  double ar_a = 0.0;
+  double ar_b = 0.0;
+  double red_state = 0.0;
+  std::vector<double> ampl;                  //!< output amplitude of the tones
+  std::vector<std::complex<double>> phasor;  //!< actual phase of the tones
+  std::vector<std::complex<double>> step;    //!< phase advance per sample
+  uint64_t pos = 0;                          //!< samples generated
+  uint64_t next_spike = 0;                   //!< sample index of the next spike
+};
+
+#endif // ADU_SIGNAL_H
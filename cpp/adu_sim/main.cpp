@@ -1,22 +1,233 @@
-#include <iostream>
-#include <fstream>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
-#include <complex>
-#include <chrono>
-#include <filesystem>
-#include <algorithm>
-#include <bitset>
-#include <cstddef>
-#include <bitset>
 
+#include "BS_thread_pool.h"
+#include "adu_signal.h"
+#include "atss.h"
+#include "job.h"
+#include "survey.h"
+
+// streaming ADU simulator: appends synthetic MT data to .atss files in real time (or faster); a load source for atss_follow, filter and ptspc
+// ./adu_sim -o /tmp/sim -sys ADU-08e -sr 65536 -dur 600 -speed 1 -line 50 0.5 -sin 8 0.1 -spikes 0.2 50
+// ./adu_sim -o /tmp/sim -sr 524288 -dur 60 -speed 0     (as fast as possible: worst case rate)
+
+namespace fs = std::filesystem;
+
+static std::atomic<bool> stop_sim(false);
+
+static void handle_signal(int) {
+  stop_sim = true;
+}
+
+int main(int argc, char *argv[]) {
+
+  fs::path outdir;
+  std::string system = "ADU-08e";
+  std::string sample_rate = "512";
+  std::string start = "2024-01-01T00:00:00";
+  std::string duration = "60";
+  std::vector<std::string> channel_types;
+  double speed = 1.0;     // 1 real time, 10 ten times faster, 0 as fast as possible
+  double block_sec = 1.0; // seconds per append
+  uint64_t seed = 1;
+  sim_signal sig;
+
+  unsigned l = 1;
+  try {
+    while (argc > 1 && (l < unsigned(argc)) && *argv[l] == '-') {
+      std::string marg(argv[l]);
+      if (marg.compare("-o") == 0) {
+        outdir = std::string(argv[++l]);
+      } else if (marg.compare("-sys") == 0) {
+        system = std::string(argv[++l]);
+      } else if (marg.compare("-sr") == 0) {
+        sample_rate = std::string(argv[++l]);
+      } else if (marg.compare("-start") == 0) {
+        start = std::string(argv[++l]);
+      } else if (marg.compare("-dur") == 0) {
+        duration = std::string(argv[++l]);
+      } else if (marg.compare("-c") == 0) {
+        while ((l + 1 < unsigned(argc)) && (*argv[l + 1] != '-'))
+          channel_types.emplace_back(argv[++l]);
+      } else if (marg.compare("-speed") == 0) {
+        speed = std::stod(std::string(argv[++l]));
+      } else if (marg.compare("-block") == 0) {
+        block_sec = std::stod(std::string(argv[++l]));
+      } else if (marg.compare("-seed") == 0) {
+        seed = std::stoull(std::string(argv[++l]));
+      } else if (marg.compare("-white") == 0) {
+        sig.white = std::stod(std::string(argv[++l]));
+      } else if (marg.compare("-red") == 0) {
+        sig.red = std::stod(std::string(argv[++l]));
+        sig.red_corner = std::stod(std::string(argv[++l]));
+      } else if (marg.compare("-line") == 0) {
+        sig.line_freq = std::stod(std::string(argv[++l]));
+        sig.line_ampl = std::stod(std::string(argv[++l]));
+      } else if (marg.compare("-sin") == 0) {
+        const double f = std::stod(std::string(argv[++l]));
+        sig.sines.emplace_back(f, std::stod(std::string(argv[++l])));
+      } else if (marg.compare("-spikes") == 0) {
+        sig.spike_rate = std::stod(std::string(argv[++l]));
+        sig.spike_ampl = std::stod(std::string(argv[++l]));
+      } else {
+        std::cerr << "\nunrecognized option " << argv[l] << std::endl;
+        return EXIT_FAILURE;
+      }
+      ++l;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    std::cerr << "invalid argument" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (outdir.empty()) {
+    std::cout << "adu_sim -o survey_dir [-sys ADU-08e] [-sr 512] [-start 2024-01-01T00:00:00] [-dur seconds] [-c Ex Ey Hx Hy Hz]" << std::endl;
+    std::cout << "        [-speed 1 (0 = as fast as possible)] [-block 1 (seconds per append)] [-seed 1]" << std::endl;
+    std::cout << "        [-white mV] [-red mV corner_Hz] [-line 50 nT] [-sin f nT ...] [-spikes per_second mV]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (fs::exists(outdir)) {
+    std::cerr << "survey exists, choose a new directory " << outdir << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // ******************************** job ****************************************************************************************
+
+  std::shared_ptr<adu_job> job;
+  try {
+    job = std::make_shared<adu_job>(system);
+    if (channel_types.size())
+      job->set_channel_types(channel_types);
+    if (!job->set_sample_rate(sample_rate) || !job->set_start_time(start) || !job->set_duration("", "", "", duration)) {
+      std::cerr << "invalid sample rate (0 ... 524288 Hz) or duration" << std::endl;
+      return EXIT_FAILURE;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const double sr = job->get_sample_rate();
+  const size_t total = job->get_channels().front()->samples;
+  const size_t block = std::max<size_t>(1, size_t(block_sec * sr));
+
+  // ******************************** create survey, channels and headers *******************************************************
+
+  std::vector<std::shared_ptr<channel>> channels;
+  std::vector<std::unique_ptr<sim_generator>> generators;
+  std::vector<std::ofstream> outfiles;
+  try {
+    auto survey = std::make_shared<survey_d>(outdir, false);
+    auto station = survey->create_station("sim");
+    const ChopperStatus chopper = (sr < 1024.0) ? ChopperStatus::on : ChopperStatus::off;
+
+    // calibration frequencies for the header
+    std::vector<double> cal_frequencies;
+    double act_freq = sr;
+    for (size_t i = 0; i < 16; ++i) {
+      cal_frequencies.push_back(act_freq);
+      act_freq /= 2.0;
+    }
+    std::reverse(cal_frequencies.begin(), cal_frequencies.end());
+
+    atss_header_writer header_writer;
+    for (const auto &ach : job->get_channels()) {
+      channels.emplace_back(std::make_shared<channel>(ach->channel_type, sr));
+      auto &chan = channels.back();
+      chan->set_channel_no(ach->channel_no);
+      chan->set_system(job->get_name());
+      chan->set_serial(999);
+      chan->set_unix_timestamp(job->get_start());
+      if ((ach->channel_type == "Ey") || (ach->channel_type == "Hy"))
+        chan->angle = 90.0;
+      chan->cal = std::make_shared<calibration>(ach->sensor, ach->channel_no + 1, chopper, CalibrationType::mtx);
+      if (ach->channel_type.size() && (ach->channel_type[0] == 'H')) {
+        chan->cal->gen_cal_sensor(cal_frequencies);
+        chan->cal->set_theo_as_caldata();
+      }
+      survey->add_create_run(station, chan);
+      chan->write_header(header_writer);
+      generators.emplace_back(std::make_unique<sim_generator>(sig, sr, seed + ach->channel_no, chan->cal));
+      outfiles.emplace_back(chan->get_atss_filepath(), std::ios::out | std::ios::trunc | std::ios::binary);
+      if (!outfiles.back().is_open()) {
+        std::ostringstream err_str(__func__, std::ios_base::ate);
+        err_str << "::can not create " << chan->get_atss_filepath();
+        throw std::runtime_error(err_str.str());
+      }
+    }
+    header_writer.flush();
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "simulating " << job->get_name() << " " << channels.size() << " channels @ " << sr << " Hz, " << total << " samples";
+  if (speed > 0)
+    std::cout << ", speed " << speed << "x real time" << std::endl;
+  else
+    std::cout << ", as fast as possible" << std::endl;
+  for (const auto &chan : channels)
+    std::cout << "  " << chan->get_atss_filepath().string() << std::endl;
+
+  // ******************************** stream ************************************************************************************
+  // each block: all channels generated and appended in parallel, then wait for the wall clock
 
-int main(int argc, char* argv[])
-{
+  std::signal(SIGINT, handle_signal);
+  std::signal(SIGTERM, handle_signal);
 
+  auto pool = std::make_shared<BS::thread_pool>(std::min<size_t>(channels.size(), std::thread::hardware_concurrency()));
+  std::vector<std::vector<double>> blocks(channels.size());
+  std::atomic<bool> write_error(false);
+  const auto t_start = std::chrono::steady_clock::now();
+  size_t written = 0;
+  size_t late = 0; // blocks we could not deliver in time
+  while ((written < total) && !stop_sim) {
+    const size_t n = std::min(block, total - written);
+    for (size_t i = 0; i < channels.size(); ++i) {
+      pool->detach_task([i, n, &blocks, &generators, &outfiles, &write_error]() {
+        blocks[i].resize(n);
+        generators[i]->next(blocks[i]);
+        outfiles[i].write(reinterpret_cast<const char *>(blocks[i].data()), std::streamsize(n * sizeof(double)));
+        outfiles[i].flush(); // a follower must see complete blocks
+        if (!outfiles[i])
+          write_error = true;
+      });
+    }
+    pool->wait();
+    if (write_error) {
+      std::cerr << "write error, disk full?" << std::endl;
+      return EXIT_FAILURE;
+    }
+    written += n;
+    if (speed > 0) {
+      const auto due = t_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(double(written) / (sr * speed)));
+      if (std::chrono::steady_clock::now() > due)
+        ++late;
+      else
+        std::this_thread::sleep_until(due);
+    }
+  }
+  for (auto &out : outfiles)
+    out.close();
 
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+  const double mb = double(written * channels.size() * sizeof(double)) / (1024.0 * 1024.0);
+  std::cout << "written " << written << " samples per channel, " << mb << " MB in " << elapsed << " s";
+  if (elapsed > 0)
+    std::cout << ", " << mb / elapsed << " MB/s, " << (double(written) / sr) / elapsed << "x real time";
+  std::cout << std::endl;
+  if (late)
+    std::cout << late << " blocks were late - the requested speed is too high for this machine" << std::endl;
 
-    return 0;
+  return EXIT_SUCCESS;
 }
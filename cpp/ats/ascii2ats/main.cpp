@@ -9,7 +9,7 @@
 #include <thread>
 #include <vector>
 
-#include "single_colon_ascii.h"
+#include "ascii_io.h"
 
 // using std::filesystem::directory_iterator;
 namespace fs = std::filesystem;
@@ -141,9 +141,11 @@ int main(int argc, char *argv[]) {
 
   // std::cout << atsh->gen_xmlfilename() << "  " << atsh->get_ats_filename(run) << std::endl;
   std::cout << atsh->get_ats_filename(run) << " " << atsj->measdir() << std::endl;
-  auto ddata = read_single_colon_ascii(infile);
-  atsh->header.samples = ddata.size();
+  auto pool = std::make_shared<BS::thread_pool>();
   try {
+    // first pass counts and gets min / max for the LSB, second pass converts; both parallel on the mapped file
+    ascii_column_reader reader(infile, pool);
+    atsh->header.samples = reader.size();
     if (create_measdir) {
       outdir /= atsj->measdir();
       if (!fs::exists(outdir))
@@ -151,11 +153,15 @@ int main(int argc, char *argv[]) {
       outdir = fs::canonical(outdir);
     }
     atsh->set_new_filename(outdir / atsh->get_ats_filename(run));
-    atsh->calc_lsb_from_dbl_vec_mV(ddata);
+    atsh->calc_lsb_from_min_max_mV(reader.min(), reader.max());
     atsh->write(false); // CHANGE
-    atsh->ats_write_ints_doubles(atsh->header.lsbval, ddata, true);
+    reader.for_each_chunk([&atsh](const std::vector<double> &ddata) {
+      atsh->ats_write_ints_doubles(atsh->header.lsbval, ddata, false);
+    });
+    atsh->close();
   } catch (const std::runtime_error &error) {
     std::cerr << error.what() << std::endl;
+    return EXIT_FAILURE;
   }
 
   return EXIT_SUCCESS;
@@ -1,3 +1,4 @@
+#include "ats_header_scan.h"
 #include "atss.h"
 #include <iostream>
 #include <vector>
@@ -5,6 +6,7 @@
 bool a = false;                                 //!< a all details
 bool c = false;                                 //!< c calibration details
 std::vector<std::shared_ptr<channel>> channels; //!< channels
+std::vector<fs::path> ats_files;                //!< old ats files, header scan only
 
 int main(int argc, char *argv[]) {
   unsigned l = 1;
@@ -28,6 +30,7 @@ int main(int argc, char *argv[]) {
         std::cout << "  -c calibration details" << std::endl;
         std::cout << "  -h, --help" << std::endl;
         std::cout << " files" << std::endl;
+        std::cout << " ats files or directories containing ats files (recursive): headers only, -a for the full header" << std::endl;
         return EXIT_SUCCESS;
       }
 
@@ -42,7 +45,14 @@ int main(int argc, char *argv[]) {
     // all options are here, now get the files
     while ((l < unsigned(argc))) {
       std::string marg(argv[l]);
-      channels.emplace_back(std::make_shared<channel>(marg));
+      if (fs::is_directory(marg)) {
+        auto files = find_ats_files(marg);
+        ats_files.insert(ats_files.end(), files.begin(), files.end());
+      } else if (mstr::ends_with(marg, ".ats") || mstr::ends_with(marg, ".ATS")) {
+        ats_files.emplace_back(marg);
+      } else {
+        channels.emplace_back(std::make_shared<channel>(marg));
+      }
       ++l;
     }
   } catch (const std::runtime_error &error) {
@@ -56,11 +66,29 @@ int main(int argc, char *argv[]) {
     std::cerr << "general error" << std::endl;
     return EXIT_FAILURE;
   }
-  if (!channels.size()) {
+  if (!channels.size() && !ats_files.size()) {
     std::cerr << "no filenames  given" << std::endl;
     return EXIT_FAILURE;
   }
 
+  if (ats_files.size()) {
+    auto pool = std::make_shared<BS::thread_pool>();
+    std::string messages;
+    const auto entries = scan_ats_headers(ats_files, pool, messages);
+    for (const auto &e : entries) {
+      const auto stop = e.start + int64_t(e.duration());
+      std::cout << e.path.string() << " " << e.system_type << " " << e.serial << " C" << int(e.channel_number) << " " << e.channel_type << " " << e.sensor_type << " " << e.sensor_serial << " "
+                << mstr::sample_rate_to_str_simple(e.sample_rate) << " " << mstr::iso8601_time_t(e.start, 1) << " " << mstr::iso8601_time_t(e.start, 2) << " <--> " << mstr::iso8601_time_t(stop, 1) << " "
+                << mstr::iso8601_time_t(stop, 2) << "  " << e.samples << std::endl;
+      if (a)
+        std::cout << std::setw(2) << e.json()->header << std::endl;
+    }
+    for (const auto &str : mstr::split(messages, ';')) {
+      if (str.size())
+        std::cerr << str << std::endl;
+    }
+  }
+
   for (const auto &chan : channels) {
     std::cout << chan->get_run_dir() << " " << chan->filename() << " " << chan->start_datetime(1) << " " << chan->start_datetime(2) << " <--> " << chan->stop_datetime(1) << " " << chan->stop_datetime(2)
               << "  " << chan->samples() << std::endl;
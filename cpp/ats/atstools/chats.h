@@ -5,11 +5,13 @@
 #include <vector>
 
 #include "atsheader.h"
+#include "profiler.h"
 
 void chats_files(std::shared_ptr<atsheader> &atsh, std::shared_ptr<atsheader> &adu08, const std::shared_ptr<ats_header_json> &atsj,
                  const size_t &adu06_shift_samples_hf, const size_t &adu06_shift_samples_lf) {
 
   std::cout << adu08->path() << std::endl;
+  mtprof::scoped_timer prof("chats", mtprof::enabled() ? adu08->path().filename().string() : std::string());
 
   adu08->write(false);
   // now read the data, do no conversion
@@ -55,6 +57,8 @@ void chats_files(std::shared_ptr<atsheader> &atsh, std::shared_ptr<atsheader> &a
     // update samples!
     adu08->header.samples = int32_t(samples_read);
     adu08->re_write();
+    prof.arg("samples", double(samples_read));
+    mtprof::count("read bytes", double(samples_read * sizeof(int32_t)));
   } catch (const std::runtime_error &error) {
     std::cerr << error.what() << std::endl;
     std::cerr << "could not chats / create ats files" << std::endl;
@@ -16,9 +16,11 @@ namespace fs = std::filesystem;
 
 #include "xml_from_ats.h"
 
+#include "ats_header_scan.h"
 #include "atsheader.h"
 #include "atsheader_def.h"
 #include "cal_base.h"
+#include "profiler.h"
 #include "read_cal.h"
 
 #include "adu06_fname.h"
@@ -79,6 +81,7 @@ int main(int argc, char *argv[]) {
 
   bool clone = false;
   fs::path outdir;
+  fs::path profile_file; //!< Chrome trace of the conversion, empty: no profiling
 
   // to be implemented
   std::string default_e_sensor; //!< E Sensor is not detected by default use a string like EFP-06
@@ -163,6 +166,11 @@ int main(int argc, char *argv[]) {
       extend_cal = true;
     }
 
+    if (marg.compare("-profile") == 0) {
+      profile_file = std::string(argv[++l]);
+      mtprof::enable();
+    }
+
     if (marg.compare("-outdir") == 0) {
       outdir = std::string(argv[++l]);
       try {
@@ -214,6 +222,8 @@ int main(int argc, char *argv[]) {
       std::cout << "-extend_cal : extend calibration to lower frequencies if possible" << std::endl;
       std::cout << "  some users do not want to care of the theoretical calibration (or can not implement)" << std::endl;
 
+      std::cout << "-profile trace.json : time per file for -cat, -chats and -tojson; summary table and Chrome trace file" << std::endl;
+
       std::cout << " " << std::endl;
       std::cout << " " << std::endl;
     }
@@ -276,15 +286,26 @@ int main(int argc, char *argv[]) {
     return EXIT_SUCCESS;
   }
 
+  // summary and Chrome trace, see -profile
+  auto report_profile = [&profile_file]() {
+    if (profile_file.empty())
+      return;
+    mtprof::summary(std::cout);
+    if (!mtprof::write_chrome_trace(profile_file))
+      std::cerr << "could not write " << profile_file << std::endl;
+  };
+
   auto pool = std::make_shared<BS::thread_pool>();
 
+  // headers only: first 1024 bytes of each file, read in parallel
+  std::vector<fs::path> ats_files;
   if (!clone) {
     l = 1;
     while (argc > 1 && (l < unsigned(argc))) {
       std::string marg(argv[l]);
       if (mstr::ends_with(marg, ".ats") || mstr::ends_with(marg, ".ATS")) {
         if ((marg.compare(marg.size() - 4, 4, ".ats") == 0) || (marg.compare(marg.size() - 4, 4, ".ATS") == 0)) {
-          atsheaders.emplace_back(std::make_shared<atsheader>(fs::path(marg)));
+          ats_files.emplace_back(fs::path(marg));
         }
       }
       ++l;
@@ -305,16 +326,17 @@ int main(int argc, char *argv[]) {
       std::cerr << "clone needs a survey directory as last argument" << std::endl;
       return EXIT_FAILURE;
     }
+    ats_files = find_ats_files(clone_dir);
+  }
 
-    std::string extension_lower = ".ats";
-    std::string extension_upper = ".ATS";
-    for (auto const &dir_entry : fs::recursive_directory_iterator(clone_dir)) {
-
-      // std::cout << dir_entry << '\n';
-      if (dir_entry.is_regular_file() && ((dir_entry.path().extension() == extension_lower) || (dir_entry.path().extension() == extension_upper))) {
-        // file_names.push_back( entry.path().string() ) ;
-        atsheaders.emplace_back(std::make_shared<atsheader>(dir_entry.path()));
-      }
+  {
+    std::string messages;
+    for (const auto &entry : scan_ats_headers(ats_files, pool, messages)) {
+      atsheaders.emplace_back(entry.to_atsheader());
+    }
+    for (const auto &str : mstr::split(messages, ';')) {
+      if (str.size())
+        std::cerr << str << std::endl;
     }
   }
 
@@ -440,6 +462,7 @@ int main(int argc, char *argv[]) {
 
     // this function will sort the ats channel files in order to get C00 ... C99
     xml_from_ats(exec_path, xmls_and_files, calibs);
+    report_profile();
     return EXIT_SUCCESS;
   }
 
@@ -684,6 +707,7 @@ int main(int argc, char *argv[]) {
     remove_cal_duplicates(xxcal);
 
     xml_from_ats(exec_path, xmls_and_files, xxcal);
+    report_profile();
     return EXIT_SUCCESS;
   }
 
@@ -800,17 +824,25 @@ int main(int argc, char *argv[]) {
 
     std::cout << "test for extended calibration" << std::endl;
     if (extend_cal) {
+      atss_header_writer header_writer;
       for (const auto &ch : vch) {
         if (!ch->cal->is_empty() && extend_cal) {
           std::cout << ch->cal->sensor << " " << ch->cal->f.at(0) << " " << ch->cal->f.size() << " -> ";
           ch->cal->auto_extend_for_mth5();
           std::cout << ch->cal->f.size() << std::endl;
           // write the channel header again
-          ch->write_header();
+          ch->write_header(header_writer);
         }
       }
+      try {
+        header_writer.flush();
+      } catch (const std::runtime_error &error) {
+        std::cerr << error.what() << std::endl;
+        return EXIT_FAILURE;
+      }
     }
 
+    report_profile();
     return EXIT_SUCCESS;
   }
 
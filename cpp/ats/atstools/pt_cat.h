@@ -15,6 +15,7 @@
 #include "atmheader.h"
 #include "atsheader.h"
 #include "atsheader_def.h"
+#include "profiler.h"
 
 void cat_ats_files(const std::vector<std::shared_ptr<atsheader>> &ats, const std::filesystem::path &outdir_base, std::multimap<std::string, std::filesystem::path> &xmls_and_files, std::vector<std::filesystem::path> &xml_files,
                    std::mutex &mtx_dir, std::mutex &mtx_xml, std::mutex &mtx_xml_files) {
@@ -42,6 +43,7 @@ void cat_ats_files(const std::vector<std::shared_ptr<atsheader>> &ats, const std
     // std::cout <<  ats.at(i)->path().filename() << " add samples: " << dt << " " <<  ats.at(i+1)->path().filename() << std::endl;
 
     try {
+      mtprof::scoped_timer prof("cat_ats", mtprof::enabled() ? ats[0]->path().filename().string() : std::string());
       size_t chunk_size = 524288;
       std::vector<int32_t> ints(chunk_size);
       size_t samples_read = 0;
@@ -128,6 +130,9 @@ void cat_ats_files(const std::vector<std::shared_ptr<atsheader>> &ats, const std
       // std::cout << "total samples: " << out->header.samples << " " << atm->header.samples << std::endl;
       // update header with new samples AND new xml file
       out->re_write();
+      prof.arg("files", double(ats.size()));
+      prof.arg("samples", double(samples_read));
+      mtprof::count("read bytes", double(samples_read * sizeof(int32_t)));
       // pupolate a multimap with the NEW ats file and NEW XML file
 
       try {
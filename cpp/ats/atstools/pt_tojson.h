@@ -23,7 +23,8 @@
 
 void collect_atsheaders(const std::shared_ptr<atsheader> &ats, std::unique_ptr<survey_d> &survey, const int64_t &shift_start_time = 0) {
 
-  ats->read(); // get the binary data from the header; keep file open
+  if (!ats->has_header())
+    ats->read(); // get the binary data from the header; keep file open
   auto atsj = std::make_shared<ats_header_json>(ats->header, ats->path());
   atsj->get_ats_header(); // fill the json
   // atsj->header["sensor_type"].get<std::string>())
@@ -120,6 +121,7 @@ void fill_survey_tree(const std::unique_ptr<survey_d> &survey, const size_t &ind
   if (!samples)
     return;
   double lsb = chan->tmp_lsb;
+  mtprof::scoped_timer prof("ats_to_atss", chan->prof_name());
   std::filesystem::path meta_run;
   try {
     chan->write_header();
@@ -170,6 +172,9 @@ void fill_survey_tree(const std::unique_ptr<survey_d> &survey, const size_t &ind
       chan->write_data(dbls);
     } while (dbls.size() && chan->outfile_is_good());
     chan->close_outfile();
+    prof.arg("samples", double(samples_read));
+    mtprof::count("read bytes", double(samples_read * sizeof(int32_t)));
+    mtprof::count("write bytes", double(samples_read * sizeof(double)));
 
     std::cout << chan->filename(".json") << "  " << samples_read << " <-> " << chan->samples() << std::endl;
   } catch (const std::runtime_error &error) {
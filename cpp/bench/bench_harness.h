@@ -0,0 +1,224 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "json.h"
+
+/*!
+ * @file bench_harness.h
+ * @brief minimal timing harness for the mth_bench target: repetitions, statistics and JSON output for regression tracking
+ *
+ * Each benchmark has an untimed setup (restore input, clear output) and a timed body.
+ * One warm up run is discarded; then the body runs at least min_reps times and until min_time seconds have been spent.
+ */
+
+namespace mtbench {
+
+using jsn = nlohmann::ordered_json;
+
+/*!
+ * \brief The result struct holds the statistics of one benchmark in nanoseconds per body call
+ */
+struct result {
+  std::string name;        //!< e.g. fftw_execute/1024
+  jsn params;              //!< parameters of the run, e.g. wl, samples
+  size_t reps = 0;         //!< timed repetitions
+  double min_ns = 0.0;     //!< fastest repetition
+  double median_ns = 0.0;  //!< median repetition - use this for regression tracking
+  double mean_ns = 0.0;    //!< mean
+  double stddev_ns = 0.0;  //!< standard deviation
+  double items = 0.0;      //!< items (samples, windows, frequencies) processed per body call
+  double bytes = 0.0;      //!< bytes processed per body call, 0 if not meaningful
+  std::string skipped;     //!< reason if the benchmark could not run
+
+  double items_per_second() const {
+    return (this->median_ns > 0.0) ? this->items * 1.0E9 / this->median_ns : 0.0;
+  }
+
+  double bytes_per_second() const {
+    return (this->median_ns > 0.0) ? this->bytes * 1.0E9 / this->median_ns : 0.0;
+  }
+
+  jsn to_json() const {
+    jsn j;
+    j["name"] = this->name;
+    j["params"] = this->params;
+    if (this->skipped.size()) {
+      j["skipped"] = this->skipped;
+      return j;
+    }
+    j["repetitions"] = this->reps;
+    j["min_ns"] = this->min_ns;
+    j["median_ns"] = this->median_ns;
+    j["mean_ns"] = this->mean_ns;
+    j["stddev_ns"] = this->stddev_ns;
+    j["items"] = this->items;
+    j["items_per_second"] = this->items_per_second();
+    if (this->bytes > 0.0) {
+      j["bytes"] = this->bytes;
+      j["bytes_per_second"] = this->bytes_per_second();
+    }
+    return j;
+  }
+};
+
+/*!
+ * \brief The harness class runs and collects benchmarks
+ */
+class harness {
+public:
+  /*!
+   * \brief harness
+   * \param min_reps minimum timed repetitions
+   * \param min_time minimum seconds of timed repetitions (the larger of both wins)
+   * \param filter run only benchmarks whose name contains filter; empty: all
+   */
+  harness(const size_t &min_reps = 5, const double &min_time = 0.5, const std::string &filter = "") : min_reps(std::max<size_t>(1, min_reps)), min_time(min_time), filter(filter) {
+  }
+
+  bool enabled(const std::string &name) const {
+    return this->filter.empty() || (name.find(this->filter) != std::string::npos);
+  }
+
+  /*!
+   * \brief run times body; setup is called before each call of body and is not timed
+   * \param name unique name, use name/parameter for series
+   * \param params any json, stored with the result
+   * \param items processed per body call
+   * \param bytes processed per body call
+   */
+  template <class Setup, class Body>
+  void run(const std::string &name, const jsn &params, const double &items, const double &bytes, Setup &&setup, Body &&body) {
+    if (!this->enabled(name))
+      return;
+    result res;
+    res.name = name;
+    res.params = params;
+    res.items = items;
+    res.bytes = bytes;
+
+    setup();
+    body(); // warm up: caches, page cache, lazy allocations
+
+    std::vector<double> times;
+    double total = 0.0;
+    while ((times.size() < this->min_reps) || (total < this->min_time)) {
+      setup();
+      const auto t0 = std::chrono::steady_clock::now();
+      body();
+      const auto t1 = std::chrono::steady_clock::now();
+      times.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+      total += times.back() * 1.0E-9;
+      if (times.size() >= max_reps)
+        break;
+    }
+
+    std::sort(times.begin(), times.end());
+    const size_t n = times.size();
+    res.reps = n;
+    res.min_ns = times.front();
+    res.median_ns = (n % 2) ? times[n / 2] : 0.5 * (times[n / 2 - 1] + times[n / 2]);
+    res.mean_ns = std::accumulate(times.begin(), times.end(), 0.0) / double(n);
+    double var = 0.0;
+    for (const auto &t : times)
+      var += (t - res.mean_ns) * (t - res.mean_ns);
+    res.stddev_ns = (n > 1) ? std::sqrt(var / double(n - 1)) : 0.0;
+
+    this->print(res);
+    this->results.push_back(res);
+  }
+
+  /*!
+   * \brief run without setup
+   */
+  template <class Body>
+  void run(const std::string &name, const jsn &params, const double &items, const double &bytes, Body &&body) {
+    this->run(name, params, items, bytes, []() {}, std::forward<Body>(body));
+  }
+
+  /*!
+   * \brief skip records a benchmark which could not run, e.g. missing filter database
+   */
+  void skip(const std::string &name, const jsn &params, const std::string &reason) {
+    if (!this->enabled(name))
+      return;
+    result res;
+    res.name = name;
+    res.params = params;
+    res.skipped = reason;
+    std::cerr << std::left << std::setw(32) << name << " skipped: " << reason << std::endl;
+    this->results.push_back(res);
+  }
+
+  /*!
+   * \brief to_json context (build and machine) and all results
+   * \param context additional context, e.g. the data set
+   */
+  jsn to_json(const jsn &context) const {
+    jsn j;
+    j["context"] = context;
+    char datetime[32];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(datetime, sizeof(datetime), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    j["context"]["date"] = std::string(datetime);
+    j["context"]["threads"] = std::thread::hardware_concurrency();
+#if defined(__clang__)
+    j["context"]["compiler"] = std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+    j["context"]["compiler"] = std::string("gcc ") + __VERSION__;
+#elif defined(_MSC_VER)
+    j["context"]["compiler"] = "msvc " + std::to_string(_MSC_VER);
+#endif
+#ifdef NDEBUG
+    j["context"]["build_type"] = "release";
+#else
+    j["context"]["build_type"] = "debug";
+#endif
+    j["context"]["min_reps"] = this->min_reps;
+    j["context"]["min_time_s"] = this->min_time;
+    j["benchmarks"] = jsn::array();
+    for (const auto &res : this->results)
+      j["benchmarks"].push_back(res.to_json());
+    return j;
+  }
+
+  std::vector<result> results;
+
+private:
+  void print(const result &res) const {
+    std::cerr << std::left << std::setw(32) << res.name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(14) << res.median_ns * 1.0E-6 << " ms"
+              << std::setw(12) << res.items_per_second() * 1.0E-6 << " M items/s";
+    if (res.bytes > 0.0)
+      std::cerr << std::setw(12) << res.bytes_per_second() / (1024.0 * 1024.0) << " MB/s";
+    std::cerr << "  (" << res.reps << " reps)" << std::defaultfloat << std::endl;
+  }
+
+  static constexpr size_t max_reps = 1000; //!< stop for very fast bodies
+  size_t min_reps;
+  double min_time;
+  std::string filter;
+};
+
+inline volatile double sink = 0.0; //!< target of do_not_optimize; namespace scope, so no set-but-unused warning
+
+/*!
+ * \brief do_not_optimize keeps a result alive, so the compiler can not remove the computation; portable, also for MSVC (no inline asm)
+ */
+inline void do_not_optimize(const double &value) {
+  sink = value;
+}
+
+} // namespace mtbench
+
+#endif // BENCH_HARNESS_H
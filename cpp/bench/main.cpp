@@ -0,0 +1,430 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <fftw3.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BS_thread_pool.h"
+#include "atss.h"
+#include "bench_harness.h"
+#include "fir_filter.h"
+#include "freqs.h"
+#include "math_vector.h"
+#include "raw_spectra.h"
+#include "resampler.h"
+#include "spsc_ring.h"
+#include "survey.h"
+#include "ts_generator.h"
+#include "vector_math.h"
+
+// benchmark suite of the processing chain: I/O -> FFT -> calibration -> stack -> parzen, plus fir filter, resampler and akima
+// data are generated (gaussian noise and a sine), written as survey into a temporary directory and removed at the end
+// results: table on stderr, JSON file for regression tracking on the build servers
+// ./mth_bench -samples 4194304 -wl 256 1024 4096 16384 -o bench_$(git describe).json
+// ./mth_bench -filter fftw_execute -reps 20
+
+namespace fs = std::filesystem;
+
+int main(int argc, char *argv[]) {
+
+  size_t samples = 4194304;
+  double sample_rate = 1024.0;
+  std::vector<size_t> wls;
+  size_t min_reps = 5;
+  double min_time = 0.5;
+  double fraction = 0.5; // advanced stack, fraction of the median range
+  size_t akima_points = 0;
+  size_t threads = 0;
+  std::string filter;
+  fs::path json_file("mth_bench.json");
+  fs::path tmp_dir;
+  bool keep = false;
+
+  unsigned l = 1;
+  try {
+    while (argc > 1 && (l < unsigned(argc)) && *argv[l] == '-') {
+      std::string marg(argv[l]);
+      if (marg.compare("-samples") == 0) {
+        samples = std::stoull(std::string(argv[++l]));
+      } else if (marg.compare("-sr") == 0) {
+        sample_rate = std::stod(std::string(argv[++l]));
+      } else if (marg.compare("-wl") == 0) {
+        while ((l + 1 < unsigned(argc)) && (*argv[l + 1] != '-'))
+          wls.push_back(std::stoull(std::string(argv[++l])));
+      } else if (marg.compare("-reps") == 0) {
+        min_reps = std::stoull(std::string(argv[++l]));
+      } else if (marg.compare("-min_time") == 0) {
+        min_time = std::stod(std::string(argv[++l]));
+      } else if (marg.compare("-fraction") == 0) {
+        fraction = std::stod(std::string(argv[++l]));
+      } else if (marg.compare("-akima") == 0) {
+        akima_points = std::stoull(std::string(argv[++l]));
+      } else if (marg.compare("-threads") == 0) {
+        threads = std::stoull(std::string(argv[++l]));
+      } else if (marg.compare("-filter") == 0) {
+        filter = std::string(argv[++l]);
+      } else if (marg.compare("-o") == 0) {
+        json_file = std::string(argv[++l]);
+      } else if (marg.compare("-tmp") == 0) {
+        tmp_dir = std::string(argv[++l]);
+      } else if (marg.compare("-keep") == 0) {
+        keep = true;
+      } else if (marg.compare("-h") == 0) {
+        std::cout << "mth_bench [-samples 4194304] [-sr 1024] [-wl 256 1024 4096 16384] [-reps 5] [-min_time 0.5] [-fraction 0.5]" << std::endl;
+        std::cout << "          [-akima points] [-threads n] [-filter name_part] [-o mth_bench.json] [-tmp dir] [-keep]" << std::endl;
+        return EXIT_SUCCESS;
+      } else {
+        std::cerr << "\nunrecognized option " << argv[l] << std::endl;
+        return EXIT_FAILURE;
+      }
+      ++l;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    std::cerr << "invalid argument" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!wls.size())
+    wls = {256, 1024, 4096, 16384};
+  std::sort(wls.begin(), wls.end());
+  if (samples < 2 * wls.back()) {
+    std::cerr << "samples must be at least twice the largest window length " << wls.back() << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (tmp_dir.empty())
+    tmp_dir = fs::temp_directory_path() / ("mth_bench_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+  if (fs::exists(tmp_dir)) {
+    std::cerr << "temporary directory exists, choose a new one " << tmp_dir << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto pool = std::make_shared<BS::thread_pool>(threads ? threads : std::thread::hardware_concurrency());
+  mtbench::harness bench(min_reps, min_time, filter);
+  const std::vector<std::string> channel_types = {"Hx", "Hy", "Hz"};
+  std::vector<std::shared_ptr<channel>> channels;
+  std::vector<double> data(samples);
+
+  // ******************************** generate data *******************************************************************************
+
+  try {
+    auto survey = std::make_shared<survey_d>(tmp_dir, false);
+    auto station = survey->create_station("bench");
+    atss_header_writer header_writer;
+    for (size_t i = 0; i < channel_types.size(); ++i) {
+      channels.emplace_back(std::make_shared<channel>(channel_types[i], sample_rate));
+      auto &chan = channels.back();
+      chan->set_channel_no(i);
+      chan->set_system("ADU-08e");
+      chan->set_serial(999);
+      chan->set_unix_timestamp(mstr::time_t_iso_8601_str("2024-01-01T00:00:00"));
+      if (channel_types[i] == "Hy")
+        chan->angle = 90.0;
+      if (channel_types[i] == "Hz")
+        chan->tilt = 90.0;
+      chan->cal = std::make_shared<calibration>("MFS-06e", i + 1, ChopperStatus::off, CalibrationType::mtx);
+      survey->add_create_run(station, chan);
+      chan->write_header(header_writer);
+      tsgen::fill_normal(data, 0.0, 1.0, i + 1, pool);
+      tsgen::add_sine(data, sample_rate / 128.0, sample_rate, 0.5, 0.0, pool);
+      chan->write_all_data(data);
+    }
+    header_writer.flush();
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cerr << "data: " << channels.size() << " channels, " << samples << " samples @ " << sample_rate << " Hz in " << tmp_dir.string() << std::endl;
+
+  mtbench::jsn context;
+  context["samples"] = samples;
+  context["sample_rate"] = sample_rate;
+  context["channels"] = channels.size();
+  context["pool_threads"] = pool->get_thread_count();
+
+  try {
+
+    // ******************************** I/O ***************************************************************************************
+
+    const mtbench::jsn p_io = {{"samples", samples}};
+    bench.run("read_bin", p_io, double(samples), double(samples * sizeof(double)), [&]() {
+      const auto &ts = channels.front()->read_all_at_once();
+      mtbench::do_not_optimize(ts.back());
+    });
+
+    // ******************************** per window length *************************************************************************
+
+    for (const auto &wl : wls) {
+      const size_t windows = samples / wl;
+      const std::string swl = "/" + std::to_string(wl);
+      const mtbench::jsn p = {{"wl", wl}, {"windows", windows}, {"samples", samples}};
+
+      // fresh channels: each wl has its own plans and spectra
+      std::vector<std::shared_ptr<channel>> chans;
+      for (const auto &base : channels)
+        chans.emplace_back(std::make_shared<channel>(base));
+      chans.front()->init_fftw(nullptr, false, wl, wl);
+      for (size_t i = 1; i < chans.size(); ++i)
+        chans[i]->init_fftw(chans.front()->fft_freqs);
+      for (auto &chan : chans) {
+        chan->cal->gen_cal_sensor(chan->fft_freqs->get_frequencies());
+        chan->cal->set_theo_as_caldata();
+      }
+
+      // detrend and hanning of all windows of one channel; the input is restored untimed
+      std::vector<double> ts(data.begin(), data.begin() + windows * wl);
+      const auto restore_ts = [&]() { std::copy(data.begin(), data.begin() + windows * wl, ts.begin()); };
+      bench.run("detrend_and_hanning" + swl, p, double(windows * wl), double(windows * wl * sizeof(double)), restore_ts, [&]() {
+        for (size_t w = 0; w < windows; ++w)
+          detrend_and_hanning<double>(ts.begin() + w * wl, ts.begin() + (w + 1) * wl);
+        mtbench::do_not_optimize(ts.back());
+      });
+
+      // plain transforms, same input
+      auto &fchan = chans.front();
+      std::copy(data.begin(), data.begin() + wl, fchan->ts_slice.begin());
+      bench.run("fftw_execute" + swl, p, double(windows), 0.0, [&]() {
+        for (size_t w = 0; w < windows; ++w)
+          fftw_execute(fchan->plan);
+        mtbench::do_not_optimize(fchan->spc_slice.back().real());
+      });
+
+      // window handoff between two threads as in run_d::stack_online_pipelined; copy in, read out - no processing
+      bench.run("spsc_ring_handoff" + swl, p, double(windows), double(windows * wl * sizeof(double)), [&]() {
+        spsc_ring<std::vector<double>> ring(64, [wl](std::vector<double> &v) { v.resize(wl); });
+        std::thread producer([&]() {
+          size_t w = 0;
+          while (w < windows) {
+            const size_t n = ring.acquire(std::min<size_t>(16, windows - w));
+            for (size_t j = 0; j < n; ++j, ++w)
+              std::copy(data.begin() + w * wl, data.begin() + (w + 1) * wl, ring.write_slot(j).begin());
+            ring.publish(n);
+          }
+          ring.close();
+        });
+        double sum = 0.0;
+        while (const size_t n = ring.fetch(16)) {
+          for (size_t j = 0; j < n; ++j)
+            sum += ring.read_slot(j).back();
+          ring.release(n);
+        }
+        producer.join();
+        mtbench::do_not_optimize(sum);
+      });
+
+      // read, detrend, hanning and transform of all channels in parallel - as in the processing
+      // the end of file empties ts_slice; the capacity is kept, so the plan stays valid
+      const auto restore_slice = [&]() {
+        for (auto &chan : chans)
+          chan->ts_slice.resize(wl);
+      };
+      bench.run("read_all_fftw" + swl, p, double(windows * chans.size()), double(windows * wl * chans.size() * sizeof(double)), restore_slice, [&]() {
+        for (auto &chan : chans)
+          pool->detach_task([&chan]() { chan->read_all_fftw(false, nullptr); });
+        pool->wait();
+      });
+
+      // trim, calibrate and scale; the queues are restored untimed
+      std::vector<std::queue<std::vector<std::complex<double>>>> qspcs;
+      for (const auto &chan : chans)
+        qspcs.push_back(chan->qspc);
+      const auto restore_qspc = [&]() {
+        for (size_t i = 0; i < chans.size(); ++i) {
+          chans[i]->spc.clear();
+          chans[i]->qspc = qspcs[i];
+        }
+      };
+      bench.run("prepare_raw_spc" + swl, p, double(windows * chans.size()), 0.0, restore_qspc, [&]() {
+        for (auto &chan : chans)
+          pool->detach_task([&chan]() { chan->prepare_raw_spc(true, true); });
+        pool->wait();
+      });
+      qspcs.clear();
+
+      // stack all auto and cross spectra
+      auto raw = std::make_shared<raw_spectra>(pool, chans);
+      for (auto &chan : chans)
+        raw->move_raw_spectra(chan);
+      size_t pairs = 0;
+      for (size_t i = 0; i < chans.size(); ++i) {
+        for (size_t j = i; j < chans.size(); ++j) {
+          const auto ac = std::make_pair(chans[i]->channel_type, chans[j]->channel_type);
+          raw->sa.add_spectra(ac);
+          raw->sa_prz.add_spectra(ac);
+          ++pairs;
+        }
+      }
+      mtbench::jsn ps(p);
+      ps["pairs"] = pairs;
+      ps["fraction"] = fraction;
+      bench.run("advanced_stack_all" + swl, ps, double(windows * pairs), 0.0, [&]() {
+        raw->advanced_stack_all(fraction);
+        pool->wait();
+      });
+
+      // parzen: 8 target frequencies per decade, starting where the radius covers some lines
+      auto fft_freqs = chans.front()->fft_freqs;
+      const auto freqs = fft_freqs->get_frequencies();
+      std::vector<double> targets;
+      for (double f = std::max(freqs.front(), 16.0 * (freqs.at(1) - freqs.at(0))); f < freqs.back() / 2.0; f *= std::pow(10.0, 1.0 / 8.0))
+        targets.push_back(f);
+      fft_freqs->set_target_freqs(targets, 0.15);
+      mtbench::jsn pp(p);
+      pp["targets"] = fft_freqs->target_freqs.size();
+      pp["radius"] = 0.15;
+      bench.run("create_parzen_vectors" + swl, pp, double(fft_freqs->target_freqs.size()), 0.0, [&]() {
+        mtbench::do_not_optimize(double(fft_freqs->create_parzen_vectors()));
+      });
+      pp["pairs"] = pairs;
+      // parzen appends to the result
+      const auto clear_prz = [&]() {
+        for (auto &ac : raw->sa_prz)
+          raw->sa_prz.get_spectra(ac.first)->clear();
+      };
+      bench.run("parzen_stack_all" + swl, pp, double(fft_freqs->selected_freqs.size() * pairs), 0.0, clear_prz, [&]() {
+        raw->parzen_stack_all();
+      });
+
+      for (auto &chan : chans)
+        fftw_destroy_plan(chan->plan);
+    }
+
+    // ******************************** fir filter ********************************************************************************
+
+    const mtbench::jsn p_fir = {{"filter", "mtx32"}, {"samples", samples}};
+    if (bench.enabled("fir_filter")) {
+      fir_filter fir;
+      std::shared_ptr<channel> out_chan;
+      try {
+        out_chan = fir.set_filter(channels.front(), "mtx32");
+      } catch (const std::exception &e) {
+        bench.skip("fir_filter/mtx32", p_fir, e.what());
+      }
+      if (out_chan != nullptr) {
+        fs::create_directory(tmp_dir / "fir");
+        out_chan->set_dir(tmp_dir / "fir");
+        // filter() leaves the chunk size of the input channel set; the first read must be a full filter length again
+        bench.run("fir_filter/mtx32", p_fir, double(samples), double(samples * sizeof(double)), [&]() { channels.front()->ts_chunk.clear(); }, [&]() { fir.filter(); });
+      }
+    }
+
+    // ******************************** resampler *********************************************************************************
+    // fractional shift to the next full second and a 100 ppm rate conversion, 64 taps
+
+    if (bench.enabled("resampler")) {
+      for (const double ppm : {0.0, 100.0}) {
+        const std::string name = "resampler/" + std::to_string(int(ppm)) + "ppm";
+        const mtbench::jsn p_rs = {{"taps", 64}, {"ppm", ppm}, {"samples", samples}};
+        auto rs = std::make_shared<resampler>();
+        std::shared_ptr<channel> out_chan;
+        try {
+          out_chan = rs->set_resampler(channels.front(), sample_rate * (1.0 + ppm * 1.0E-6));
+        } catch (const std::exception &e) {
+          bench.skip(name, p_rs, e.what());
+        }
+        if (out_chan != nullptr) {
+          fs::create_directory(tmp_dir / "resampler");
+          out_chan->set_dir(tmp_dir / "resampler");
+          bench.run(name, p_rs, double(samples), double(samples * sizeof(double)), [&]() { rs->resample(); });
+        }
+      }
+    }
+
+    // ******************************** akima *************************************************************************************
+    // a calibration table of 64 frequencies interpolated to the lines of the largest FFT
+
+    std::vector<double> x_in, y_in, y_out;
+    for (size_t i = 0; i < 64; ++i) {
+      x_in.push_back(std::pow(10.0, -4.0 + 8.0 * double(i) / 63.0));
+      y_in.push_back(0.2 * x_in.back() / std::sqrt(1.0 + x_in.back() * x_in.back()));
+    }
+    const size_t n_akima = akima_points ? akima_points : wls.back() / 2;
+    std::vector<double> new_x(n_akima);
+    for (size_t i = 0; i < n_akima; ++i)
+      new_x[i] = double(i + 1) * sample_rate / double(2 * n_akima);
+    bench.run("akima_vector_double/" + std::to_string(n_akima), {{"nodes", x_in.size()}, {"points", n_akima}}, double(n_akima), 0.0, [&]() {
+      bvec::akima_vector_double(x_in, y_in, new_x, y_out);
+      mtbench::do_not_optimize(y_out.back());
+    });
+
+    // ******************************** regression per frequency over all stacks *************************************************
+    // statmap per series (two_pass_linreg, std::vector<bool> or bitmask selection) against one batch over all series (batch_stats),
+    // 30% of the stacks de-selected
+
+    if (bench.enabled("linreg")) {
+      const size_t n_series = wls.back() / 2 + 1, n_stacks = 256;
+      std::vector<double> rx(n_series * n_stacks), ry(n_series * n_stacks);
+      std::vector<uint8_t> rsel(n_series * n_stacks);
+      for (size_t i = 0; i < rx.size(); ++i) {
+        rx[i] = std::sin(double(i) * 0.37) + std::cos(double(i) * 0.011);
+        ry[i] = 2.0 * rx[i] + 0.1 * std::sin(double(i) * 1.3);
+        rsel[i] = (i % 10) < 7;
+      }
+      const mtbench::jsn p_lr = {{"series", n_series}, {"stacks", n_stacks}};
+      std::vector<double> sx(n_stacks), sy(n_stacks);
+      std::vector<bool> ssel(n_stacks);
+      bench.run("linreg_if/statmap", p_lr, double(n_series), 0.0, [&]() {
+        double slopes = 0.0;
+        for (size_t i = 0; i < n_series; ++i) {
+          for (size_t s = 0; s < n_stacks; ++s) {
+            sx[s] = rx[s * n_series + i];
+            sy[s] = ry[s * n_series + i];
+            ssel[s] = rsel[s * n_series + i];
+          }
+          two_pass_linreg lr;
+          auto result = lr.linreg_if(sx.cbegin(), sx.cend(), sy.cbegin(), sy.cend(), ssel.cbegin(), ssel.cend());
+          slopes += result[g_stat::slope_xy];
+        }
+        mtbench::do_not_optimize(slopes);
+      });
+      bitmask smask(n_stacks);
+      bench.run("linreg_if/bitmask", p_lr, double(n_series), 0.0, [&]() {
+        double slopes = 0.0;
+        for (size_t i = 0; i < n_series; ++i) {
+          for (size_t s = 0; s < n_stacks; ++s) {
+            sx[s] = rx[s * n_series + i];
+            sy[s] = ry[s * n_series + i];
+            smask.set(s, rsel[s * n_series + i]);
+          }
+          two_pass_linreg lr;
+          auto result = lr.linreg_if(sx.cbegin(), sx.cend(), sy.cbegin(), sy.cend(), smask);
+          slopes += result[g_stat::slope_xy];
+        }
+        mtbench::do_not_optimize(slopes);
+      });
+      std::vector<statrec> recs;
+      bench.run("linreg_if/batch", p_lr, double(n_series), 0.0, [&]() {
+        mtbench::do_not_optimize(double(batch_stats::linreg(rx, ry, n_series, recs, &rsel)));
+      });
+    }
+
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    if (!keep)
+      fs::remove_all(tmp_dir);
+    return EXIT_FAILURE;
+  }
+
+  // ******************************** results *************************************************************************************
+
+  if (!keep)
+    fs::remove_all(tmp_dir);
+  std::ofstream out(json_file);
+  if (!out.is_open()) {
+    std::cerr << "can not write " << json_file << std::endl;
+    return EXIT_FAILURE;
+  }
+  out << std::setw(2) << bench.to_json(context) << std::endl;
+  std::cerr << "results: " << json_file.string() << std::endl;
+
+  return EXIT_SUCCESS;
+}
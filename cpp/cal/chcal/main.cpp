@@ -212,6 +212,7 @@ int main(int argc, char **argv) {
 
   std::vector<std::shared_ptr<calibration>> cals;
   std::multimap<fs::path, size_t> mtxfiles_and_cals;
+  std::vector<fs::path> xml_files; // read in one go by read_xml_bulk, measdoc or single detected by content
 
   l = 1;
   while (argc > 1 && (l < unsigned(argc))) {
@@ -239,7 +240,9 @@ int main(int argc, char **argv) {
         }
       }
 
-      if ((check_ext.extension() == ".xml") || (check_ext.extension() == ".XML")) {
+      if (((check_ext.extension() == ".xml") || (check_ext.extension() == ".XML")) && !force_measdoc && !force_single) {
+        xml_files.emplace_back(check_ext);
+      } else if ((check_ext.extension() == ".xml") || (check_ext.extension() == ".XML")) {
         try {
 
           std::string messages;
@@ -279,6 +282,23 @@ int main(int argc, char **argv) {
     ++l;
   }
 
+  if (xml_files.size()) {
+    try {
+      std::string messages;
+      auto pool = std::make_shared<BS::thread_pool>();
+      std::shared_ptr<read_cal> mtx_cal_file = std::make_shared<read_cal>();
+      auto xcals = mtx_cal_file->read_xml_bulk(xml_files, pool, messages);
+      for (auto &sensor : xcals) {
+        cals.insert(cals.end(), sensor.second.begin(), sensor.second.end());
+      }
+      std::replace(messages.begin(), messages.end(), ';', '\n');
+      std::cout << messages;
+    } catch (const std::runtime_error &error) {
+      std::cerr << error.what() << std::endl;
+      cals.clear();
+    }
+  }
+
   if (!cals.size() && !gen_cal) {
     std::cout << "no calibrations found / loaded" << std::endl;
     return EXIT_FAILURE;
@@ -324,6 +324,11 @@ std::vector<std::shared_ptr<calibration>> read_cal::read_std_xml(const fs::path
     err_str << "::Root Element XML_ERROR_FILE_READ_ERROR" << filename;
     throw std::runtime_error(err_str.str());
   }
+  return this->xml_measdoc_cals(proot, filename, messages, &std::cerr);
+}
+
+std::vector<std::shared_ptr<calibration>> read_cal::xml_measdoc_cals(tinyxml2::XMLElement *proot, const fs::path &filename, std::string &messages, std::ostream *log) const {
+  std::vector<std::shared_ptr<calibration>> cal_entries;
 
   auto pscal_sens = open_node(proot, "calibration_sensors", true);
   if (pscal_sens == nullptr) {
@@ -338,7 +343,7 @@ std::vector<std::shared_ptr<calibration>> read_cal::read_std_xml(const fs::path
     int old_id = id;
     pchan->QueryIntAttribute("id", &id);
     if (old_id != id) {
-      std::ostringstream message(messages, std::ios_base::ate); // this inside a thread, try bundle output
+      std::ostringstream message; // this inside a thread, try bundle output; appended to messages below
       message << "sensor for channel: " << id << " -> ";
       old_id = id;
       auto pca = open_node(pchan, "calibration");
@@ -447,9 +452,13 @@ std::vector<std::shared_ptr<calibration>> read_cal::read_std_xml(const fs::path
           messages += message.str() + ";";
 
         } catch (const std::runtime_error &error) {
-          std::cerr << message.str() << std::endl;
-          std::cerr << error.what() << std::endl;
-          std::cerr << "ignore in case this is E" << std::endl;
+          if (log != nullptr) {
+            *log << message.str() << std::endl;
+            *log << error.what() << std::endl;
+            *log << "ignore in case this is E" << std::endl;
+          } else {
+            messages += message.str() + " " + error.what() + ", ignore in case this is E;";
+          }
         }
       }
     }
@@ -491,90 +500,87 @@ std::vector<std::shared_ptr<calibration>> read_cal::read_std_xml_single(const st
       err_str << "::Root Element XML_ERROR_FILE_READ_ERROR " << filename;
       throw std::runtime_error(err_str.str());
     }
+    cal_entries = this->xml_single_cals(proot, &std::cout);
 
-    auto pci = open_node(proot, "calibrated_item");
-    std::string sensor(xml_svalue(pci, "ci"));
-    std::cout << sensor << " detected" << std::endl;
-    int64_t serial = xml_ivalue(pci, "ci_serial_number");
-    std::string cal_date(xml_svalue(pci, "ci_date"));
-    std::string cal_time(xml_svalue(pci, "ci_time"));
-    std::vector<double> f_on, f_off, a_on, a_off, p_on, p_off;
-    auto f_unit = std::make_unique<std::string>();
-    auto a_unit = std::make_unique<std::string>();
-    auto p_unit = std::make_unique<std::string>();
-
-    // cd will be NULL when there is no cal data, like e.g. for E
-    auto cd = open_node(proot, "caldata", true);
-    while (cd) {
-      if (cd != nullptr) {
-        std::string strchp("ukn");
-        const char *cchopper = cd->Attribute("chopper");
-        if (cchopper != nullptr) {
-          strchp = std::string(cchopper);
-        }
-        double f = xml_dvalue(cd, "c1", f_unit.get(), "unit");
-        double a = xml_dvalue(cd, "c2", a_unit.get(), "unit");
-        double p = xml_dvalue(cd, "c3", p_unit.get(), "unit");
-        if ((f != DBL_MAX && (a != DBL_MAX) && (p != DBL_MAX))) {
-          if (strchp == "on") {
-            f_on.push_back(f);
-            a_on.push_back(a);
-            p_on.push_back(p);
-          } else {
-            f_off.push_back(f);
-            a_off.push_back(a);
-            p_off.push_back(p);
-          }
-        }
+  } catch (const std::runtime_error &error) {
+    std::cerr << error.what() << std::endl;
+  }
+
+  return cal_entries;
+}
+
+std::vector<std::shared_ptr<calibration>> read_cal::xml_single_cals(tinyxml2::XMLElement *proot, std::ostream *log) const {
+  std::vector<std::shared_ptr<calibration>> cal_entries;
+  auto pci = open_node(proot, "calibrated_item");
+  std::string sensor(xml_svalue(pci, "ci"));
+  if (log != nullptr)
+    *log << sensor << " detected" << std::endl;
+  int64_t serial = xml_ivalue(pci, "ci_serial_number");
+  std::string cal_date(xml_svalue(pci, "ci_date"));
+  std::string cal_time(xml_svalue(pci, "ci_time"));
+  std::vector<double> f_on, f_off, a_on, a_off, p_on, p_off;
+  auto f_unit = std::make_unique<std::string>();
+  auto a_unit = std::make_unique<std::string>();
+  auto p_unit = std::make_unique<std::string>();
+
+  // cd will be NULL when there is no cal data, like e.g. for E
+  auto cd = open_node(proot, "caldata", true);
+  while (cd) {
+    if (cd != nullptr) {
+      std::string strchp("ukn");
+      const char *cchopper = cd->Attribute("chopper");
+      if (cchopper != nullptr) {
+        strchp = std::string(cchopper);
       }
-      cd = cd->NextSiblingElement("caldata");
-    }
-    if (f_on.size()) {
-      std::cout << "on  size " << f_on.size() << std::endl;
-      cal_entries.emplace_back(std::make_shared<calibration>());
-      if ((*a_unit.get() == "V/(nT*Hz)") && (*f_unit.get() == "Hz") && (*p_unit.get() == "deg")) {
-        cal_entries.back()->set_format(CalibrationType::mtx_old);
-        cal_entries.back()->chopper = ChopperStatus::on;
-        cal_entries.back()->f = f_on;
-        cal_entries.back()->a = a_on;
-        cal_entries.back()->p = p_on;
-        cal_entries.back()->sensor = sensor;
-        if (serial != INT64_MAX)
-          cal_entries.back()->serial = serial;
-        if (cal_date.size())
-          cal_entries.back()->datetime = cal_date;
-        if (cal_time.size())
-          cal_entries.back()->datetime += "T" + cal_time;
-        else
-          cal_entries.back()->datetime += "T00:00:00";
-        // cal_entries.back()->write_file("/tmp");
+      double f = xml_dvalue(cd, "c1", f_unit.get(), "unit");
+      double a = xml_dvalue(cd, "c2", a_unit.get(), "unit");
+      double p = xml_dvalue(cd, "c3", p_unit.get(), "unit");
+      if ((f != DBL_MAX && (a != DBL_MAX) && (p != DBL_MAX))) {
+        if (strchp == "on") {
+          f_on.push_back(f);
+          a_on.push_back(a);
+          p_on.push_back(p);
+        } else {
+          f_off.push_back(f);
+          a_off.push_back(a);
+          p_off.push_back(p);
+        }
       }
     }
-    if (f_off.size()) {
-      std::cout << "off size " << f_off.size() << std::endl;
-      if ((*a_unit.get() == "V/(nT*Hz)") && (*f_unit.get() == "Hz") && (*p_unit.get() == "deg")) {
-        cal_entries.emplace_back(std::make_shared<calibration>());
-        cal_entries.back()->set_format(CalibrationType::mtx_old);
-        cal_entries.back()->chopper = ChopperStatus::off;
-        cal_entries.back()->f = f_off;
-        cal_entries.back()->a = a_off;
-        cal_entries.back()->p = p_off;
-        cal_entries.back()->sensor = sensor;
-        if (serial != INT64_MAX)
-          cal_entries.back()->serial = serial;
-        if (cal_date.size())
-          cal_entries.back()->datetime = cal_date;
-        if (cal_time.size())
-          cal_entries.back()->datetime += "T" + cal_time;
-        else
-          cal_entries.back()->datetime += "T00:00:00";
-
-        // cal_entries.back()->write_file("/tmp");
-      }
+    cd = cd->NextSiblingElement("caldata");
+  }
+  if (f_on.size()) {
+    if (log != nullptr)
+      *log << "on  size " << f_on.size() << std::endl;
+    cal_entries.emplace_back(std::make_shared<calibration>());
+    if ((*a_unit.get() == "V/(nT*Hz)") && (*f_unit.get() == "Hz") && (*p_unit.get() == "deg")) {
+      cal_entries.back()->set_format(CalibrationType::mtx_old);
+      cal_entries.back()->chopper = ChopperStatus::on;
+      cal_entries.back()->f = f_on;
+      cal_entries.back()->a = a_on;
+      cal_entries.back()->p = p_on;
+      cal_entries.back()->sensor = sensor;
+      if (serial != INT64_MAX)
+        cal_entries.back()->serial = serial;
+      if (cal_date.size())
+        cal_entries.back()->datetime = cal_date;
+      if (cal_time.size())
+        cal_entries.back()->datetime += "T" + cal_time;
+      else
+        cal_entries.back()->datetime += "T00:00:00";
+      // cal_entries.back()->write_file("/tmp");
     }
-    // likely electrodes or old sensors
-    if (!f_on.size() && !f_off.size() && (serial != INT64_MAX)) {
+  }
+  if (f_off.size()) {
+    if (log != nullptr)
+      *log << "off size " << f_off.size() << std::endl;
+    if ((*a_unit.get() == "V/(nT*Hz)") && (*f_unit.get() == "Hz") && (*p_unit.get() == "deg")) {
       cal_entries.emplace_back(std::make_shared<calibration>());
+      cal_entries.back()->set_format(CalibrationType::mtx_old);
+      cal_entries.back()->chopper = ChopperStatus::off;
+      cal_entries.back()->f = f_off;
+      cal_entries.back()->a = a_off;
+      cal_entries.back()->p = p_off;
       cal_entries.back()->sensor = sensor;
       if (serial != INT64_MAX)
         cal_entries.back()->serial = serial;
@@ -584,11 +590,23 @@ std::vector<std::shared_ptr<calibration>> read_cal::read_std_xml_single(const st
         cal_entries.back()->datetime += "T" + cal_time;
       else
         cal_entries.back()->datetime += "T00:00:00";
+
       // cal_entries.back()->write_file("/tmp");
     }
-
-  } catch (const std::runtime_error &error) {
-    std::cerr << error.what() << std::endl;
+  }
+  // likely electrodes or old sensors
+  if (!f_on.size() && !f_off.size() && (serial != INT64_MAX)) {
+    cal_entries.emplace_back(std::make_shared<calibration>());
+    cal_entries.back()->sensor = sensor;
+    if (serial != INT64_MAX)
+      cal_entries.back()->serial = serial;
+    if (cal_date.size())
+      cal_entries.back()->datetime = cal_date;
+    if (cal_time.size())
+      cal_entries.back()->datetime += "T" + cal_time;
+    else
+      cal_entries.back()->datetime += "T00:00:00";
+    // cal_entries.back()->write_file("/tmp");
   }
 
   for (auto &cal : cal_entries) {
@@ -599,3 +617,120 @@ std::vector<std::shared_ptr<calibration>> read_cal::read_std_xml_single(const st
 
   return cal_entries;
 }
+
+std::map<std::string, std::vector<std::shared_ptr<calibration>>> read_cal::read_xml_bulk(const fs::path &dir_or_glob, std::shared_ptr<BS::thread_pool> &pool, std::string &messages) const {
+  std::vector<fs::path> files;
+  const std::string pattern(dir_or_glob.filename().string());
+  if (fs::is_directory(dir_or_glob)) {
+    for (const auto &entry : fs::directory_iterator(dir_or_glob)) {
+      const auto ext = entry.path().extension();
+      if (entry.is_regular_file() && ((ext == ".xml") || (ext == ".XML")))
+        files.emplace_back(entry.path());
+    }
+  } else if (pattern.find_first_of("*?") != std::string::npos) {
+    const fs::path dir(dir_or_glob.has_parent_path() ? dir_or_glob.parent_path() : fs::current_path());
+    if (!fs::is_directory(dir)) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << ":: directory not found -> " << dir;
+      throw std::runtime_error(err_str.str());
+    }
+    for (const auto &entry : fs::directory_iterator(dir)) {
+      if (entry.is_regular_file() && glob_match(pattern, entry.path().filename().string()))
+        files.emplace_back(entry.path());
+    }
+  } else if (fs::exists(dir_or_glob)) {
+    files.emplace_back(dir_or_glob);
+  } else {
+    std::ostringstream err_str(__func__, std::ios_base::ate);
+    err_str << ":: file not found -> " << dir_or_glob;
+    throw std::runtime_error(err_str.str());
+  }
+  std::sort(files.begin(), files.end());
+  return this->read_xml_bulk(files, pool, messages);
+}
+
+std::map<std::string, std::vector<std::shared_ptr<calibration>>> read_cal::read_xml_bulk(const std::vector<fs::path> &files, std::shared_ptr<BS::thread_pool> &pool, std::string &messages) const {
+  if (pool == nullptr) {
+    std::ostringstream err_str(__func__, std::ios_base::ate);
+    err_str << ":: pool is nullptr";
+    throw std::runtime_error(err_str.str());
+  }
+  std::map<std::string, std::vector<std::shared_ptr<calibration>>> result;
+  if (!files.size())
+    return result;
+
+  // several blocks per thread for the balance - the files differ a lot in size; each block reuses one XMLDocument
+  const size_t blocks = std::min(files.size(), size_t(4) * size_t(pool->get_thread_count()));
+  auto futures = pool->submit_blocks<size_t>(
+      0, files.size(),
+      [this, &files](const size_t start, const size_t end) {
+        std::pair<std::vector<std::shared_ptr<calibration>>, std::string> block;
+        tinyxml2::XMLDocument doc;
+        for (size_t i = start; i < end; ++i) {
+          try {
+            if (doc.LoadFile(files[i].string().c_str()) != tinyxml2::XML_SUCCESS) {
+              block.second += "error loading XML file " + files[i].string() + ";";
+              continue;
+            }
+            auto proot = doc.RootElement();
+            if (proot == nullptr) {
+              block.second += "no root element " + files[i].string() + ";";
+              continue;
+            }
+            // measdoc with channels or a calibration only file
+            std::vector<std::shared_ptr<calibration>> cals;
+            if (open_node(proot, "calibration_sensors", true) != nullptr)
+              cals = this->xml_measdoc_cals(proot, files[i], block.second, nullptr);
+            else
+              cals = this->xml_single_cals(proot, nullptr);
+            for (auto &cal : cals) {
+              if (!cal->is_empty())
+                block.first.emplace_back(std::move(cal));
+            }
+          } catch (const std::runtime_error &error) {
+            block.second += files[i].string() + " " + error.what() + ";";
+          }
+        }
+        return block;
+      },
+      blocks);
+
+  // blocks in file order, so the result does not depend on the scheduling
+  std::vector<std::shared_ptr<calibration>> cals;
+  for (auto &block : futures.get()) {
+    cals.insert(cals.end(), std::make_move_iterator(block.first.begin()), std::make_move_iterator(block.first.end()));
+    messages += block.second;
+  }
+  remove_cal_duplicates(cals);
+
+  for (auto &cal : cals)
+    result[cal->sensor].emplace_back(std::move(cal));
+  for (auto &sensor : result) {
+    std::stable_sort(sensor.second.begin(), sensor.second.end(), [](const std::shared_ptr<calibration> &lhs, const std::shared_ptr<calibration> &rhs) {
+      return std::tie(lhs->serial, lhs->chopper, lhs->datetime) < std::tie(rhs->serial, rhs->chopper, rhs->datetime);
+    });
+  }
+  return result;
+}
+
+bool read_cal::glob_match(const std::string &pattern, const std::string &name) {
+  // iterative wildcard match with back tracking to the last *
+  size_t p = 0, n = 0, star = std::string::npos, mark = 0;
+  while (n < name.size()) {
+    if ((p < pattern.size()) && ((pattern[p] == '?') || (pattern[p] == name[n]))) {
+      ++p;
+      ++n;
+    } else if ((p < pattern.size()) && (pattern[p] == '*')) {
+      star = p++;
+      mark = n;
+    } else if (star != std::string::npos) {
+      p = star + 1;
+      n = ++mark;
+    } else {
+      return false;
+    }
+  }
+  while ((p < pattern.size()) && (pattern[p] == '*'))
+    ++p;
+  return p == pattern.size();
+}
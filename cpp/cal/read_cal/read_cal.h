@@ -7,16 +7,23 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <numeric>
 #include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "BS_thread_pool.h"
 #include "sqlite_handler.h"
 
 namespace fs = std::filesystem;
 
+namespace tinyxml2 {
+class XMLElement;
+}
+
 #include "cal_base.h"
 #include "mt_base.h"
 
@@ -49,6 +56,20 @@ public:
    */
   std::vector<std::shared_ptr<calibration>> read_std_xml_single(const std::filesystem::path &filename);
 
+  /*!
+   * \brief read_xml_bulk reads many XML calibrations (measdoc or calibration only, detected by content) concurrently on the pool;
+   * each task parses a block of files with one XMLDocument; duplicates are removed (remove_cal_duplicates); errors don't stop the others
+   * \param dir_or_glob directory (all *.xml), a pattern like /cal/MFS06e*.xml (* and ? in the file name) or a single file
+   * \param messages gets the channel infos and the errors, ; separated
+   * \return calibrations by sensor name, each sorted by serial, chopper and date
+   */
+  std::map<std::string, std::vector<std::shared_ptr<calibration>>> read_xml_bulk(const fs::path &dir_or_glob, std::shared_ptr<BS::thread_pool> &pool, std::string &messages) const;
+
+  /*!
+   * \brief read_xml_bulk same for a list of files
+   */
+  std::map<std::string, std::vector<std::shared_ptr<calibration>>> read_xml_bulk(const std::vector<fs::path> &files, std::shared_ptr<BS::thread_pool> &pool, std::string &messages) const;
+
   void clear();
 
   std::string get_sensor_name(const std::string name) const;
@@ -58,6 +79,11 @@ public:
 private:
   std::string get_units_mtx_old() const;
 
+  // parse an already loaded XML; log nullptr: quiet, channel messages and errors go to messages only
+  std::vector<std::shared_ptr<calibration>> xml_measdoc_cals(tinyxml2::XMLElement *proot, const fs::path &filename, std::string &messages, std::ostream *log) const;
+  std::vector<std::shared_ptr<calibration>> xml_single_cals(tinyxml2::XMLElement *proot, std::ostream *log) const;
+  static bool glob_match(const std::string &pattern, const std::string &name);
+
   ChopperStatus chopper = ChopperStatus::off;
   std::unique_ptr<sqlite_handler> sqldb;
 
@@ -81,13 +107,25 @@ private:
   std::vector<double> p;
 };
 
-void remove_cal_duplicates(std::vector<std::shared_ptr<calibration>> &v) {
-  auto end = v.end();
-  for (auto it = v.begin(); it != end; ++it) {
-    end = std::remove(it + 1, end, *it);
+/*!
+ * \brief remove_cal_duplicates removes calibrations equal (operator==) to an earlier one and keeps the order; sorts an index, O(n log n)
+ */
+inline void remove_cal_duplicates(std::vector<std::shared_ptr<calibration>> &v) {
+  std::vector<size_t> idx(v.size());
+  std::iota(idx.begin(), idx.end(), size_t(0));
+  // stable: the first of equal calibrations stays in front
+  std::stable_sort(idx.begin(), idx.end(), [&v](const size_t lhs, const size_t rhs) { return compare_cal_less(v[lhs], v[rhs]); });
+  std::vector<bool> dup(v.size(), false);
+  for (size_t i = 1; i < idx.size(); ++i) {
+    if (v[idx[i - 1]] == v[idx[i]])
+      dup[idx[i]] = true;
   }
-
-  v.erase(end, v.end());
+  size_t j = 0;
+  for (size_t i = 0; i < v.size(); ++i) {
+    if (!dup[i])
+      v[j++] = std::move(v[i]);
+  }
+  v.resize(j);
 }
 
 #endif // READ_CAL_H
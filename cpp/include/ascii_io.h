@@ -0,0 +1,324 @@
+#ifndef ASCII_IO_H
+#define ASCII_IO_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "BS_thread_pool.h"
+
+/*!
+ * @file ascii_io.h
+ * @brief single column ASCII time series <-> binary, chunked and parallel
+ *
+ * reading: the file is mapped, cut into blocks at newline boundaries, each block is parsed with std::from_chars on the pool;
+ * writing: a chunk of doubles is cut into blocks, each block is formatted with std::to_chars into its own buffer, the buffers are written in order;
+ * memory is bounded by the chunk / window size, not by the file size
+ * \code
+ *   ascii_column_reader rd(infile, pool);                     // counts and min / max in one parallel pass
+ *   rd.for_each_chunk([&](const std::vector<double> &v) { ... }); // values in file order
+ * \endcode
+ */
+
+/*!
+ * \brief The ascii_mapped_file class maps a file read only; on platforms without mmap the file is read into memory
+ */
+class ascii_mapped_file {
+public:
+  explicit ascii_mapped_file(const std::filesystem::path &filename) {
+    if (!std::filesystem::exists(filename)) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::  file not exists " << filename;
+      throw std::runtime_error(err_str.str());
+    }
+#if defined(__unix__)
+    this->fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if ((this->fd < 0) || (fstat(this->fd, &st) != 0)) {
+      if (this->fd >= 0)
+        ::close(this->fd);
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << ":: can not open ascii for reading " << filename;
+      throw std::runtime_error(err_str.str());
+    }
+    this->bytes = size_t(st.st_size);
+    if (this->bytes) {
+      void *ptr = mmap(nullptr, this->bytes, PROT_READ, MAP_PRIVATE, this->fd, 0);
+      if (ptr == MAP_FAILED) {
+        ::close(this->fd);
+        std::ostringstream err_str(__func__, std::ios_base::ate);
+        err_str << ":: can not map " << filename;
+        throw std::runtime_error(err_str.str());
+      }
+      madvise(ptr, this->bytes, MADV_SEQUENTIAL);
+      this->ptr = static_cast<const char *>(ptr);
+    }
+#else
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << ":: can not open ascii for reading " << filename;
+      throw std::runtime_error(err_str.str());
+    }
+    this->buf.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    this->bytes = this->buf.size();
+    this->ptr = this->buf.data();
+#endif
+  }
+
+  ~ascii_mapped_file() {
+#if defined(__unix__)
+    if (this->ptr != nullptr)
+      munmap(const_cast<char *>(this->ptr), this->bytes);
+    if (this->fd >= 0)
+      ::close(this->fd);
+#endif
+  }
+
+  ascii_mapped_file(const ascii_mapped_file &) = delete;
+  ascii_mapped_file &operator=(const ascii_mapped_file &) = delete;
+
+  const char *data() const {
+    return this->ptr;
+  }
+
+  size_t size() const {
+    return this->bytes;
+  }
+
+private:
+  const char *ptr = nullptr;
+  size_t bytes = 0;
+#if defined(__unix__)
+  int fd = -1;
+#else
+  std::string buf;
+#endif
+};
+
+/*!
+ * \brief ascii_line_blocks cuts [0, n) into about n / block_bytes blocks, each ending after a newline (the last at n)
+ */
+inline std::vector<std::pair<size_t, size_t>> ascii_line_blocks(const char *data, const size_t &n, const size_t &block_bytes) {
+  std::vector<std::pair<size_t, size_t>> blocks;
+  size_t start = 0;
+  while (start < n) {
+    size_t end = std::min(n, start + std::max(block_bytes, size_t(1)));
+    while ((end < n) && (data[end - 1] != '\n'))
+      ++end;
+    blocks.emplace_back(start, end);
+    start = end;
+  }
+  return blocks;
+}
+
+/*!
+ * \brief ascii_parse_lines parses one value per line of [first, last) and calls f(double);
+ * as the old getline / operator>> reader: leading blanks are skipped, a line without a number gives 0, everything after the number is ignored
+ */
+template <class F>
+void ascii_parse_lines(const char *first, const char *last, F &&f) {
+  const char *p = first;
+  while (p < last) {
+    while ((p < last) && ((*p == ' ') || (*p == '\t')))
+      ++p;
+    if ((p < last) && (*p == '+'))
+      ++p;
+    double d = 0.0;
+    auto [ptr, ec] = std::from_chars(p, last, d);
+    if (ec != std::errc())
+      d = 0.0;
+    f(d);
+    // next line
+    p = (ec == std::errc()) ? ptr : p;
+    while ((p < last) && (*p != '\n'))
+      ++p;
+    ++p;
+  }
+}
+
+/*!
+ * \brief ascii_format_doubles appends one value per line to out; precision as std::ostream::precision (%g), 0 for the shortest round trip
+ */
+inline void ascii_format_doubles(const double *x, const size_t &n, std::string &out, const int precision = 6) {
+  constexpr size_t max_chars = 32; // -d.ddddddddddddddddde-308 and newline
+  const size_t old_size = out.size();
+  out.resize(old_size + n * max_chars);
+  char *p = out.data() + old_size;
+  char *const end = out.data() + out.size();
+  for (size_t i = 0; i < n; ++i) {
+    std::to_chars_result res;
+    if (precision > 0)
+      res = std::to_chars(p, end, x[i], std::chars_format::general, precision);
+    else
+      res = std::to_chars(p, end, x[i]);
+    p = res.ptr;
+    *p++ = '\n';
+  }
+  out.resize(size_t(p - out.data()));
+}
+
+/*!
+ * \brief The ascii_column_reader class reads a single column ASCII file in parallel; the constructor counts the values and
+ * gets min / max (needed for the LSB before the first sample is written); for_each_chunk parses again and hands the values over in order
+ */
+class ascii_column_reader {
+public:
+  ascii_column_reader(const std::filesystem::path &filename, std::shared_ptr<BS::thread_pool> &pool, const size_t &block_bytes = size_t(8) << 20) :
+      file(filename), pool(pool) {
+    if (this->pool == nullptr) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << ":: pool is nullptr";
+      throw std::runtime_error(err_str.str());
+    }
+    this->blocks = ascii_line_blocks(this->file.data(), this->file.size(), block_bytes);
+    const char *data = this->file.data();
+    this->counts.resize(this->blocks.size());
+
+    struct block_stat {
+      size_t n = 0;
+      double min = std::numeric_limits<double>::max();
+      double max = std::numeric_limits<double>::lowest();
+    };
+    std::vector<std::future<block_stat>> futures;
+    futures.reserve(this->blocks.size());
+    for (const auto &blk : this->blocks) {
+      futures.emplace_back(this->pool->submit_task([data, blk]() {
+        block_stat st;
+        ascii_parse_lines(data + blk.first, data + blk.second, [&st](const double d) {
+          ++st.n;
+          st.min = std::min(st.min, d);
+          st.max = std::max(st.max, d);
+        });
+        return st;
+      }));
+    }
+    for (size_t i = 0; i < futures.size(); ++i) {
+      const auto st = futures[i].get();
+      this->counts[i] = st.n;
+      this->n += st.n;
+      this->min_val = std::min(this->min_val, st.min);
+      this->max_val = std::max(this->max_val, st.max);
+    }
+    if (!this->n) {
+      this->min_val = 0.0;
+      this->max_val = 0.0;
+    }
+  }
+
+  size_t size() const {
+    return this->n;
+  }
+
+  double min() const {
+    return this->min_val;
+  }
+
+  double max() const {
+    return this->max_val;
+  }
+
+  /*!
+   * \brief for_each_chunk parses the blocks in windows of (threads) blocks and calls f(const std::vector<double> &) per block in file order
+   * \return values handed over
+   */
+  template <class F>
+  size_t for_each_chunk(F &&f) {
+    const char *data = this->file.data();
+    const size_t window = std::max(size_t(1), size_t(this->pool->get_thread_count()));
+    size_t done = 0;
+    for (size_t w = 0; w < this->blocks.size(); w += window) {
+      const size_t w_end = std::min(this->blocks.size(), w + window);
+      std::vector<std::future<std::vector<double>>> futures;
+      for (size_t i = w; i < w_end; ++i) {
+        const auto blk = this->blocks[i];
+        const size_t cnt = this->counts[i];
+        futures.emplace_back(this->pool->submit_task([data, blk, cnt]() {
+          std::vector<double> v;
+          v.reserve(cnt);
+          ascii_parse_lines(data + blk.first, data + blk.second, [&v](const double d) { v.push_back(d); });
+          return v;
+        }));
+      }
+      for (auto &fut : futures) {
+        const auto v = fut.get();
+        f(v);
+        done += v.size();
+      }
+    }
+    return done;
+  }
+
+private:
+  ascii_mapped_file file;
+  std::shared_ptr<BS::thread_pool> pool;
+  std::vector<std::pair<size_t, size_t>> blocks; //!< byte ranges, each ends after a newline
+  std::vector<size_t> counts;                    //!< values per block
+  size_t n = 0;
+  double min_val = std::numeric_limits<double>::max();
+  double max_val = std::numeric_limits<double>::lowest();
+};
+
+/*!
+ * \brief ascii_write_doubles formats n doubles in parallel blocks and writes them in order, one value per line
+ */
+inline void ascii_write_doubles(const double *x, const size_t &n, std::ostream &out, std::shared_ptr<BS::thread_pool> &pool, const int precision = 6) {
+  if (!n)
+    return;
+  const size_t n_blocks = std::min(n, size_t(4) * std::max(size_t(1), size_t(pool->get_thread_count())));
+  auto futures = pool->submit_blocks<size_t>(
+      0, n,
+      [x, precision](const size_t start, const size_t end) {
+        std::string buf;
+        ascii_format_doubles(x + start, end - start, buf, precision);
+        return buf;
+      },
+      n_blocks);
+  for (const auto &buf : futures.get())
+    out.write(buf.data(), std::streamsize(buf.size()));
+}
+
+/*!
+ * \brief binary_to_ascii converts a stream of native doubles (atss data) chunk wise into ASCII, one value per line
+ * \return values written
+ */
+inline size_t binary_to_ascii(std::istream &in, std::ostream &out, std::shared_ptr<BS::thread_pool> &pool, const int precision = 6, const size_t &chunk = size_t(1) << 22) {
+  if (pool == nullptr) {
+    std::ostringstream err_str(__func__, std::ios_base::ate);
+    err_str << ":: pool is nullptr";
+    throw std::runtime_error(err_str.str());
+  }
+  std::vector<double> buf(chunk);
+  size_t total = 0;
+  while (in) {
+    in.read(reinterpret_cast<char *>(buf.data()), std::streamsize(buf.size() * sizeof(double)));
+    const size_t got = size_t(in.gcount()) / sizeof(double);
+    if (!got)
+      break;
+    ascii_write_doubles(buf.data(), got, out, pool, precision);
+    total += got;
+  }
+  return total;
+}
+
+#endif // ASCII_IO_H
@@ -22,16 +22,17 @@ public:
     std::ifstream file;
     std::filesystem::path atmm_file(atmmfile);
     atmm_file.replace_extension(".atmm");
+    this->atmm_data.clear();
     try {
-      if (std::filesystem::is_regular_file(atmm_file)) {
-        file.open(atmm_file, std::ios::in | std::ios::binary);
-      }
+      // no selection file: nothing excluded
+      if (!std::filesystem::is_regular_file(atmm_file))
+        return;
+      file.open(atmm_file, std::ios::in | std::ios::binary);
     } catch (std::filesystem::filesystem_error &e) {
       std::string err_str = __func__;
       std::cerr << err_str << " " << e.what() << std::endl;
       return;
     }
-    this->atmm_data.clear();
 
     // get the file size in bytes from the OS
     auto file_size = std::filesystem::file_size(atmm_file);
@@ -39,13 +40,13 @@ public:
     auto num_pairs = file_size / (2 * sizeof(uint64_t));
     atmm_data.reserve(num_pairs);
 
-    // read the pairs from the binary file into the atmm_data vector, for the complete file
-    // while not EOF
-
-    while (!file.eof()) {
+    // read the pairs from the binary file into the atmm_data vector, complete pairs only
+    for (size_t i = 0; i < num_pairs; ++i) {
       std::pair<uint64_t, uint64_t> atmm_pair;
       file.read(reinterpret_cast<char *>(&atmm_pair.first), sizeof(uint64_t));
       file.read(reinterpret_cast<char *>(&atmm_pair.second), sizeof(uint64_t));
+      if (!file)
+        break;
       this->atmm_data.push_back(atmm_pair);
     }
 
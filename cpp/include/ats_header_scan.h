@@ -0,0 +1,214 @@
+#ifndef ATS_HEADER_SCAN_H
+#define ATS_HEADER_SCAN_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "BS_thread_pool.h"
+#include "atsheader.h"
+#include "atsheader_def.h"
+#include "strings_etc.h"
+
+/*!
+ * @file ats_header_scan.h
+ * @brief batch scan of ats headers: only the first 1024 bytes of each file are read (one pread per file), in parallel;
+ * the result is a flat array of ats_scan_entry - the binary header plus the decoded key fields; JSON is made on demand only
+ * \code
+ *   auto pool = std::make_shared<BS::thread_pool>();
+ *   std::string messages;
+ *   auto entries = scan_ats_headers(find_ats_files("/survey/Northern_Mining"), pool, messages);
+ *   for (const auto &e : entries) std::cout << e.path << " " << e.channel_type << " " << e.sample_rate << std::endl;
+ *   auto atsj = entries.front().json(); // nlohmann only here
+ * \endcode
+ */
+
+static_assert(sizeof(ATSHeader_80) == 1024, "ATSHeader_80 must be 1024 bytes");
+
+/*!
+ * \brief The ats_scan_entry struct one scanned file: binary header and the fields needed for sorting / grouping, decoded without JSON
+ */
+struct ats_scan_entry {
+  fs::path path;              //!< ats file
+  ATSHeader_80 header;        //!< the binary header of 1024 bytes
+  uint64_t samples = 0;       //!< samples, samples_64bit in case samples == UINT32_MAX
+  double sample_rate = 0.0;   //!< sampling frequency in Hz
+  int64_t start = 0;          //!< start time, seconds since 1970
+  double lsbval = 0.0;        //!< mV per count
+  uint16_t serial = 0;        //!< system serial
+  uint8_t channel_number = 0; //!< channel number
+  uint8_t chopper = 0;        //!< chopper on (1) off (0)
+  int16_t sensor_serial = 0;  //!< sensor serial
+  char channel_type[3] = {};  //!< Ex, Hx ..., zero terminated
+  char sensor_type[7] = {};   //!< MFS06e ..., zero terminated
+  char system_type[13] = {};  //!< ADU08e ..., zero terminated
+
+  /*!
+   * \brief decode fills the key fields from header
+   */
+  void decode() {
+    this->samples = (this->header.samples == std::numeric_limits<uint32_t>::max()) ? this->header.samples_64bit : uint64_t(this->header.samples);
+    this->sample_rate = double(this->header.sample_rate);
+    this->start = int64_t(this->header.start);
+    this->lsbval = this->header.lsbval;
+    this->serial = this->header.serial_number;
+    this->channel_number = this->header.channel_number;
+    this->chopper = this->header.chopper;
+    this->sensor_serial = this->header.sensor_serial_number;
+    copy_field(this->channel_type, this->header.channel_type, sizeof(this->header.channel_type));
+    copy_field(this->sensor_type, this->header.sensor_type, sizeof(this->header.sensor_type));
+    copy_field(this->system_type, this->header.SystemType, sizeof(this->header.SystemType));
+  }
+
+  /*!
+   * \brief duration in seconds
+   */
+  double duration() const {
+    if (this->sample_rate <= 0.0)
+      return 0.0;
+    return double(this->samples) / this->sample_rate;
+  }
+
+  std::string site_name() const {
+    return this->path.parent_path().parent_path().filename().string();
+  }
+
+  /*!
+   * \brief atsheader for the existing ats pipeline, header already set - no second read
+   */
+  std::shared_ptr<atsheader> to_atsheader() const {
+    return std::make_shared<atsheader>(this->header, this->path);
+  }
+
+  /*!
+   * \brief json the nlohmann representation, made on demand (get_ats_header() called)
+   */
+  std::shared_ptr<ats_header_json> json() const {
+    auto atsj = std::make_shared<ats_header_json>(this->header, this->path);
+    atsj->get_ats_header();
+    return atsj;
+  }
+
+private:
+  // the chars of the header are not NULL terminated
+  static void copy_field(char *dst, const char *src, const size_t n) {
+    size_t i = 0;
+    for (; (i < n) && (src[i] != '\0'); ++i)
+      dst[i] = src[i];
+    dst[i] = '\0';
+  }
+};
+
+/*!
+ * \brief read_ats_header_block reads the first 1024 bytes of an ats file
+ * \return false if the file can not be opened or is shorter than a header
+ */
+inline bool read_ats_header_block(const fs::path &filename, ATSHeader_80 &header) {
+#if defined(__unix__)
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  const ssize_t got = ::pread(fd, &header, sizeof(header), 0);
+  ::close(fd);
+  return got == ssize_t(sizeof(header));
+#else
+  std::ifstream file(filename, std::ios::in | std::ios::binary);
+  if (!file.is_open())
+    return false;
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  return file.gcount() == std::streamsize(sizeof(header));
+#endif
+}
+
+/*!
+ * \brief find_ats_files all .ats / .ATS files of a directory tree (recursive) or the file itself; sorted
+ */
+inline std::vector<fs::path> find_ats_files(const fs::path &dir_or_file) {
+  std::vector<fs::path> files;
+  if (fs::is_directory(dir_or_file)) {
+    for (const auto &entry : fs::recursive_directory_iterator(dir_or_file)) {
+      const auto ext = entry.path().extension();
+      if (entry.is_regular_file() && ((ext == ".ats") || (ext == ".ATS")))
+        files.emplace_back(entry.path());
+    }
+  } else if (fs::exists(dir_or_file)) {
+    files.emplace_back(dir_or_file);
+  } else {
+    std::ostringstream err_str(__func__, std::ios_base::ate);
+    err_str << ":: not found -> " << dir_or_file;
+    throw std::runtime_error(err_str.str());
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+/*!
+ * \brief scan_ats_headers reads and decodes the headers of files concurrently on the pool;
+ * the entries keep the order of files; unreadable or short files are skipped and reported
+ * \param files e.g. from find_ats_files
+ * \param messages gets the skipped files, ; separated
+ * \return entries in file order
+ */
+inline std::vector<ats_scan_entry> scan_ats_headers(const std::vector<fs::path> &files, std::shared_ptr<BS::thread_pool> &pool, std::string &messages) {
+  if (pool == nullptr) {
+    std::ostringstream err_str(__func__, std::ios_base::ate);
+    err_str << ":: pool is nullptr";
+    throw std::runtime_error(err_str.str());
+  }
+  std::vector<ats_scan_entry> entries(files.size());
+  std::vector<uint8_t> good(files.size(), 0);
+  if (!files.size())
+    return entries;
+
+  // a header read is a single syscall - blocks of files per task, not a task per file
+  const size_t blocks = std::min(files.size(), size_t(4) * size_t(pool->get_thread_count()));
+  pool->submit_blocks<size_t>(
+          0, files.size(),
+          [&files, &entries, &good](const size_t start, const size_t end) {
+            for (size_t i = start; i < end; ++i) {
+              entries[i].path = files[i];
+              if (read_ats_header_block(files[i], entries[i].header)) {
+                entries[i].decode();
+                good[i] = 1;
+              }
+            }
+          },
+          blocks)
+      .wait();
+
+  size_t n = 0;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (!good[i]) {
+      messages += "can not read header " + files[i].string() + ";";
+      continue;
+    }
+    if (n != i)
+      entries[n] = std::move(entries[i]);
+    ++n;
+  }
+  entries.resize(n);
+  return entries;
+}
+
+/*!
+ * \brief scan_ats_headers same for a directory tree
+ */
+inline std::vector<ats_scan_entry> scan_ats_headers(const fs::path &dir_or_file, std::shared_ptr<BS::thread_pool> &pool, std::string &messages) {
+  return scan_ats_headers(find_ats_files(dir_or_file), pool, messages);
+}
+
+#endif // ATS_HEADER_SCAN_H
@@ -1,6 +1,7 @@
 #ifndef ATSHEADER
 #define ATSHEADER
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
@@ -68,6 +69,17 @@ public:
   atsheader(const fs::path &filename, const bool close_after_read = true) {
     this->read(filename, close_after_read);
   }
+
+  /*!
+   * \brief atsheader from an already read binary header, e.g. from scan_ats_headers (ats_header_scan.h); the file is not touched
+   * \param header binary header
+   * \param filename the file the header belongs to
+   */
+  atsheader(const ATSHeader_80 &header, const fs::path &filename) {
+    this->header = header;
+    this->filename = filename;
+    this->header_read = true;
+  }
   /*!
    * \brief atsheadercopy constructor
    * \param rhs
@@ -75,6 +87,7 @@ public:
   atsheader(const atsheader &rhs) {
     this->header = rhs.header;
     this->filename = rhs.filename;
+    this->header_read = rhs.header_read;
   }
 
   /*!
@@ -84,6 +97,7 @@ public:
   atsheader(const std::shared_ptr<atsheader> &rhs) {
     this->header = rhs->header;
     this->filename = rhs->filename;
+    this->header_read = rhs->header_read;
   }
 
   void close() {
@@ -112,6 +126,7 @@ public:
     this->file.open(this->filename, std::ios::in | std::ios::binary);
     if (this->file.is_open()) {
       this->file.read((char *)&this->header, sizeof(this->header));
+      this->header_read = true;
     }
     if (close_after_read)
       this->file.close();
@@ -313,10 +328,18 @@ public:
   }
 
   double calc_lsb_from_dbl_vec_mV(const std::vector<double> &ddata) {
-    double lsb = 0.0;
+    if (!ddata.size())
+      return this->calc_lsb_from_min_max_mV(0.0, 0.0);
     auto minmax = minmax_element(ddata.cbegin(), ddata.cend());
-    lsb = (2 * (minmax.second - minmax.first)) / pow(2, 32);
-    this->header.lsbval = lsb;
+    return this->calc_lsb_from_min_max_mV(*minmax.first, *minmax.second);
+  }
+
+  /*!
+   * \brief calc_lsb_from_min_max_mV LSB so that the largest absolute value uses half of the int32 range; 1 for all zero data
+   */
+  double calc_lsb_from_min_max_mV(const double &min, const double &max) {
+    const double max_abs = std::max(std::abs(min), std::abs(max));
+    this->header.lsbval = (max_abs > 0.0) ? (4.0 * max_abs) / pow(2, 32) : 1.0;
     return this->header.lsbval;
   }
 
@@ -327,30 +350,24 @@ public:
     if (!ints_doubles.size())
       return 0;
 
+    // convert into one buffer and write it at once
+    std::vector<int32_t> idata32(ints_doubles.size());
     if (typeid(ints_doubles.at(0)) == typeid(int32_t)) {
       if (lsbval == this->header.lsbval) {
-        int32_t idata32;
-        for (const auto &idata : ints_doubles) {
-          idata32 = idata;
-          this->file.write(static_cast<char *>(static_cast<void *>(&idata32)), 4);
-        }
+        std::transform(ints_doubles.cbegin(), ints_doubles.cend(), idata32.begin(), [](const T &idata) { return int32_t(idata); });
       } else {
-        int32_t idata32;
-        for (const auto &idata : ints_doubles) {
-          double val = idata * lsbval;
-          idata32 = int32_t(val / this->header.lsbval);
-          this->file.write(static_cast<char *>(static_cast<void *>(&idata32)), 4);
-        }
+        const double lsb = this->header.lsbval;
+        std::transform(ints_doubles.cbegin(), ints_doubles.cend(), idata32.begin(), [lsbval, lsb](const T &idata) { return int32_t((idata * lsbval) / lsb); });
       }
     }
 
     else if (typeid(ints_doubles.at(0)) == typeid(double)) {
-      int32_t idata32;
-      for (const auto &data : ints_doubles) {
-        idata32 = int32_t(data / this->header.lsbval);
-        this->file.write(static_cast<char *>(static_cast<void *>(&idata32)), 4);
-      }
+      const double lsb = this->header.lsbval;
+      std::transform(ints_doubles.cbegin(), ints_doubles.cend(), idata32.begin(), [lsb](const T &data) { return int32_t(data / lsb); });
+    } else {
+      return 0;
     }
+    this->file.write(reinterpret_cast<const char *>(idata32.data()), std::streamsize(idata32.size() * sizeof(int32_t)));
 
     if (close_after_write)
       this->file.close();
@@ -471,9 +488,17 @@ public:
     this->filename = filename;
   }
 
+  /*!
+   * \brief has_header true after read() or when constructed from a binary header
+   */
+  bool has_header() const {
+    return this->header_read;
+  }
+
 private:
   std::fstream file;
   fs::path filename;
+  bool header_read = false; //!< header contains the data of filename
   uint64_t count_ats_read_ints_doubles = 0;
 };
 
@@ -1,11 +1,14 @@
 #ifndef ATSS_H
 #define ATSS_H
 
+#include "ascii_io.h"
 #include "atmm.h"
+#include "atss_header.h"
 #include "base_constants.h"
 #include "cal_base.h"
 #include "freqs.h"
 #include "json.h"
+#include "profiler.h"
 #include "strings_etc.h"
 #include <bitset>
 #include <chrono>
@@ -412,32 +415,21 @@ public:
 
     if (this->parse_json_filename(json_file)) {
       std::ifstream file;
-      file.open(json_file, std::fstream::in);
+      file.open(json_file, std::fstream::in | std::fstream::binary);
       if (!file.is_open()) {
         file.close();
         return;
       }
-      nlohmann::ordered_json head = nlohmann::ordered_json::parse(file);
+      std::string text;
+      file.seekg(0, std::ios::end);
+      text.resize(size_t(file.tellg()));
+      file.seekg(0, std::ios::beg);
+      file.read(text.data(), std::streamsize(text.size()));
       file.close();
-      if (head.contains("latitude") && head.contains("longitude") && head.contains("elevation")) {
-        this->set_lat_lon_elev(head["latitude"], head["longitude"], head["elevation"]);
-      }
-      this->pt.time_t_iso_8601_str_fracs(head["datetime"]);
+      this->from_header_string(text, json_file);
       this->filepath_wo_ext = json_file;
       this->filepath_wo_ext.replace_extension("");
       this->samples(this->filepath_wo_ext);
-      if (head.contains("angle"))
-        this->angle = head["angle"];
-      if (head.contains("tilt"))
-        this->tilt = head["tilt"];
-      if (head.contains("resistance"))
-        this->tilt = head["resistance"];
-      if (head.contains("units"))
-        this->units = head["units"];
-      if (head.contains("filter"))
-        this->filter = head["filter"];
-      if (head.contains("source"))
-        this->source = head["source"];
       // check if the atss file exists
       if (!std::filesystem::exists(atss_file)) {
         std::cerr << "atss file does not exist " << atss_file << std::endl;
@@ -447,10 +439,66 @@ public:
         auto xx = std::filesystem::file_size(atss_file);
         this->pt.samples = xx / sizeof(double);
       }
-      if (this->cal != nullptr)
-        this->cal.reset();
-      this->cal = std::make_shared<calibration>();
-      this->cal->parse_head(head, json_file);
+    }
+  }
+
+  /*!
+   * \brief from_header_string sets time, position, sensor values and calibration from the JSON header text; file name values (serial, system, channel, sample rate) are not touched
+   * \param text header as written by header_string
+   * \param origin for error messages and the calibration check, e.g. the json file
+   */
+  void from_header_string(const std::string &text, const std::filesystem::path &origin = "") {
+    // fast path for our own schema; anything unexpected goes through nlohmann
+    atss_header head;
+    if (!head.parse(text))
+      head.from_json(nlohmann::ordered_json::parse(text));
+    if (head.has(atss_header::k_latitude) && head.has(atss_header::k_longitude) && head.has(atss_header::k_elevation)) {
+      this->set_lat_lon_elev(head.latitude, head.longitude, head.elevation);
+    }
+    if (!head.has(atss_header::k_datetime)) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::no datetime in " << origin;
+      throw std::runtime_error(err_str.str());
+    }
+    this->pt.time_t_iso_8601_str_fracs(head.datetime);
+    if (head.has(atss_header::k_angle))
+      this->angle = head.angle;
+    if (head.has(atss_header::k_tilt))
+      this->tilt = head.tilt;
+    if (head.has(atss_header::k_resistance))
+      this->resistance = head.resistance;
+    if (head.has(atss_header::k_units))
+      this->units = head.units;
+    if (head.has(atss_header::k_filter))
+      this->filter = head.filter;
+    if (head.has(atss_header::k_source))
+      this->source = head.source;
+    if (this->cal != nullptr)
+      this->cal.reset();
+    this->cal = std::make_shared<calibration>();
+    if (head.has(atss_header::k_sensor_calibration)) {
+      // same as calibration::parse_head
+      if (head.has(atss_header::k_cal_sensor))
+        this->cal->sensor = head.cal_sensor;
+      this->cal->serial = head.cal_serial;
+      this->cal->chopper = (head.cal_chopper == 1) ? ChopperStatus::on : ChopperStatus::off;
+      if (head.has(atss_header::k_cal_units_frequency))
+        this->cal->units_frequency = head.cal_units_frequency;
+      if (head.has(atss_header::k_cal_units_amplitude))
+        this->cal->units_amplitude = head.cal_units_amplitude;
+      if (head.has(atss_header::k_cal_units_phase))
+        this->cal->units_phase = head.cal_units_phase;
+      if (head.has(atss_header::k_cal_datetime))
+        this->cal->datetime = head.cal_datetime;
+      if (head.has(atss_header::k_cal_Operator))
+        this->cal->Operator = head.cal_Operator;
+      if (head.has(atss_header::k_cal_f))
+        this->cal->f = std::move(head.cal_f);
+      if (head.has(atss_header::k_cal_a))
+        this->cal->a = std::move(head.cal_a);
+      if (head.has(atss_header::k_cal_p))
+        this->cal->p = std::move(head.cal_p);
+      this->cal->check_head(origin);
     }
   }
 
@@ -494,13 +542,13 @@ public:
     this->set_channel_no(channel_no);
   }
   /*!
-   * \brief parse_json_filename - put it in a try block
-   * \param in_json_file
-   * \return
+   * \brief parse_json_filename serial, system, channel number, type and sample rate from the file name
+   * \param in_json_file file name like 084_ADU-07e_C000_TEx_512Hz.json
+   * \param must_exist false for channels without files, e.g. from an HDF5 container
    */
-  bool parse_json_filename(const std::filesystem::path &in_json_file) {
+  bool parse_json_filename(const std::filesystem::path &in_json_file, const bool must_exist = true) {
 
-    if (!std::filesystem::exists(in_json_file)) {
+    if (must_exist && !std::filesystem::exists(in_json_file)) {
       std::ostringstream err_str((std::string("channel::") + __func__), std::ios_base::ate);
       err_str << "::file not exists " << in_json_file;
       throw std::runtime_error(err_str.str());
@@ -550,6 +598,15 @@ public:
     return this->filepath_wo_ext;
   }
 
+  /*!
+   * \brief prof_name station/run/file name for the profiler; empty if profiling is off (no string work on the hot path)
+   */
+  std::string prof_name() const {
+    if (!mtprof::enabled())
+      return std::string();
+    return (this->get_site_name() / this->filepath_wo_ext.parent_path().filename() / this->filepath_wo_ext.filename()).string();
+  }
+
   std::filesystem::path get_run_dir() const {
     return this->filepath_wo_ext.parent_path();
   }
@@ -776,33 +833,10 @@ public:
    * \param jsn_cal the calibration part, in case you have a calibration object from outside
    */
   std::filesystem::path write_header(const std::shared_ptr<calibration> &jsn_cal = nullptr) {
-    jsn head;
-    head["datetime"] = this->start_datetime();
-    head["latitude"] = this->latitude;
-    head["longitude"] = this->longitude;
-    head["elevation"] = this->elevation;
-    head["angle"] = this->angle;
-    head["tilt"] = this->tilt;
-    head["resistance"] = this->resistance;
-    head["units"] = this->units;
-    head["filter"] = this->filter;
-    head["source"] = this->source;
-    if (jsn_cal != nullptr)
-      head.update(jsn_cal->toJson_embedd());
-    else if (this->cal != nullptr)
-      head.update(this->cal->toJson_embedd());
-    else {
-      this->cal = std::make_shared<calibration>();
-      head.update(this->cal->toJson_embedd());
-    }
-
-    std::filesystem::path filepath = this->filepath_wo_ext;
-    if (std::filesystem::is_directory(filepath))
-      filepath /= this->filename(".json");
-    else
-      filepath.replace_extension(".json");
+    std::filesystem::path filepath = this->header_filepath();
+    std::string head = this->header_string(jsn_cal);
     std::ofstream file;
-    file.open(filepath, std::fstream::out | std::fstream::trunc);
+    file.open(filepath, std::fstream::out | std::fstream::trunc | std::fstream::binary);
 
     if (!file.is_open()) {
       file.close();
@@ -811,12 +845,68 @@ public:
       throw std::runtime_error(err_str.str());
     }
 
-    file << std::setw(2) << head << std::endl;
+    file.write(head.data(), std::streamsize(head.size()));
     file.close();
 
     return filepath;
   }
 
+  /*!
+   * \brief write_header for bulk creation: the header is serialized here and written by the background thread of the writer; call writer.flush() before reading
+   * \param writer shared by all channels
+   * \param jsn_cal the calibration part, in case you have a calibration object from outside
+   */
+  std::filesystem::path write_header(atss_header_writer &writer, const std::shared_ptr<calibration> &jsn_cal = nullptr) {
+    std::filesystem::path filepath = this->header_filepath();
+    writer.push(filepath, this->header_string(jsn_cal));
+    return filepath;
+  }
+
+  /*!
+   * \brief header_string JSON header as written to file
+   * \param jsn_cal the calibration part, in case you have a calibration object from outside
+   */
+  std::string header_string(const std::shared_ptr<calibration> &jsn_cal = nullptr) {
+    atss_header head;
+    head.datetime = this->start_datetime();
+    head.latitude = this->latitude;
+    head.longitude = this->longitude;
+    head.elevation = this->elevation;
+    head.angle = this->angle;
+    head.tilt = this->tilt;
+    head.resistance = this->resistance;
+    head.units = this->units;
+    head.filter = this->filter;
+    head.source = this->source;
+    if (jsn_cal == nullptr && this->cal == nullptr)
+      this->cal = std::make_shared<calibration>();
+    const auto &c = (jsn_cal != nullptr) ? jsn_cal : this->cal;
+    head.cal_sensor = c->sensor;
+    head.cal_serial = c->serial;
+    head.cal_chopper = int(c->chopper);
+    head.cal_units_frequency = c->units_frequency;
+    head.cal_units_amplitude = c->units_amplitude;
+    head.cal_units_phase = c->units_phase;
+    head.cal_datetime = c->datetime;
+    head.cal_Operator = c->Operator;
+    head.cal_f = c->f;
+    head.cal_a = c->a;
+    head.cal_p = c->p;
+    return head.serialize();
+  }
+
+  /*!
+   * \brief header_filepath the .json file of this channel
+   */
+  std::filesystem::path header_filepath() const {
+    std::filesystem::path filepath = this->filepath_wo_ext;
+    if (std::filesystem::is_directory(filepath))
+      filepath /= this->filename(".json");
+    else
+      filepath.replace_extension(".json");
+    return filepath;
+  }
+
   bool write_data(const std::vector<double> &data) {
     // write a slice in case
     if (this->outfile.is_open()) {
@@ -882,11 +972,13 @@ public:
     return this->write_all_data(this->ts_slice);
   }
 
-  void to_ascii(const std::filesystem::path &outdir = "") {
-    this->ts_slice.clear();
-    this->ts_slice.resize(1024);
-    this->ts_chunk.clear(); // no overlapping
-
+  /*!
+   * \brief to_ascii writes the samples as single column ASCII (.dat); the binary is read in large chunks, formatted in parallel (std::to_chars)
+   * \param outdir empty: next to the atss file
+   * \param pool nullptr: a pool is created for the call
+   * \param precision as std::ostream::precision (default 6 as before), 0 for the shortest exact representation
+   */
+  void to_ascii(const std::filesystem::path &outdir = "", std::shared_ptr<BS::thread_pool> pool = nullptr, const int precision = 6) {
     std::filesystem::path filepath = this->filepath_wo_ext;
     filepath.replace_extension(".dat");
     if (outdir != std::filesystem::path())
@@ -900,11 +992,15 @@ public:
       err_str << "::file not open " << filepath;
       throw std::runtime_error(err_str.str());
     }
-    while (this->read_data(true) != -1) {
-      for (auto dat : this->ts_slice) {
-        file_dat << dat << std::endl;
-      }
+    std::ifstream file_bin(this->get_atss_filepath(), std::ios::in | std::ios::binary);
+    if (!file_bin.is_open()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::file not open " << this->get_atss_filepath();
+      throw std::runtime_error(err_str.str());
     }
+    if (pool == nullptr)
+      pool = std::make_shared<BS::thread_pool>();
+    binary_to_ascii(file_bin, file_dat, pool, precision);
     file_dat.close();
   }
 
@@ -1146,13 +1242,18 @@ public:
    */
   void read_all_fftw(const bool read_last_chunk = false, const std::shared_ptr<atmm> &sel = nullptr) {
     int64_t reads = 0;
+    mtprof::scoped_timer prof("read_all_fftw", this->prof_name());
+    mtprof::section_timer t_read, t_fft;
     // clear the queue
     while (!this->qspc.empty())
       this->qspc.pop();
     do {
 
+      t_read.begin();
       reads = this->read_data(read_last_chunk, sel);
+      t_read.end();
       if (reads > 0) {
+        t_fft.begin();
         detrend_and_hanning<double>(this->ts_slice.begin(), this->ts_slice.end());
         if (this->ts_slice_padded.size()) {
           // this->ts_slice_padded.insert(this->ts_slice_padded.begin(), this->ts_slice.cbegin(), this->ts_slice.cend());
@@ -1161,12 +1262,24 @@ public:
           }
         }
         fftw_execute(this->plan);
+        t_fft.end();
         this->qspc.push(this->spc_slice);
       }
 
     } while (reads > 0);
     if (this->infile.is_open())
       this->infile.close();
+    if (prof.is_active()) {
+      const double bytes = double(this->qspc.size() * this->fft_freqs->get_rl() * sizeof(double));
+      prof.arg("windows", double(this->qspc.size()));
+      prof.arg("bytes", bytes);
+      prof.arg("read_ms", t_read.ms());
+      prof.arg("fft_ms", t_fft.ms());
+      mtprof::count("read bytes", bytes);
+      mtprof::count("fft windows", double(this->qspc.size()));
+      mtprof::count("fft ms", t_fft.ms());
+      mtprof::count("read ms", t_read.ms());
+    }
   }
 
   void read_all_fftw_gaussian_noise(const std::vector<double> double_noise, const bool bdetrend_hanning = true) {
@@ -1228,6 +1341,8 @@ public:
    * \param bcal
    */
   void prepare_raw_spc(const bool bcal = true, const bool bwincal = true) {
+    mtprof::scoped_timer prof("prepare_raw_spc", this->prof_name());
+    prof.arg("windows", double(this->qspc.size()));
     this->spc.reserve(this->qspc.size());
     size_t j = 0;
     bool bcaldata = bcal;
@@ -1263,6 +1378,78 @@ public:
 
     return;
   }
+  /*!
+   * \brief read_fftw_window reads ONE window and returns the trimmed spectrum, calibrated and scaled like prepare_raw_spc; nothing is queued
+   * used for online stacking where the spectra are consumed as produced; the file is closed at the end
+   * \param out trimmed spectrum of the window
+   * \param bcal divide by calibration; YOU MUST interpolate / extend the calibration to the same length as the FFT in ADVANCE
+   * \param bwincal scale with the window calibration
+   * \return same as read_data, <= 0 at the end
+   */
+  int64_t read_fftw_window(std::vector<std::complex<double>> &out, const bool bcal = true, const bool bwincal = true) {
+    int64_t reads = this->read_data(false, nullptr);
+    if (reads <= 0) {
+      if (this->infile.is_open())
+        this->infile.close();
+      return reads;
+    }
+    this->fftw_window(out, bcal, bwincal);
+    return reads;
+  }
+
+  /*!
+   * \brief read_window reads the next read length samples into data, NOT into ts_slice; the reading thread of a window pipeline
+   * does not touch the fftw arrays, so fftw_window can run in parallel on the previous window; no overlapping chunks (ts_chunk)
+   * \param data resized to the read length if needed
+   * \return same as read_data, <= 0 at the end; the file is closed at the end
+   */
+  int64_t read_window(std::vector<double> &data) {
+    if (this->ts_chunk.size()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << " :: overlapping chunks can not be read into a separate buffer";
+      throw std::runtime_error(err_str.str());
+    }
+    if (data.size() != this->fft_freqs->get_rl())
+      data.resize(this->fft_freqs->get_rl());
+    int64_t reads = -1;
+    if (this->infile.is_open() || this->open_atss_read())
+      reads = this->read_bin(data, this->infile, false);
+    if ((reads <= 0) && this->infile.is_open())
+      this->infile.close();
+    return reads;
+  }
+
+  /*!
+   * \brief fftw_window transforms ts_slice (filled by read_data or copied from read_window) to the trimmed spectrum, calibrated and scaled like prepare_raw_spc
+   * \param out trimmed spectrum of the window
+   * \param bcal divide by calibration
+   * \param bwincal scale with the window calibration
+   */
+  void fftw_window(std::vector<std::complex<double>> &out, const bool bcal = true, const bool bwincal = true) {
+    detrend_and_hanning<double>(this->ts_slice.begin(), this->ts_slice.end());
+    if (this->ts_slice_padded.size()) {
+      for (size_t i = 0; i < ts_slice.size(); ++i) {
+        this->ts_slice_padded[i] = ts_slice[i]; // copy first part; rest is zero
+      }
+    }
+    fftw_execute(this->plan);
+    this->fft_freqs->trim_fftw_result(this->spc_slice, out);
+    if (bcal && (this->cal != nullptr) && this->cal->f.size()) {
+      // fetch interpolated calibration data first time
+      if (this->caldata.size() != out.size()) {
+        if (this->cal->f.size() != out.size()) {
+          std::ostringstream err_str(__func__, std::ios_base::ate);
+          err_str << " :: calibration size is smaller than FFT size " << this->cal->f.size() << " " << out.size();
+          throw std::runtime_error(err_str.str());
+        }
+        this->cal->get_cplx_cal(this->caldata_f, this->caldata);
+      }
+      std::transform(out.begin(), out.end(), this->caldata.begin(), out.begin(), std::divides<std::complex<double>>());
+    }
+    if (bwincal)
+      this->fft_freqs->scale(out);
+  }
+
   void prepare_to_raw_spc(const std::shared_ptr<fftw_freqs> &in_fft_freqs, const bool bcal = true, const bool bwincal = true) {
     this->spc.reserve(this->qspc.size());
     size_t j = 0;
@@ -0,0 +1,301 @@
+#ifndef ATSS_FOLLOW_H
+#define ATSS_FOLLOW_H
+
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "atss.h"
+#include "stack_accumulators.h"
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+/*!
+ * @file atss_follow.h
+ * @brief tail-following reader for a growing .atss file (e.g. streamed by rsync or WebDAV from an observatory)
+ * the atss file is append only - the JSON header stays untouched - so we only have to watch the file size
+ */
+
+/*!
+ * \brief The atss_follow class watches a growing .atss file and yields every complete window as soon as it has been written.
+ * The channel must have been initialized with init_fftw; the follower uses the plan and the slices of the channel.
+ * Each window is detrended, hanning windowed, transformed, trimmed and scaled like prepare_raw_spc does it,
+ * and added to a running stack (complex mean and auto power, see stack_accumulators.h). The cost per update is constant, independent of the file length.
+ * On Linux inotify is used for waking up; we always fall back to polling the file size, because rsync / network mounts
+ * do not necessarily deliver inotify events.
+ */
+class atss_follow {
+
+public:
+  /*!
+   * \brief atss_follow
+   * \param chan channel with initialized fftw (init_fftw)
+   * \param hop samples to advance per window; 0 means rl (no overlap), rl/2 means 50% overlap
+   * \param bcal divide by the calibration (same as prepare_raw_spc); the calibration must be interpolated to the fft frequencies in advance
+   * \param bwincal scale with the window calibration
+   */
+  atss_follow(std::shared_ptr<channel> &chan, const size_t &hop = 0, const bool bcal = false, const bool bwincal = true) : chan(chan), bcal(bcal), bwincal(bwincal) {
+    if (this->chan == nullptr)
+      throw std::runtime_error("atss_follow: channel is nullptr");
+    if (this->chan->fft_freqs == nullptr) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::init_fftw the channel first " << this->chan->get_atss_filepath();
+      throw std::runtime_error(err_str.str());
+    }
+    this->rl = this->chan->fft_freqs->get_rl();
+    this->hop = hop ? hop : this->rl;
+    if (this->hop > this->rl) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::hop " << this->hop << " larger than read length " << this->rl;
+      throw std::runtime_error(err_str.str());
+    }
+    if (this->bcal) {
+      if ((this->chan->cal == nullptr) || (this->chan->cal->f.size() != this->chan->fft_freqs->get_fl())) {
+        std::cerr << "atss_follow: no fitting calibration data for " << this->chan->filename() << ", calibration is off" << std::endl;
+        this->bcal = false;
+      } else
+        this->chan->cal->get_cplx_cal(this->chan->caldata_f, this->chan->caldata);
+    }
+    this->window.resize(this->rl);
+    this->atss_file = this->chan->get_atss_filepath();
+    this->init_watch();
+  }
+
+  ~atss_follow() {
+    if (this->infile.is_open())
+      this->infile.close();
+#if defined(__linux__)
+    if (this->inotify_fd >= 0)
+      close(this->inotify_fd);
+#endif
+  }
+
+  /*!
+   * \brief poll_windows reads all complete windows available now - does not block
+   * \param on_window called for each window with the trimmed and scaled spectrum; chan->ts_slice contains the windowed time series
+   * \return number of new windows
+   */
+  size_t poll_windows(const std::function<void(const std::vector<std::complex<double>> &)> &on_window = nullptr) {
+    size_t new_windows = 0;
+    uintmax_t bytes = 0;
+    try {
+      bytes = std::filesystem::file_size(this->atss_file);
+    } catch (std::filesystem::filesystem_error &e) {
+      return 0; // file may not exist yet
+    }
+    size_t avail = size_t(bytes / sizeof(double));
+    this->chan->pt.samples = avail;
+    if (avail < this->next_pos + this->rl)
+      return 0;
+
+    if (!this->infile.is_open()) {
+      this->infile.open(this->atss_file, std::ios::in | std::ios::binary);
+      if (!this->infile.is_open()) {
+        std::ostringstream err_str(__func__, std::ios_base::ate);
+        err_str << "::can not open " << this->atss_file;
+        throw std::runtime_error(err_str.str());
+      }
+    }
+
+    while (avail >= this->next_pos + this->rl) {
+      this->read_window();
+      this->fft_window();
+      if (on_window != nullptr)
+        on_window(this->spc);
+      this->next_pos += this->hop;
+      ++new_windows;
+    }
+    return new_windows;
+  }
+
+  /*!
+   * \brief wait_for_data blocks until the file has been modified or the timeout expired
+   * \param timeout maximum wait; this is also the polling interval if inotify is not available
+   * \return true if woken by inotify, false on timeout / polling
+   */
+  bool wait_for_data(const std::chrono::milliseconds &timeout) {
+#if defined(__linux__)
+    if (this->inotify_fd >= 0) {
+      struct pollfd pfd;
+      pfd.fd = this->inotify_fd;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      int ret = poll(&pfd, 1, int(timeout.count()));
+      if (ret > 0 && (pfd.revents & POLLIN)) {
+        // drain the events; we only need the wake up
+        char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        while (read(this->inotify_fd, buf, sizeof(buf)) > 0)
+          ;
+        return true;
+      }
+      return false;
+    }
+#endif
+    std::this_thread::sleep_for(timeout);
+    return false;
+  }
+
+  /*!
+   * \brief follow loops until stop is set or no new data arrived for idle_timeout
+   * \param on_window see poll_windows
+   * \param stop set from another thread to terminate
+   * \param poll_interval wake up interval in case no inotify event arrives
+   * \param idle_timeout terminate after this time without new data; zero means wait for ever (until stop)
+   * \return total number of windows
+   */
+  size_t follow(const std::function<void(const std::vector<std::complex<double>> &)> &on_window, const std::atomic<bool> &stop,
+                const std::chrono::milliseconds &poll_interval = std::chrono::milliseconds(500),
+                const std::chrono::milliseconds &idle_timeout = std::chrono::milliseconds(0)) {
+    auto last_data = std::chrono::steady_clock::now();
+    while (!stop) {
+      if (this->poll_windows(on_window))
+        last_data = std::chrono::steady_clock::now();
+      else if (idle_timeout.count() && (std::chrono::steady_clock::now() - last_data) > idle_timeout)
+        break;
+      this->wait_for_data(poll_interval);
+    }
+    return this->stacks;
+  }
+
+  /*!
+   * \brief get_stacked_spectra mean of the complex spectra so far
+   */
+  std::vector<std::complex<double>> get_stacked_spectra() const {
+    return this->mean_spc.mean();
+  }
+
+  /*!
+   * \brief get_psd stacked auto power spectral density (mean of |X|²) so far
+   */
+  std::vector<double> get_psd() const {
+    return this->mean_pow.mean();
+  }
+
+  /*!
+   * \brief get_abs_stacked_spectra amplitude spectra sqrt(psd) - comparable with the sa spectra of raw_spectra
+   */
+  std::vector<double> get_abs_stacked_spectra() const {
+    auto out = this->get_psd();
+    for (auto &v : out)
+      v = std::sqrt(v);
+    return out;
+  }
+
+  size_t get_stacks() const {
+    return this->stacks;
+  }
+
+  /*!
+   * \brief get_next_pos sample position of the next window to read
+   */
+  size_t get_next_pos() const {
+    return this->next_pos;
+  }
+
+  /*!
+   * \brief set_start_pos start following at a sample position, e.g. skip what has been processed before; resets the stacks
+   */
+  void set_start_pos(const size_t &sample_pos) {
+    this->next_pos = sample_pos;
+    this->reset_stacks();
+  }
+
+  void reset_stacks() {
+    this->stacks = 0;
+    this->mean_spc.clear();
+    this->mean_pow.clear();
+  }
+
+  bool uses_inotify() const {
+    return (this->inotify_fd >= 0);
+  }
+
+private:
+  void init_watch() {
+#if defined(__linux__)
+    this->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (this->inotify_fd < 0)
+      return;
+    // watch the run directory - the atss file may not exist yet
+    std::filesystem::path watch_dir = this->atss_file.parent_path();
+    if (watch_dir.empty())
+      watch_dir = ".";
+    if (inotify_add_watch(this->inotify_fd, watch_dir.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO) < 0) {
+      close(this->inotify_fd);
+      this->inotify_fd = -1;
+    }
+#endif
+  }
+
+  void read_window() {
+    // the stream may be at EOF from the last read - clear and seek absolute
+    this->infile.clear();
+    this->infile.seekg(std::streamoff(this->next_pos * sizeof(double)), std::ios::beg);
+    this->infile.read(reinterpret_cast<char *>(this->window.data()), std::streamsize(this->rl * sizeof(double)));
+    if (this->infile.gcount() != std::streamsize(this->rl * sizeof(double))) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::short read at sample " << this->next_pos << " " << this->atss_file;
+      throw std::runtime_error(err_str.str());
+    }
+    this->chan->read_pos.first = int64_t(this->next_pos);
+    this->chan->read_pos.second = int64_t(this->next_pos + this->rl);
+    this->chan->read_count++;
+  }
+
+  void fft_window() {
+    auto &c = this->chan;
+    std::copy(this->window.begin(), this->window.end(), c->ts_slice.begin());
+    detrend_and_hanning<double>(c->ts_slice.begin(), c->ts_slice.end());
+    if (c->ts_slice_padded.size()) {
+      std::copy(c->ts_slice.begin(), c->ts_slice.end(), c->ts_slice_padded.begin());
+    }
+    fftw_execute(c->plan);
+    // spc_slice is owned by the fftw plan - trim into our own vector
+    this->spc = c->fft_freqs->trim_fftw_result(c->spc_slice);
+    if (this->bcal) {
+      std::transform(this->spc.begin(), this->spc.end(), c->caldata.begin(), this->spc.begin(), std::divides<std::complex<double>>());
+    }
+    if (this->bwincal)
+      c->fft_freqs->scale(this->spc);
+
+    this->pow.resize(this->spc.size());
+    for (size_t i = 0; i < this->spc.size(); ++i)
+      this->pow[i] = std::norm(this->spc[i]);
+    this->mean_spc.add(this->spc);
+    this->mean_pow.add(this->pow);
+    ++this->stacks;
+  }
+
+  std::shared_ptr<channel> chan;                //!< channel with fftw plan
+  std::filesystem::path atss_file;              //!< the growing file
+  std::ifstream infile;                         //!< kept open between updates
+  std::vector<double> window;                   //!< raw window as read from the file
+  std::vector<std::complex<double>> spc;        //!< trimmed and scaled spectrum of the last window
+  std::vector<double> pow;                      //!< auto power of the last window
+  welford_accumulator<std::complex<double>> mean_spc; //!< running mean of the complex spectra
+  welford_accumulator<double> mean_pow;         //!< running mean of the auto power
+  size_t rl = 0;                                //!< read length
+  size_t hop = 0;                               //!< advance per window
+  size_t next_pos = 0;                          //!< sample position of the next window
+  size_t stacks = 0;                            //!< windows stacked
+  bool bcal = false;                            //!< divide by calibration
+  bool bwincal = true;                          //!< scale by window calibration
+  int inotify_fd = -1;                          //!< inotify handle or -1 for polling
+};
+
+#endif // ATSS_FOLLOW_H
@@ -0,0 +1,650 @@
+#ifndef ATSS_HEADER_H
+#define ATSS_HEADER_H
+
+#include <charconv>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "json.h"
+
+/*!
+ * @file atss_header.h
+ * @brief fast path for the fixed schema JSON header of the atss format; nlohmann::json stays the fallback for anything unexpected
+ * the header is tiny and always the same: a few numbers and strings and the sensor_calibration with three vectors
+ */
+
+/*!
+ * \brief The atss_header struct is the content of the .json file of a channel; the names are the JSON keys
+ */
+struct atss_header {
+
+  /*!
+   * \brief keys found while parsing; the channel only overwrites what is present
+   */
+  enum key : uint32_t {
+    k_datetime = 1u << 0,
+    k_latitude = 1u << 1,
+    k_longitude = 1u << 2,
+    k_elevation = 1u << 3,
+    k_angle = 1u << 4,
+    k_tilt = 1u << 5,
+    k_resistance = 1u << 6,
+    k_units = 1u << 7,
+    k_filter = 1u << 8,
+    k_source = 1u << 9,
+    k_sensor_calibration = 1u << 10,
+    k_cal_sensor = 1u << 11,
+    k_cal_serial = 1u << 12,
+    k_cal_chopper = 1u << 13,
+    k_cal_units_frequency = 1u << 14,
+    k_cal_units_amplitude = 1u << 15,
+    k_cal_units_phase = 1u << 16,
+    k_cal_datetime = 1u << 17,
+    k_cal_Operator = 1u << 18,
+    k_cal_f = 1u << 19,
+    k_cal_a = 1u << 20,
+    k_cal_p = 1u << 21
+  };
+
+  std::string datetime;
+  double latitude = 0.0;
+  double longitude = 0.0;
+  double elevation = 0.0;
+  double angle = 0.0;
+  double tilt = 0.0;
+  double resistance = 0.0;
+  std::string units;
+  std::string filter;
+  std::string source;
+
+  std::string cal_sensor;
+  uint64_t cal_serial = 0;
+  int64_t cal_chopper = 0;
+  std::string cal_units_frequency;
+  std::string cal_units_amplitude;
+  std::string cal_units_phase;
+  std::string cal_datetime;
+  std::string cal_Operator;
+  std::vector<double> cal_f;
+  std::vector<double> cal_a;
+  std::vector<double> cal_p;
+
+  uint32_t present = 0; //!< bit mask of key
+
+  bool has(const key k) const {
+    return (this->present & k);
+  }
+
+  /*!
+   * \brief parse fast parser for exactly this schema
+   * \param text content of the json file
+   * \return false if anything is not known (key, type, escape sequence) - use from_json with nlohmann then
+   */
+  bool parse(std::string_view text);
+
+  /*!
+   * \brief from_json fallback, same meaning as parse
+   */
+  void from_json(const nlohmann::ordered_json &head);
+
+  /*!
+   * \brief serialize same layout as nlohmann dump with indent 2; numbers are written shortest round trip (nlohmann sometimes uses one digit more)
+   */
+  std::string serialize() const;
+};
+
+namespace atss_header_detail {
+
+class reader {
+public:
+  reader(std::string_view text) : s(text) {
+  }
+
+  void ws() {
+    while (this->pos < this->s.size() && (this->s[pos] == ' ' || this->s[pos] == '\n' || this->s[pos] == '\r' || this->s[pos] == '\t'))
+      ++this->pos;
+  }
+
+  bool expect(const char c) {
+    this->ws();
+    if (this->pos < this->s.size() && this->s[this->pos] == c) {
+      ++this->pos;
+      return true;
+    }
+    return false;
+  }
+
+  bool at_end() {
+    this->ws();
+    return (this->pos == this->s.size());
+  }
+
+  bool string(std::string &out) {
+    if (!this->expect('"'))
+      return false;
+    out.clear();
+    while (this->pos < this->s.size()) {
+      const char c = this->s[this->pos++];
+      if (c == '"')
+        return true;
+      if (c != '\\') {
+        out.push_back(c);
+        continue;
+      }
+      if (this->pos >= this->s.size())
+        return false;
+      switch (this->s[this->pos++]) {
+      case '"':
+        out.push_back('"');
+        break;
+      case '\\':
+        out.push_back('\\');
+        break;
+      case '/':
+        out.push_back('/');
+        break;
+      case 'b':
+        out.push_back('\b');
+        break;
+      case 'f':
+        out.push_back('\f');
+        break;
+      case 'n':
+        out.push_back('\n');
+        break;
+      case 'r':
+        out.push_back('\r');
+        break;
+      case 't':
+        out.push_back('\t');
+        break;
+      default:
+        return false; // \u and others: let nlohmann do that
+      }
+    }
+    return false;
+  }
+
+  bool number(double &out) {
+    this->ws();
+    auto res = std::from_chars(this->s.data() + this->pos, this->s.data() + this->s.size(), out);
+    if (res.ec != std::errc())
+      return false;
+    this->pos = size_t(res.ptr - this->s.data());
+    return true;
+  }
+
+  template <typename T>
+  bool integer(T &out) {
+    this->ws();
+    auto res = std::from_chars(this->s.data() + this->pos, this->s.data() + this->s.size(), out);
+    if (res.ec != std::errc())
+      return false;
+    this->pos = size_t(res.ptr - this->s.data());
+    // 1.0 or 1e3 is not an integer for us
+    if (this->pos < this->s.size() && (this->s[this->pos] == '.' || this->s[this->pos] == 'e' || this->s[this->pos] == 'E'))
+      return false;
+    return true;
+  }
+
+  bool array(std::vector<double> &out) {
+    out.clear();
+    if (!this->expect('['))
+      return false;
+    if (this->expect(']'))
+      return true;
+    do {
+      double d;
+      if (!this->number(d))
+        return false;
+      out.push_back(d);
+    } while (this->expect(','));
+    return this->expect(']');
+  }
+
+private:
+  std::string_view s;
+  size_t pos = 0;
+};
+
+inline void write_string(std::string &out, const std::string &str) {
+  out.push_back('"');
+  for (const char c : str) {
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\b':
+      out += "\\b";
+      break;
+    case '\f':
+      out += "\\f";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "\\u%04x", unsigned(static_cast<unsigned char>(c)));
+        out += buf;
+      } else
+        out.push_back(c);
+    }
+  }
+  out.push_back('"');
+}
+
+template <typename T>
+inline void write_integer(std::string &out, const T &i) {
+  char buf[24];
+  auto res = std::to_chars(buf, buf + sizeof(buf), i);
+  out.append(buf, size_t(res.ptr - buf));
+}
+
+inline void write_number(std::string &out, const double &d) {
+  if (!std::isfinite(d)) {
+    out += "null"; // as nlohmann does
+    return;
+  }
+  if (d == 0.0) {
+    out += std::signbit(d) ? "-0.0" : "0.0";
+    return;
+  }
+  // shortest round trip digits, then the same layout as nlohmann (fixed for 1e-5 < |d| < 1e15, else d.ddde+XX)
+  char buf[32];
+  auto res = std::to_chars(buf, buf + sizeof(buf), d, std::chars_format::scientific);
+  std::string_view sv(buf, size_t(res.ptr - buf));
+  if (sv.front() == '-') {
+    out.push_back('-');
+    sv.remove_prefix(1);
+  }
+  const size_t epos = sv.find('e');
+  std::string digits;
+  for (const char c : sv.substr(0, epos)) {
+    if (c != '.')
+      digits.push_back(c);
+  }
+  int exp10 = 0;
+  std::from_chars(sv.data() + epos + 1 + (sv[epos + 1] == '+' ? 1 : 0), sv.data() + sv.size(), exp10);
+  const int k = int(digits.size());
+  const int n = exp10 + 1; // position of the decimal point
+  if (k <= n && n <= 15) {
+    out += digits;
+    out.append(size_t(n - k), '0');
+    out += ".0";
+  } else if (0 < n && n <= 15) {
+    out.append(digits, 0, size_t(n));
+    out.push_back('.');
+    out.append(digits, size_t(n), std::string::npos);
+  } else if (-4 < n && n <= 0) {
+    out += "0.";
+    out.append(size_t(-n), '0');
+    out += digits;
+  } else {
+    out.push_back(digits[0]);
+    if (k > 1) {
+      out.push_back('.');
+      out.append(digits, 1, std::string::npos);
+    }
+    out.push_back('e');
+    out.push_back(exp10 < 0 ? '-' : '+');
+    const int ae = std::abs(exp10);
+    if (ae < 10)
+      out.push_back('0');
+    write_integer(out, ae);
+  }
+}
+
+inline void write_array(std::string &out, const std::vector<double> &v, const std::string &indent) {
+  if (v.empty()) {
+    out += "[]";
+    return;
+  }
+  out += "[\n";
+  for (size_t i = 0; i < v.size(); ++i) {
+    out += indent;
+    out += "  ";
+    write_number(out, v[i]);
+    if (i + 1 < v.size())
+      out.push_back(',');
+    out.push_back('\n');
+  }
+  out += indent;
+  out.push_back(']');
+}
+
+} // namespace atss_header_detail
+
+inline bool atss_header::parse(std::string_view text) {
+  atss_header_detail::reader rd(text);
+  std::string key;
+  this->present = 0;
+  if (!rd.expect('{'))
+    return false;
+  if (rd.expect('}'))
+    return rd.at_end();
+  do {
+    if (!rd.string(key) || !rd.expect(':'))
+      return false;
+    bool ok = false;
+    if (key == "datetime") {
+      ok = rd.string(this->datetime);
+      this->present |= k_datetime;
+    } else if (key == "latitude") {
+      ok = rd.number(this->latitude);
+      this->present |= k_latitude;
+    } else if (key == "longitude") {
+      ok = rd.number(this->longitude);
+      this->present |= k_longitude;
+    } else if (key == "elevation") {
+      ok = rd.number(this->elevation);
+      this->present |= k_elevation;
+    } else if (key == "angle") {
+      ok = rd.number(this->angle);
+      this->present |= k_angle;
+    } else if (key == "tilt") {
+      ok = rd.number(this->tilt);
+      this->present |= k_tilt;
+    } else if (key == "resistance") {
+      ok = rd.number(this->resistance);
+      this->present |= k_resistance;
+    } else if (key == "units") {
+      ok = rd.string(this->units);
+      this->present |= k_units;
+    } else if (key == "filter") {
+      ok = rd.string(this->filter);
+      this->present |= k_filter;
+    } else if (key == "source") {
+      ok = rd.string(this->source);
+      this->present |= k_source;
+    } else if (key == "sensor_calibration") {
+      this->present |= k_sensor_calibration;
+      if (!rd.expect('{'))
+        return false;
+      ok = true;
+      if (!rd.expect('}')) {
+        do {
+          if (!rd.string(key) || !rd.expect(':'))
+            return false;
+          if (key == "sensor") {
+            ok = rd.string(this->cal_sensor);
+            this->present |= k_cal_sensor;
+          } else if (key == "serial") {
+            ok = rd.integer(this->cal_serial);
+            this->present |= k_cal_serial;
+          } else if (key == "chopper") {
+            ok = rd.integer(this->cal_chopper);
+            this->present |= k_cal_chopper;
+          } else if (key == "units_frequency") {
+            ok = rd.string(this->cal_units_frequency);
+            this->present |= k_cal_units_frequency;
+          } else if (key == "units_amplitude") {
+            ok = rd.string(this->cal_units_amplitude);
+            this->present |= k_cal_units_amplitude;
+          } else if (key == "units_phase") {
+            ok = rd.string(this->cal_units_phase);
+            this->present |= k_cal_units_phase;
+          } else if (key == "datetime") {
+            ok = rd.string(this->cal_datetime);
+            this->present |= k_cal_datetime;
+          } else if (key == "Operator") {
+            ok = rd.string(this->cal_Operator);
+            this->present |= k_cal_Operator;
+          } else if (key == "f") {
+            ok = rd.array(this->cal_f);
+            this->present |= k_cal_f;
+          } else if (key == "a") {
+            ok = rd.array(this->cal_a);
+            this->present |= k_cal_a;
+          } else if (key == "p") {
+            ok = rd.array(this->cal_p);
+            this->present |= k_cal_p;
+          } else
+            return false; // unknown key
+          if (!ok)
+            return false;
+        } while (rd.expect(','));
+        if (!rd.expect('}'))
+          return false;
+      }
+    } else
+      return false; // unknown key
+    if (!ok)
+      return false;
+  } while (rd.expect(','));
+  if (!rd.expect('}'))
+    return false;
+  return rd.at_end();
+}
+
+inline void atss_header::from_json(const nlohmann::ordered_json &head) {
+  this->present = 0;
+  auto get_str = [&head, this](const char *name, std::string &val, const key k) {
+    if (head.contains(name)) {
+      val = std::string(head[name]);
+      this->present |= k;
+    }
+  };
+  auto get_dbl = [&head, this](const char *name, double &val, const key k) {
+    if (head.contains(name)) {
+      val = double(head[name]);
+      this->present |= k;
+    }
+  };
+  get_str("datetime", this->datetime, k_datetime);
+  get_dbl("latitude", this->latitude, k_latitude);
+  get_dbl("longitude", this->longitude, k_longitude);
+  get_dbl("elevation", this->elevation, k_elevation);
+  get_dbl("angle", this->angle, k_angle);
+  get_dbl("tilt", this->tilt, k_tilt);
+  get_dbl("resistance", this->resistance, k_resistance);
+  get_str("units", this->units, k_units);
+  get_str("filter", this->filter, k_filter);
+  get_str("source", this->source, k_source);
+  if (!head.contains("sensor_calibration"))
+    return;
+  this->present |= k_sensor_calibration;
+  const auto &sc = head["sensor_calibration"];
+  auto get_cal_str = [&sc, this](const char *name, std::string &val, const key k) {
+    if (sc.contains(name)) {
+      val = std::string(sc[name]);
+      this->present |= k;
+    }
+  };
+  auto get_cal_vec = [&sc, this](const char *name, std::vector<double> &val, const key k) {
+    if (sc.contains(name)) {
+      val = std::vector<double>(sc[name]);
+      this->present |= k;
+    }
+  };
+  get_cal_str("sensor", this->cal_sensor, k_cal_sensor);
+  if (sc.contains("serial")) {
+    this->cal_serial = uint64_t(sc["serial"]);
+    this->present |= k_cal_serial;
+  }
+  if (sc.contains("chopper")) {
+    this->cal_chopper = int64_t(sc["chopper"]);
+    this->present |= k_cal_chopper;
+  }
+  get_cal_str("units_frequency", this->cal_units_frequency, k_cal_units_frequency);
+  get_cal_str("units_amplitude", this->cal_units_amplitude, k_cal_units_amplitude);
+  get_cal_str("units_phase", this->cal_units_phase, k_cal_units_phase);
+  get_cal_str("datetime", this->cal_datetime, k_cal_datetime);
+  get_cal_str("Operator", this->cal_Operator, k_cal_Operator);
+  get_cal_vec("f", this->cal_f, k_cal_f);
+  get_cal_vec("a", this->cal_a, k_cal_a);
+  get_cal_vec("p", this->cal_p, k_cal_p);
+}
+
+inline std::string atss_header::serialize() const {
+  using namespace atss_header_detail;
+  std::string out;
+  out.reserve(512 + 3 * 24 * this->cal_f.size());
+  out += "{\n  \"datetime\": ";
+  write_string(out, this->datetime);
+  out += ",\n  \"latitude\": ";
+  write_number(out, this->latitude);
+  out += ",\n  \"longitude\": ";
+  write_number(out, this->longitude);
+  out += ",\n  \"elevation\": ";
+  write_number(out, this->elevation);
+  out += ",\n  \"angle\": ";
+  write_number(out, this->angle);
+  out += ",\n  \"tilt\": ";
+  write_number(out, this->tilt);
+  out += ",\n  \"resistance\": ";
+  write_number(out, this->resistance);
+  out += ",\n  \"units\": ";
+  write_string(out, this->units);
+  out += ",\n  \"filter\": ";
+  write_string(out, this->filter);
+  out += ",\n  \"source\": ";
+  write_string(out, this->source);
+  out += ",\n  \"sensor_calibration\": {\n    \"sensor\": ";
+  write_string(out, this->cal_sensor);
+  out += ",\n    \"serial\": ";
+  write_integer(out, this->cal_serial);
+  out += ",\n    \"chopper\": ";
+  write_integer(out, this->cal_chopper);
+  out += ",\n    \"units_frequency\": ";
+  write_string(out, this->cal_units_frequency);
+  out += ",\n    \"units_amplitude\": ";
+  write_string(out, this->cal_units_amplitude);
+  out += ",\n    \"units_phase\": ";
+  write_string(out, this->cal_units_phase);
+  out += ",\n    \"datetime\": ";
+  write_string(out, this->cal_datetime);
+  out += ",\n    \"Operator\": ";
+  write_string(out, this->cal_Operator);
+  out += ",\n    \"f\": ";
+  write_array(out, this->cal_f, "    ");
+  out += ",\n    \"a\": ";
+  write_array(out, this->cal_a, "    ");
+  out += ",\n    \"p\": ";
+  write_array(out, this->cal_p, "    ");
+  out += "\n  }\n}\n";
+  return out;
+}
+
+/*!
+ * \brief The atss_header_writer class writes headers in the background; used for bulk survey creation (thousands of channels)
+ * push() returns immediately; a single worker thread takes all queued headers at once and writes them.
+ * flush() blocks until everything is on disk and throws if a file could not be written; the destructor flushes without throwing.
+ */
+class atss_header_writer {
+public:
+  atss_header_writer() {
+    this->worker = std::thread(&atss_header_writer::run, this);
+  }
+
+  ~atss_header_writer() {
+    {
+      std::lock_guard<std::mutex> lock(this->mtx);
+      this->stop = true;
+    }
+    this->cv.notify_one();
+    if (this->worker.joinable())
+      this->worker.join();
+  }
+
+  atss_header_writer(const atss_header_writer &) = delete;
+  atss_header_writer &operator=(const atss_header_writer &) = delete;
+
+  void push(const std::filesystem::path &filepath, std::string &&content) {
+    {
+      std::lock_guard<std::mutex> lock(this->mtx);
+      this->queue.emplace_back(filepath, std::move(content));
+      ++this->pending;
+    }
+    this->cv.notify_one();
+  }
+
+  /*!
+   * \brief flush waits until all pushed headers are written
+   */
+  void flush() {
+    std::unique_lock<std::mutex> lock(this->mtx);
+    this->cv_done.wait(lock, [this] { return !this->pending; });
+    if (this->errors.size()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::can not write header, file not open";
+      for (const auto &e : this->errors)
+        err_str << " " << e;
+      this->errors.clear();
+      throw std::runtime_error(err_str.str());
+    }
+  }
+
+  size_t written() const {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    return this->n_written;
+  }
+
+private:
+  void run() {
+    std::vector<std::pair<std::filesystem::path, std::string>> batch;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(this->mtx);
+        this->cv.wait(lock, [this] { return this->stop || this->queue.size(); });
+        if (this->queue.empty() && this->stop)
+          return;
+        batch.swap(this->queue);
+      }
+      std::vector<std::string> failed;
+      for (const auto &job : batch) {
+        std::FILE *fp = std::fopen(job.first.c_str(), "wb");
+        if (fp == nullptr) {
+          failed.emplace_back(job.first.string());
+          continue;
+        }
+        if (std::fwrite(job.second.data(), 1, job.second.size(), fp) != job.second.size())
+          failed.emplace_back(job.first.string());
+        std::fclose(fp);
+      }
+      {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->pending -= batch.size();
+        this->n_written += batch.size() - failed.size();
+        this->errors.insert(this->errors.end(), failed.begin(), failed.end());
+      }
+      batch.clear();
+      this->cv_done.notify_all();
+    }
+  }
+
+  mutable std::mutex mtx;
+  std::condition_variable cv;                                       //!< wakes the worker
+  std::condition_variable cv_done;                                  //!< wakes flush
+  std::vector<std::pair<std::filesystem::path, std::string>> queue; //!< headers to write
+  std::vector<std::string> errors;                                  //!< files which could not be written
+  size_t pending = 0;                                               //!< pushed but not written yet
+  size_t n_written = 0;                                             //!< statistics
+  bool stop = false;
+  std::thread worker;
+};
+
+#endif // ATSS_HEADER_H
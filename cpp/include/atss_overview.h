@@ -0,0 +1,344 @@
+#ifndef ATSS_OVERVIEW_H
+#define ATSS_OVERVIEW_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*!
+ * @file atss_overview.h
+ * @brief multi resolution min / max envelope pyramid of an .atss file, stored as sidecar file .atsov next to the .atss
+ * A plot never needs more points than the screen has pixels. The pyramid is built once in a single streaming pass;
+ * afterwards any zoom range is served by reading about 4 entries per pixel from the sidecar instead of all samples.
+ *
+ * sidecar layout (little endian, as the .atss):
+ *   char[8] magic "ATSOVR01"
+ *   uint64 samples, uint64 atss file size, int64 atss mtime (ticks), uint64 base, uint64 factor, uint64 levels
+ *   uint64 entries of each level
+ *   float min, float max for each entry, level 0 first
+ * level 0 holds min / max of base samples, each next level min / max of factor entries of the level below.
+ */
+
+/*!
+ * \brief The atss_overview class builds, validates and reads the envelope pyramid of one .atss file
+ */
+class atss_overview {
+
+public:
+  /*!
+   * \brief atss_overview
+   * \param atss_file the .atss file
+   * \param base samples per entry in level 0; ranges with less samples per pixel are read directly from the .atss
+   * \param factor reduction from level to level
+   */
+  atss_overview(const std::filesystem::path &atss_file, const size_t &base = 64, const size_t &factor = 4) : atss_file(atss_file), base(base), factor(factor) {
+    if ((this->base < 2) || (this->factor < 2)) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::base and factor must be >= 2 " << this->base << ", " << this->factor;
+      throw std::runtime_error(err_str.str());
+    }
+    this->ovr_file = this->atss_file;
+    this->ovr_file.replace_extension(".atsov");
+  }
+
+  /*!
+   * \brief sidecar_path of the pyramid
+   */
+  std::filesystem::path sidecar_path() const {
+    return this->ovr_file;
+  }
+
+  /*!
+   * \brief open loads the pyramid header; builds the pyramid if the sidecar is missing or older than the .atss
+   * \return true if the pyramid had to be (re)built
+   */
+  bool open() {
+    if (this->load_header())
+      return false;
+    this->build();
+    if (!this->load_header()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::can not read overview " << this->ovr_file;
+      throw std::runtime_error(err_str.str());
+    }
+    return true;
+  }
+
+  /*!
+   * \brief build streams the .atss once and writes the sidecar; memory is about 1 / base of the file size
+   */
+  void build() {
+    std::ifstream in(this->atss_file, std::ios::binary);
+    if (!in.is_open()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::can not open " << this->atss_file;
+      throw std::runtime_error(err_str.str());
+    }
+    const uint64_t fsize = std::filesystem::file_size(this->atss_file);
+    const uint64_t n = fsize / sizeof(double);
+    if (!n) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::no samples in " << this->atss_file;
+      throw std::runtime_error(err_str.str());
+    }
+
+    // level 0 from the samples, streamed in chunks
+    std::vector<std::vector<float>> lvl(1);
+    lvl[0].reserve(2 * (n / this->base + 1));
+    std::vector<double> chunk((1 << 20) - ((1 << 20) % this->base)); // chunk is a multiple of base
+    uint64_t done = 0;
+    while (done < n) {
+      const size_t count = size_t(std::min<uint64_t>(chunk.size(), n - done));
+      in.read(reinterpret_cast<char *>(chunk.data()), std::streamsize(count * sizeof(double)));
+      if (size_t(in.gcount()) != count * sizeof(double)) {
+        std::ostringstream err_str(__func__, std::ios_base::ate);
+        err_str << "::read error at sample " << done << " in " << this->atss_file;
+        throw std::runtime_error(err_str.str());
+      }
+      for (size_t i = 0; i < count; i += this->base) {
+        const auto mm = std::minmax_element(chunk.begin() + i, chunk.begin() + std::min(count, i + this->base));
+        lvl[0].push_back(float(*mm.first));
+        lvl[0].push_back(float(*mm.second));
+      }
+      done += count;
+    }
+    in.close();
+
+    // reduce until a complete overview fits into a screen
+    while ((lvl.back().size() / 2) > 1024) {
+      const auto &below = lvl.back();
+      std::vector<float> next;
+      next.reserve(below.size() / this->factor + 2);
+      for (size_t i = 0; i < below.size(); i += 2 * this->factor) {
+        float mi = below[i], ma = below[i + 1];
+        for (size_t j = i + 2; j < std::min(below.size(), i + 2 * this->factor); j += 2) {
+          mi = std::min(mi, below[j]);
+          ma = std::max(ma, below[j + 1]);
+        }
+        next.push_back(mi);
+        next.push_back(ma);
+      }
+      lvl.emplace_back(std::move(next));
+    }
+
+    // write to a temporary name and rename - readers never see a half written sidecar
+    std::filesystem::path tmp(this->ovr_file);
+    tmp += ".tmp";
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::can not write " << tmp;
+      throw std::runtime_error(err_str.str());
+    }
+    const int64_t mtime = std::filesystem::last_write_time(this->atss_file).time_since_epoch().count();
+    const uint64_t levels = lvl.size();
+    out.write(magic, 8);
+    this->write_u64(out, n);
+    this->write_u64(out, fsize);
+    this->write_u64(out, uint64_t(mtime));
+    this->write_u64(out, this->base);
+    this->write_u64(out, this->factor);
+    this->write_u64(out, levels);
+    for (const auto &l : lvl)
+      this->write_u64(out, l.size() / 2);
+    for (const auto &l : lvl)
+      out.write(reinterpret_cast<const char *>(l.data()), std::streamsize(l.size() * sizeof(float)));
+    out.close();
+    if (!out) {
+      std::filesystem::remove(tmp);
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::write error " << tmp;
+      throw std::runtime_error(err_str.str());
+    }
+    std::filesystem::rename(tmp, this->ovr_file);
+  }
+
+  /*!
+   * \brief envelope min / max of the range, two points per pixel (min first); x is the sample index
+   * if the range has less than 2 * pixels samples, the samples itself are returned
+   * \param x sample index
+   * \param y amplitude
+   * \param start first sample
+   * \param use samples, 0 means all from start
+   * \param pixels screen width
+   * \return level used; -1 means the samples were read from the .atss
+   */
+  int envelope(std::vector<double> &x, std::vector<double> &y, const size_t &start, size_t use, const size_t &pixels) {
+    if (!this->n_samples)
+      this->open();
+    if (!pixels || (start >= this->n_samples)) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::start " << start << " beyond " << this->n_samples << " samples or no pixels";
+      throw std::runtime_error(err_str.str());
+    }
+    if (!use || (start + use > this->n_samples))
+      use = this->n_samples - start;
+    x.clear();
+    y.clear();
+    if (use <= 2 * pixels) {
+      this->read_samples(this->samples_buf, start, use);
+      x.reserve(use);
+      for (size_t i = 0; i < use; ++i)
+        x.push_back(double(start + i));
+      y.assign(this->samples_buf.begin(), this->samples_buf.end());
+      return -1;
+    }
+
+    x.reserve(2 * pixels);
+    y.reserve(2 * pixels);
+    const double spp = double(use) / double(pixels); // samples per pixel
+    if (spp < double(this->base)) {
+      // finer than level 0: min / max from the samples, at most 2 * pixels * base samples
+      this->read_samples(this->samples_buf, start, use);
+      for (size_t p = 0; p < pixels; ++p) {
+        const size_t b = size_t(double(p) * spp), e = std::min(use, size_t(double(p + 1) * spp));
+        if (b >= e)
+          continue;
+        const auto mm = std::minmax_element(this->samples_buf.begin() + b, this->samples_buf.begin() + e);
+        this->push_pixel(x, y, double(start + b), double(start + e), *mm.first, *mm.second);
+      }
+      return -1;
+    }
+
+    // coarsest level where an entry is not wider than a pixel
+    size_t level = 0;
+    uint64_t width = this->base;
+    while ((level + 1 < this->counts.size()) && (double(width * this->factor) <= spp)) {
+      width *= this->factor;
+      ++level;
+    }
+    const uint64_t first = start / width;
+    const uint64_t last = std::min<uint64_t>(this->counts[level], (start + use + width - 1) / width);
+    this->read_level(level, first, last - first);
+    for (size_t p = 0; p < pixels; ++p) {
+      const uint64_t sb = start + uint64_t(double(p) * spp), se = start + std::min<uint64_t>(use, uint64_t(double(p + 1) * spp));
+      if (sb >= se)
+        continue;
+      const uint64_t eb = sb / width - first, ee = std::min<uint64_t>(last, (se + width - 1) / width) - first;
+      float mi = std::numeric_limits<float>::max(), ma = std::numeric_limits<float>::lowest();
+      for (uint64_t k = eb; k < ee; ++k) {
+        mi = std::min(mi, this->level_buf[2 * k]);
+        ma = std::max(ma, this->level_buf[2 * k + 1]);
+      }
+      if (mi <= ma)
+        this->push_pixel(x, y, double(sb), double(se), mi, ma);
+    }
+    return int(level);
+  }
+
+  size_t samples() const {
+    return this->n_samples;
+  }
+
+  size_t levels() const {
+    return this->counts.size();
+  }
+
+private:
+  static constexpr const char *magic = "ATSOVR01";
+
+  std::filesystem::path atss_file; //!< data
+  std::filesystem::path ovr_file;  //!< sidecar .atsov
+  uint64_t base = 64;              //!< samples per entry of level 0
+  uint64_t factor = 4;             //!< entries of level n per entry of level n + 1
+  uint64_t n_samples = 0;          //!< samples of the .atss when the pyramid was built
+  std::vector<uint64_t> counts;    //!< entries per level
+  std::vector<uint64_t> offsets;   //!< file offset of each level in the sidecar
+  std::vector<float> level_buf;    //!< entries read for a query
+  std::vector<double> samples_buf; //!< samples read for a fine query
+
+  static void write_u64(std::ofstream &out, const uint64_t &v) {
+    out.write(reinterpret_cast<const char *>(&v), sizeof(uint64_t));
+  }
+
+  static uint64_t read_u64(std::ifstream &in) {
+    uint64_t v = 0;
+    in.read(reinterpret_cast<char *>(&v), sizeof(uint64_t));
+    return v;
+  }
+
+  /*!
+   * \brief load_header reads the sidecar header and checks it against the .atss
+   * \return false if missing, stale or built with other base / factor
+   */
+  bool load_header() {
+    this->n_samples = 0;
+    this->counts.clear();
+    this->offsets.clear();
+    if (!std::filesystem::exists(this->ovr_file))
+      return false;
+    std::ifstream in(this->ovr_file, std::ios::binary);
+    char mg[8];
+    in.read(mg, 8);
+    if (!in || std::memcmp(mg, magic, 8))
+      return false;
+    const uint64_t n = read_u64(in);
+    const uint64_t fsize = read_u64(in);
+    const int64_t mtime = int64_t(read_u64(in));
+    const uint64_t b = read_u64(in);
+    const uint64_t f = read_u64(in);
+    const uint64_t levels = read_u64(in);
+    if (!in || (b != this->base) || (f != this->factor) || !levels || (levels > 64))
+      return false;
+    if ((fsize != std::filesystem::file_size(this->atss_file)) || (mtime != std::filesystem::last_write_time(this->atss_file).time_since_epoch().count()))
+      return false;
+    uint64_t pos = 8 + 6 * sizeof(uint64_t) + levels * sizeof(uint64_t);
+    for (uint64_t i = 0; i < levels; ++i) {
+      this->counts.push_back(read_u64(in));
+      this->offsets.push_back(pos);
+      pos += this->counts.back() * 2 * sizeof(float);
+    }
+    if (!in || (pos != std::filesystem::file_size(this->ovr_file))) {
+      this->counts.clear();
+      this->offsets.clear();
+      return false;
+    }
+    this->n_samples = n;
+    return true;
+  }
+
+  void read_level(const size_t &level, const uint64_t &first, const uint64_t &count) {
+    std::ifstream in(this->ovr_file, std::ios::binary);
+    in.seekg(std::streamoff(this->offsets[level] + first * 2 * sizeof(float)));
+    this->level_buf.resize(2 * count);
+    in.read(reinterpret_cast<char *>(this->level_buf.data()), std::streamsize(count * 2 * sizeof(float)));
+    if (!in) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::read error in " << this->ovr_file;
+      throw std::runtime_error(err_str.str());
+    }
+  }
+
+  void read_samples(std::vector<double> &buf, const uint64_t &start, const uint64_t &count) const {
+    std::ifstream in(this->atss_file, std::ios::binary);
+    in.seekg(std::streamoff(start * sizeof(double)));
+    buf.resize(count);
+    in.read(reinterpret_cast<char *>(buf.data()), std::streamsize(count * sizeof(double)));
+    if (!in) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::read error in " << this->atss_file;
+      throw std::runtime_error(err_str.str());
+    }
+  }
+
+  // min and max at the pixel center: a line through all points draws the envelope
+  static void push_pixel(std::vector<double> &x, std::vector<double> &y, const double &xb, const double &xe, const double &mi, const double &ma) {
+    const double xm = 0.5 * (xb + xe);
+    x.push_back(xm);
+    y.push_back(mi);
+    x.push_back(xm);
+    y.push_back(ma);
+  }
+};
+
+#endif // ATSS_OVERVIEW_H
@@ -0,0 +1,217 @@
+#ifndef BITMASK_H
+#define BITMASK_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+/*!
+ * @file bitmask.h
+ * @brief packed selection mask, 64 elements per word; the selection format of math_vector (*_if overloads) and of the stack selection in raw_spectra
+ *
+ * std::vector<bool> iterators are proxies and block vectorization; here a kernel works word wise:
+ * all bits set - dense loop over 64 values, no bit set - skip 64 values, else iterate the set bits (countr_zero); counts are popcounts.
+ * Bits beyond size() are always 0, so count() and the word loops need no tail handling.
+ * \code
+ *   bitmask sel(stacks.size(), true);
+ *   sel.reset(17);                      // stack 17 is garbage
+ *   sel.for_each_set([&](const size_t i) { sum += x[i]; });
+ * \endcode
+ */
+
+class bitmask {
+public:
+  static constexpr size_t bits = 64;
+
+  bitmask() = default;
+
+  /*!
+   * \brief bitmask of n elements, all set to value
+   */
+  explicit bitmask(const size_t &n, const bool value = false) {
+    this->assign(n, value);
+  }
+
+  /*!
+   * \brief bitmask from the old selection vector
+   */
+  explicit bitmask(const std::vector<bool> &sel) {
+    this->assign(sel.size(), false);
+    for (size_t i = 0; i < sel.size(); ++i) {
+      if (sel[i])
+        this->words[i / bits] |= (uint64_t(1) << (i % bits));
+    }
+  }
+
+  void assign(const size_t &n, const bool value = false) {
+    this->n = n;
+    this->words.assign(word_count(n), value ? ~uint64_t(0) : uint64_t(0));
+    this->clear_tail();
+  }
+
+  /*!
+   * \brief resize keeps the existing bits; new bits get value
+   */
+  void resize(const size_t &n, const bool value = false) {
+    const size_t old_n = this->n;
+    this->words.resize(word_count(n), value ? ~uint64_t(0) : uint64_t(0));
+    this->n = n;
+    if (value) {
+      for (size_t i = old_n; i < n && (i % bits); ++i)
+        this->set(i);
+    }
+    this->clear_tail();
+  }
+
+  size_t size() const {
+    return this->n;
+  }
+
+  bool empty() const {
+    return !this->n;
+  }
+
+  size_t n_words() const {
+    return this->words.size();
+  }
+
+  bool test(const size_t &i) const {
+    return (this->words[i / bits] >> (i % bits)) & 1;
+  }
+
+  void set(const size_t &i, const bool value = true) {
+    if (value)
+      this->words[i / bits] |= (uint64_t(1) << (i % bits));
+    else
+      this->words[i / bits] &= ~(uint64_t(1) << (i % bits));
+  }
+
+  void reset(const size_t &i) {
+    this->set(i, false);
+  }
+
+  void set_all(const bool value = true) {
+    this->assign(this->n, value);
+  }
+
+  /*!
+   * \brief count of set bits (popcount)
+   */
+  size_t count() const {
+    size_t c = 0;
+    for (const auto &w : this->words)
+      c += size_t(std::popcount(w));
+    return c;
+  }
+
+  bool all() const {
+    return this->count() == this->n;
+  }
+
+  bool none() const {
+    for (const auto &w : this->words) {
+      if (w)
+        return false;
+    }
+    return true;
+  }
+
+  const uint64_t *data() const {
+    return this->words.data();
+  }
+
+  uint64_t *data() {
+    return this->words.data();
+  }
+
+  uint64_t word(const size_t &i) const {
+    return this->words[i];
+  }
+
+  /*!
+   * \brief set_word for kernels building the mask word wise; bits beyond size() are cleared
+   */
+  void set_word(const size_t &i, const uint64_t &w) {
+    this->words[i] = w;
+    if (i + 1 == this->words.size())
+      this->clear_tail();
+  }
+
+  bitmask &operator&=(const bitmask &rhs) {
+    this->check_size(rhs, __func__);
+    for (size_t i = 0; i < this->words.size(); ++i)
+      this->words[i] &= rhs.words[i];
+    return *this;
+  }
+
+  bitmask &operator|=(const bitmask &rhs) {
+    this->check_size(rhs, __func__);
+    for (size_t i = 0; i < this->words.size(); ++i)
+      this->words[i] |= rhs.words[i];
+    return *this;
+  }
+
+  bool operator==(const bitmask &rhs) const {
+    return (this->n == rhs.n) && (this->words == rhs.words);
+  }
+
+  /*!
+   * \brief for_each_set calls f(index) for all set bits in ascending order
+   */
+  template <class F>
+  void for_each_set(F &&f) const {
+    for (size_t wi = 0; wi < this->words.size(); ++wi) {
+      uint64_t w = this->words[wi];
+      while (w) {
+        f(wi * bits + size_t(std::countr_zero(w)));
+        w &= w - 1;
+      }
+    }
+  }
+
+  /*!
+   * \brief unpack bits first ... first + count into bytes (1 = set), e.g. one row for byte mask kernels
+   */
+  void unpack(const size_t &first, const size_t &count, uint8_t *out) const {
+    for (size_t i = 0; i < count; ++i)
+      out[i] = uint8_t(this->test(first + i));
+  }
+
+  std::vector<bool> to_vector_bool() const {
+    std::vector<bool> sel(this->n, false);
+    this->for_each_set([&sel](const size_t i) { sel[i] = true; });
+    return sel;
+  }
+
+  std::vector<uint8_t> to_bytes() const {
+    std::vector<uint8_t> sel(this->n);
+    this->unpack(0, this->n, sel.data());
+    return sel;
+  }
+
+private:
+  static size_t word_count(const size_t &n) {
+    return (n + bits - 1) / bits;
+  }
+
+  void clear_tail() {
+    if (this->words.size() && (this->n % bits))
+      this->words.back() &= (uint64_t(1) << (this->n % bits)) - 1;
+  }
+
+  void check_size(const bitmask &rhs, const char *func) const {
+    if (this->n != rhs.n) {
+      std::ostringstream err_str(func, std::ios_base::ate);
+      err_str << " :: bitmask sizes differ " << this->n << " " << rhs.n;
+      throw std::runtime_error(err_str.str());
+    }
+  }
+
+  std::vector<uint64_t> words; //!< bit i is (words[i / 64] >> (i % 64)) & 1
+  size_t n = 0;                //!< elements
+};
+
+#endif // BITMASK_H
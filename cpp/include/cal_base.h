@@ -11,6 +11,7 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <tuple>
 #include <vector>
 
 //
@@ -699,6 +700,14 @@ public:
     if (head["sensor_calibration"].contains("p"))
       this->p = std::vector<double>(head["sensor_calibration"]["p"]);
 
+    return this->check_head(filepath);
+  }
+
+  /*!
+   * \brief check_head second part of parse_head, after the members have been set (also by the fast header parser): consistency, type and backup
+   * \return size of calibration
+   */
+  size_t check_head(const std::filesystem::path &filepath = "") {
     if ((this->f.size() != this->a.size()) || (this->f.size() != this->p.size())) {
       this->clear();
       std::ostringstream err_str(__func__, std::ios_base::ate);
@@ -1088,41 +1097,10 @@ public:
       err_str << ":: sensor is empty";
       throw std::runtime_error(err_str.str());
     }
-    if ((this->sensor == "MFS-06") || (this->sensor == "MFS-06e")) {
-      auto trf = gen_trf_mfs06e(this->f_theo, this->chopper);
-      bvec::cplx2ap(trf, this->a_theo, this->p_theo, true);
-    } else if ((this->sensor == "MFS-07")) {
-      auto trf = gen_trf_mfs07(this->f_theo, this->chopper);
-      bvec::cplx2ap(trf, this->a_theo, this->p_theo, true);
-    } else if ((this->sensor == "MFS-07e")) {
-      auto trf = gen_trf_mfs07e(this->f_theo, this->chopper);
-      bvec::cplx2ap(trf, this->a_theo, this->p_theo, true);
-    } else if ((this->sensor == "MFS-12e")) {
-      auto trf = gen_trf_mfs12e(this->f_theo, this->chopper);
-      bvec::cplx2ap(trf, this->a_theo, this->p_theo, true);
-    } else if ((this->sensor == "FGS-02")) {
-      auto trf = gen_trf_fgs02(this->f_theo);
-      bvec::cplx2ap(trf, this->a_theo, this->p_theo, true);
-    } else if ((this->sensor == "FGS-03e")) {
-      auto trf = gen_trf_fgs03e(this->f_theo);
-      bvec::cplx2ap(trf, this->a_theo, this->p_theo, true);
-    } else if ((this->sensor == "FGS-05e")) {
-      auto trf = gen_trf_fgs05e(this->f_theo);
-      bvec::cplx2ap(trf, this->a_theo, this->p_theo, true);
-    } else if ((this->sensor == "SHFT-02e") || (this->sensor == "SHFT-02")) {
-      auto trf = gen_trf_shft02e(this->f_theo);
-      bvec::cplx2ap(trf, this->a_theo, this->p_theo, true);
-    } else if ((this->sensor == "SHFT-03e")) {
-      auto trf = gen_trf_mfs07e(this->f_theo, this->chopper);
-      bvec::cplx2ap(trf, this->a_theo, this->p_theo, true);
-      // std::ostringstream err_str(__func__, std::ios_base::ate);
-      // err_str << ":: SHFT-03e not implemented ->" << this->sensor;
-      // throw std::runtime_error(err_str.str());
-    } else {
-      std::ostringstream err_str(__func__, std::ios_base::ate);
-      err_str << ":: unknown sensor ->" << this->sensor;
-      throw std::runtime_error(err_str.str());
-    }
+    // same sensor on the same grid (all channels of a site, all runs) is evaluated once; SHFT-03e uses the MFS-07e model
+    const auto ap = synthetic_trf_cache().sensor_ap(this->sensor, this->chopper, this->f_theo);
+    this->a_theo = ap->ampl;
+    this->p_theo = ap->phz;
   }
 
   /*!
@@ -1407,6 +1385,14 @@ static bool operator==(const std::shared_ptr<calibration> &lhs, const std::share
   return true;
 }
 
+/*!
+   strict ordering of calibrations, consistent with operator== above (equal if neither is less); for sorting and O(n log n) duplicate removal
+*/
+inline auto compare_cal_less = [](const std::shared_ptr<calibration> &lhs, const std::shared_ptr<calibration> &rhs) -> bool {
+  return std::tie(lhs->sensor, lhs->serial, lhs->chopper, lhs->units_amplitude, lhs->units_frequency, lhs->units_phase, lhs->datetime, lhs->Operator, lhs->ct, lhs->f, lhs->a, lhs->p) <
+         std::tie(rhs->sensor, rhs->serial, rhs->chopper, rhs->units_amplitude, rhs->units_frequency, rhs->units_phase, rhs->datetime, rhs->Operator, rhs->ct, rhs->f, rhs->a, rhs->p);
+};
+
 /*!
    compare a sensor - ignore the chopper
 */
@@ -22,7 +22,7 @@ public:
       err_str << ":: db file is not a regular file -> " << db_path;
       throw std::runtime_error(err_str.str());
     }
-    this->master_cal = std::make_unique<sqlite_handler>(db_path);
+    this->master_cal = sqlite_handler::shared_ro(db_path);
   }
   ~get_from_master_cal() = default;
 
@@ -31,11 +31,13 @@ public:
     auto chopper = cal->chopper;
     // get chopper status as integer from enum
     int chopper_status = static_cast<int>(chopper);
-    std::vector<std::vector<double>> fap;
+    std::vector<double> f, a, p;
     try {
-      this->sql_query = "SELECT f, a, p FROM '" + sensor + "' WHERE chopper = " + std::to_string(chopper_status) + ";";
-      fap = this->master_cal->sqlite_vector_three_doubles_column(this->sql_query);
-      if (fap.empty()) {
+      // one prepared statement per sensor table, the chopper is bound
+      this->sql_query = "SELECT f, a, p FROM '" + sensor + "' WHERE chopper = ?;";
+      auto &stmt = this->master_cal->prepare(this->sql_query);
+      stmt.bind_all(chopper_status);
+      if (!this->master_cal->select_doubles(stmt, f, a, p)) {
         std::ostringstream err_str(__func__, std::ios_base::ate);
         err_str << ":: no master cal found for sensor -> " << sensor;
       }
@@ -44,14 +46,12 @@ public:
       err_str << ":: error getting master cal for sensor -> " << sensor << " -> " << e.what();
       throw std::runtime_error(err_str.str());
     }
-    std::vector<double> f, a, p;
-    master_cal->vec_vec_to_three_vec(fap, f, a, p);
     cal->set_master_cal(f, a, p);
     this->sql_query.clear();
   }
 
 private:
-  std::unique_ptr<sqlite_handler> master_cal;
+  std::shared_ptr<sqlite_handler> master_cal; //!< read only, shared cache connection of this thread
   std::string sql_query;
 
   // std::vector<std::string> get_all_sensor_names() {
@@ -1,8 +1,18 @@
 #ifndef CAL_SYNTHETIC_H
 #define CAL_SYNTHETIC_H
 
+#include <cmath>
 #include <complex>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <numbers>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
 #include <vector>
 
 #include "mt_base.h"
@@ -15,7 +25,7 @@
  * @brief  Synthetic transfer functions; not normalized; complex<double> ; mV as unit
  */
 
-static std::vector<std::complex<double>> gen_trf_mfs06e(const std::vector<double> &freqs, const ChopperStatus &chopper) {
+inline std::vector<std::complex<double>> gen_trf_mfs06e(const std::vector<double> &freqs, const ChopperStatus &chopper) {
   std::complex<double> im(0.0, 1.0);
   size_t i = 0;
   std::vector<std::complex<double>> cal(freqs.size());
@@ -42,7 +52,7 @@ static std::vector<std::complex<double>> gen_trf_mfs06e(const std::vector<double
   return cal;
 }
 
-static std::vector<std::complex<double>> gen_trf_mfs12e(const std::vector<double> &freqs, const ChopperStatus &chopper) {
+inline std::vector<std::complex<double>> gen_trf_mfs12e(const std::vector<double> &freqs, const ChopperStatus &chopper) {
   std::complex<double> im(0.0, 1.0);
   size_t i = 0;
   std::vector<std::complex<double>> cal(freqs.size());
@@ -59,7 +69,7 @@ static std::vector<std::complex<double>> gen_trf_mfs12e(const std::vector<double
   return cal;
 }
 
-static std::vector<std::complex<double>> gen_trf_mfs07e(const std::vector<double> &freqs, const ChopperStatus &chopper) {
+inline std::vector<std::complex<double>> gen_trf_mfs07e(const std::vector<double> &freqs, const ChopperStatus &chopper) {
   std::complex<double> im(0.0, 1.0);
   size_t i = 0;
   std::vector<std::complex<double>> cal(freqs.size());
@@ -82,7 +92,7 @@ static std::vector<std::complex<double>> gen_trf_mfs07e(const std::vector<double
   return cal;
 }
 
-static std::vector<std::complex<double>> gen_trf_mfs07(const std::vector<double> &freqs, const ChopperStatus &chopper) {
+inline std::vector<std::complex<double>> gen_trf_mfs07(const std::vector<double> &freqs, const ChopperStatus &chopper) {
   std::complex<double> im(0.0, 1.0);
   size_t i = 0;
   std::vector<std::complex<double>> cal(freqs.size());
@@ -108,7 +118,7 @@ static std::vector<std::complex<double>> gen_trf_mfs07(const std::vector<double>
 
 // all fluxgates do not have a chopper
 // Raklin Geomag-01
-static std::vector<std::complex<double>> gen_trf_fgs02(const std::vector<double> &freqs) {
+inline std::vector<std::complex<double>> gen_trf_fgs02(const std::vector<double> &freqs) {
   std::vector<std::complex<double>> cal(freqs.size());
   for (size_t i = 0; i < freqs.size(); ++i) {
     cal[i] = std::complex<double>(7.5000E-01, 0.0);
@@ -117,7 +127,7 @@ static std::vector<std::complex<double>> gen_trf_fgs02(const std::vector<double>
 }
 
 // bartington mag-03, low noise, 100 000 nT DEFAULT !
-static std::vector<std::complex<double>> gen_trf_fgs03e(const std::vector<double> &freqs) {
+inline std::vector<std::complex<double>> gen_trf_fgs03e(const std::vector<double> &freqs) {
   std::vector<std::complex<double>> cal(freqs.size());
   for (size_t i = 0; i < freqs.size(); ++i) {
     cal[i] = std::complex<double>(1.0000E-01, 0.0);
@@ -127,7 +137,7 @@ static std::vector<std::complex<double>> gen_trf_fgs03e(const std::vector<double
 
 // bartington mag-04, low noise, 70 000 nT, never sold yet
 
-static std::vector<std::complex<double>> gen_trf_fgs05e(const std::vector<double> &freqs) {
+inline std::vector<std::complex<double>> gen_trf_fgs05e(const std::vector<double> &freqs) {
 
   std::vector<std::complex<double>> cal(freqs.size());
   for (size_t i = 0; i < freqs.size(); ++i) {
@@ -137,7 +147,7 @@ static std::vector<std::complex<double>> gen_trf_fgs05e(const std::vector<double
   return cal;
 }
 // should reach E = 50mV / nT at 10 kHz
-static std::vector<std::complex<double>> gen_trf_shft02e(const std::vector<double> &freqs) {
+inline std::vector<std::complex<double>> gen_trf_shft02e(const std::vector<double> &freqs) {
   std::complex<double> im(0.0, 1.0);
   size_t i = 0;
   std::vector<std::complex<double>> cal(freqs.size());
@@ -387,4 +397,260 @@ static std::complex<double> gen_trf_adb_07e_1Hz(const double &f, std::complex<do
   return (p1 / (1. + p1));
 }
 
+// ******************* B A T C H E D *************************************************************************
+
+/*!
+ * \brief trf_sections a synthetic transfer function as gain times first (and second) order sections of p = j f / fc;
+ * that is what all gen_trf_* above compute per frequency with std::complex
+ *
+ * trf_eval evaluates the sections over a contiguous frequency array into separate real and imaginary arrays:
+ * each section is one loop of plain double arithmetic (no complex division, no per frequency allocation) which the compiler vectorizes
+ * \code
+ *   1 / (1 + jx)              = (1 - jx) / (1 + x^2)
+ *   jx / (1 + jx)             = (x^2 + jx) / (1 + x^2)
+ *   1 / (1 + sqrt2 jx - x^2)  = ((1 - x^2) - sqrt2 jx) / ((1 - x^2)^2 + 2 x^2)
+ * \endcode
+ */
+struct trf_sections {
+  double gain = 1.0;       //!< constant factor, e.g. 800 mV for the MFS-06e
+  std::vector<double> hp;  //!< corners of high passes p / (1 + p)
+  std::vector<double> lp;  //!< corners of low passes 1 / (1 + p)
+  std::vector<double> lp2; //!< corners of 2nd order Butterworth low passes 1 / (1 + sqrt2 p + p^2)
+
+  /*!
+   * \brief fold another trf into this one (sensor times board)
+   */
+  trf_sections &operator*=(const trf_sections &rhs) {
+    this->gain *= rhs.gain;
+    this->hp.insert(this->hp.end(), rhs.hp.begin(), rhs.hp.end());
+    this->lp.insert(this->lp.end(), rhs.lp.begin(), rhs.lp.end());
+    this->lp2.insert(this->lp2.end(), rhs.lp2.begin(), rhs.lp2.end());
+    return *this;
+  }
+
+  /*!
+   * \brief filter settings as flat list (gain, sizes, corners) - the part of the cache key which makes two trfs equal
+   */
+  std::vector<double> settings() const {
+    std::vector<double> s{this->gain, double(this->hp.size()), double(this->lp.size()), double(this->lp2.size())};
+    s.insert(s.end(), this->hp.begin(), this->hp.end());
+    s.insert(s.end(), this->lp.begin(), this->lp.end());
+    s.insert(s.end(), this->lp2.begin(), this->lp2.end());
+    return s;
+  }
+};
+
+/*!
+ * \brief trf_eval evaluates the sections for n frequencies; re and im must hold n values
+ */
+inline void trf_eval(const trf_sections &s, const double *f, const size_t n, double *re, double *im) {
+  for (size_t i = 0; i < n; ++i) {
+    re[i] = s.gain;
+    im[i] = 0.0;
+  }
+  for (const auto &fc : s.lp) {
+    for (size_t i = 0; i < n; ++i) {
+      const double x = f[i] / fc;
+      const double d = 1.0 / (1.0 + x * x);
+      const double a = d, b = -x * d;
+      const double r = re[i] * a - im[i] * b;
+      im[i] = re[i] * b + im[i] * a;
+      re[i] = r;
+    }
+  }
+  for (const auto &fc : s.hp) {
+    for (size_t i = 0; i < n; ++i) {
+      const double x = f[i] / fc;
+      const double d = 1.0 / (1.0 + x * x);
+      const double a = x * x * d, b = x * d;
+      const double r = re[i] * a - im[i] * b;
+      im[i] = re[i] * b + im[i] * a;
+      re[i] = r;
+    }
+  }
+  for (const auto &fc : s.lp2) {
+    for (size_t i = 0; i < n; ++i) {
+      const double x = f[i] / fc;
+      const double u = 1.0 - x * x;
+      const double d = 1.0 / (u * u + 2.0 * x * x);
+      const double a = u * d, b = -std::numbers::sqrt2 * x * d;
+      const double r = re[i] * a - im[i] * b;
+      im[i] = re[i] * b + im[i] * a;
+      re[i] = r;
+    }
+  }
+}
+
+/*!
+ * \brief trf_eval_ap amplitude and phase (as bvec::cplx2ap) from the split real / imaginary evaluation
+ */
+inline void trf_eval_ap(const trf_sections &s, const std::vector<double> &freqs, std::vector<double> &ampl, std::vector<double> &phz, const bool deg = true) {
+  ampl.resize(freqs.size());
+  phz.resize(freqs.size());
+  // use the output vectors as re / im scratch
+  trf_eval(s, freqs.data(), freqs.size(), ampl.data(), phz.data());
+  const double scale = deg ? (180.0 / std::numbers::pi) : 1.0;
+  for (size_t i = 0; i < freqs.size(); ++i) {
+    const double re = ampl[i], im = phz[i];
+    ampl[i] = std::sqrt(re * re + im * im);
+    phz[i] = std::atan2(im, re) * scale;
+  }
+}
+
+/*!
+ * \brief trf_eval_cplx same result as the gen_trf_* functions
+ */
+inline std::vector<std::complex<double>> trf_eval_cplx(const trf_sections &s, const std::vector<double> &freqs) {
+  std::vector<double> re(freqs.size()), im(freqs.size());
+  trf_eval(s, freqs.data(), freqs.size(), re.data(), im.data());
+  std::vector<std::complex<double>> cal(freqs.size());
+  for (size_t i = 0; i < freqs.size(); ++i)
+    cal[i] = std::complex<double>(re[i], im[i]);
+  return cal;
+}
+
+/*!
+ * \brief sections of the sensors known by calibration::gen_cal_sensor; throws on unknown sensor
+ */
+inline trf_sections trf_sections_sensor(const std::string &sensor, const ChopperStatus &chopper) {
+  trf_sections s;
+  const bool off = (chopper == ChopperStatus::off);
+  if ((sensor == "MFS-06") || (sensor == "MFS-06e")) {
+    s.gain = 800.0;
+    s.hp = {4.0};
+    s.lp = {8192.0, 28300.0};
+    if (off)
+      s.hp.push_back(0.720);
+  } else if (sensor == "MFS-07") {
+    s.gain = 640.0;
+    s.hp = {32.0};
+    s.lp = {45000.0, 28300.0};
+    if (off)
+      s.hp.push_back(0.720);
+  } else if ((sensor == "MFS-07e") || (sensor == "SHFT-03e")) {
+    s.gain = 640.0;
+    s.hp = {32.0};
+    s.lp = {40000.0, 50000.0};
+    if (off)
+      s.hp.push_back(0.720);
+  } else if (sensor == "MFS-12e") {
+    s.gain = 800.0;
+    s.hp = {16.0};
+    s.lp = {8192.0, 28300.0};
+  } else if (sensor == "FGS-02") {
+    s.gain = 7.5000E-01;
+  } else if (sensor == "FGS-03e") {
+    s.gain = 1.0000E-01;
+  } else if (sensor == "FGS-05e") {
+    s.gain = 1.4300E-01;
+  } else if ((sensor == "SHFT-02e") || (sensor == "SHFT-02")) {
+    s.gain = 50.0;
+    s.lp = {3.0E5};
+  } else {
+    std::ostringstream err_str(__func__, std::ios_base::ate);
+    err_str << ":: unknown sensor ->" << sensor;
+    throw std::runtime_error(err_str.str());
+  }
+  return s;
+}
+
+/*!
+ * \brief trf_grid_id identifies a frequency grid: FNV-1a over size and values
+ */
+inline uint64_t trf_grid_id(const std::vector<double> &freqs) {
+  uint64_t h = 14695981039346656037ULL;
+  auto mix = [&h](const uint64_t v) {
+    for (size_t b = 0; b < 8; ++b) {
+      h ^= (v >> (8 * b)) & 0xff;
+      h *= 1099511628211ULL;
+    }
+  };
+  mix(freqs.size());
+  for (const auto &f : freqs) {
+    uint64_t v;
+    std::memcpy(&v, &f, sizeof(v));
+    mix(v);
+  }
+  return h;
+}
+
+/*!
+ * \brief trf_cache memoizes amplitude / phase of synthetic transfer functions; thread safe
+ *
+ * key is (model, chopper, filter settings, frequency grid id); all channels with the same sensor type on the same FFT grid
+ * share one evaluation; the grid is stored with the result and compared on a hit, so a hash collision only costs a re-evaluation
+ */
+class trf_cache {
+public:
+  struct trf_ap {
+    std::vector<double> f;    //!< frequency grid
+    std::vector<double> ampl; //!< amplitude
+    std::vector<double> phz;  //!< phase in degrees
+  };
+
+  using key_type = std::tuple<std::string, int, std::vector<double>, uint64_t>;
+
+  static constexpr size_t max_entries = 256; //!< cleared when exceeded - a run uses a few sensors on a few grids
+
+  /*!
+   * \brief ap returns the amplitude / phase of sections s on freqs; model and chopper are part of the key only
+   */
+  std::shared_ptr<const trf_ap> ap(const std::string &model, const ChopperStatus &chopper, const trf_sections &s, const std::vector<double> &freqs) {
+    key_type key(model, int(chopper), s.settings(), trf_grid_id(freqs));
+    {
+      std::lock_guard<std::mutex> lock(this->mtx);
+      auto it = this->cache.find(key);
+      if ((it != this->cache.end()) && (it->second->f == freqs)) {
+        ++this->n_hits;
+        return it->second;
+      }
+    }
+    // evaluate outside of the lock
+    auto result = std::make_shared<trf_ap>();
+    result->f = freqs;
+    trf_eval_ap(s, freqs, result->ampl, result->phz, true);
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->cache.size() >= max_entries)
+      this->cache.clear();
+    this->cache.insert_or_assign(std::move(key), result);
+    return result;
+  }
+
+  /*!
+   * \brief sensor_ap convenience for calibration::gen_cal_sensor
+   */
+  std::shared_ptr<const trf_ap> sensor_ap(const std::string &sensor, const ChopperStatus &chopper, const std::vector<double> &freqs) {
+    return this->ap(sensor, chopper, trf_sections_sensor(sensor, chopper), freqs);
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    return this->cache.size();
+  }
+
+  size_t hits() const {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    return this->n_hits;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->cache.clear();
+    this->n_hits = 0;
+  }
+
+private:
+  mutable std::mutex mtx;
+  std::map<key_type, std::shared_ptr<const trf_ap>> cache;
+  size_t n_hits = 0;
+};
+
+/*!
+ * \brief synthetic_trf_cache the process wide cache used by calibration::gen_cal_sensor
+ */
+inline trf_cache &synthetic_trf_cache() {
+  static trf_cache cache;
+  return cache;
+}
+
 #endif // CAL_SYNTHETIC_H
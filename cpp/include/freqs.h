@@ -523,6 +523,13 @@ public:
     return fftresult;
   }
 
+  /*!
+   * \brief trim_fftw_result into out; out keeps its capacity, so a preallocated window buffer is not reallocated
+   */
+  void trim_fftw_result(const std::vector<std::complex<double>> &in_fftresult, std::vector<std::complex<double>> &out) const {
+    out.assign(in_fftresult.cbegin() + this->idx_range.first, in_fftresult.cbegin() + this->idx_range.second);
+  }
+
   std::vector<double> iter_freqs(const std::pair<std::vector<std::complex<double>>::iterator, std::vector<std::complex<double>>::iterator> &iter_range, std::vector<std::complex<double>> &fftresult) const {
     std::vector<double> freqs;
 
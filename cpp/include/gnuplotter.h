@@ -3,7 +3,9 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <list>
@@ -15,6 +17,12 @@
 #include <utility>
 #include <vector>
 
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 // a vector of point types "pt 1", "pt 2", "pt 3" and so on
 
 static std::vector<std::string> gplt_blues = {"web-blue", "royalblue", "steelblue", "light-blue", "blue", "dark-blue", "midnight-blue", "medium-blue", "skyblue", "slateblue"};
@@ -259,13 +267,13 @@ public:
     if (typeid(S) == typeid(double))
       this->data_format << "%float64";
     else if (typeid(S) == typeid(float))
-      this->data_format << "%int32";
+      this->data_format << "%float32";
     else if (typeid(S) == typeid(int32_t))
       this->data_format << "%int32";
     else if (typeid(S) == typeid(int64_t))
       this->data_format << "%int64";
     else {
-      std::string err_str = __func__;
+      err_str = __func__;
       err_str += "::yaxis can be double, float, int32_t or int64_t ONLY";
     }
     this->data_format << "'";
@@ -281,11 +289,39 @@ public:
     // do I explictly delete this
     // I get free(): double free detected in tcache 2
     // delete this->plotHandle;
+
+    // gnuplot has read the data after pclose; a script keeps its data files
+    if (this->outfile.empty()) {
+      std::error_code ec;
+      for (const auto &file : this->data_files)
+        std::filesystem::remove(file, ec);
+    }
+  }
+
+  /*!
+   * \brief set_data_file sends the data of the following set_xy_... / plot() through a binary file instead of the pipe;
+   * gnuplot reads the file directly (binary skip=... record=...). Temporary files are removed in the destructor;
+   * with a script file (outfile_) the data files are written next to the script and kept.
+   * \param use_file false: back to the pipe
+   * \param dir directory for the temporary files, default temp directory
+   */
+  void set_data_file(const bool use_file = true, const std::filesystem::path &dir = "") {
+    if (this->data_records.size()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::call before set_xy_..., data of " << this->data_records.size() << " plots pending";
+      throw std::runtime_error(err_str.str());
+    }
+    this->use_data_file = use_file;
+    this->data_dir = dir.empty() ? std::filesystem::temp_directory_path() : dir;
   }
 
   void plot() {
     std::ostringstream stmp;
 
+    // the data file must exist before gnuplot sees the plot line which reads it
+    if (this->data_buf.size() && this->use_data_file)
+      this->write_data_file(this->data_file_name(this->data_files.size()));
+
     fprintf(this->plotHandle, "%s", this->cmd.str().c_str());
     stmp << "plot ";
     size_t i = 0;
@@ -300,18 +336,12 @@ public:
       fprintf(this->plotHandle, "\n");
     }
     plt.clear();
-    if (this->xaxis.size() && (this->xaxis.size() == this->yaxis.size())) {
-      while (!this->xaxis.empty()) {
-        auto &x = this->xaxis.front();
-        auto &y = this->yaxis.front();
-        for (size_t i = 0; i < x.size(); ++i) {
-          fwrite(&x[i], sizeof(char), sizeof(T), this->plotHandle);
-          fwrite(&y[i], sizeof(char), sizeof(S), this->plotHandle);
-        }
-        this->xaxis.pop();
-        this->yaxis.pop();
-      }
+    if (this->data_buf.size() && !this->use_data_file) {
+      // blocks follow each other in the order of the plot command - one write for all
+      fwrite(this->data_buf.data(), sizeof(char), this->data_buf.size(), this->plotHandle);
     }
+    this->data_buf.clear();
+    this->data_records.clear();
     fprintf(this->plotHandle, "\n");
     fflush(this->plotHandle);
     // clear commands
@@ -545,9 +575,9 @@ public:
 
   void set_xy_points(const std::vector<T> &x, const std::vector<S> &y, const std::string title, const uint64_t ps, const std::string formats = "") {
 
-    this->set_data(x, y);
+    const size_t offset = this->set_data(x, y);
     std::ostringstream tmp;
-    tmp << "'-' binary record=(" << x.size() << ") " << this->data_format.str() << " with points ps " << ps;
+    tmp << this->data_source(offset) << " record=(" << x.size() << ") " << this->data_format.str() << " with points ps " << ps;
     if (formats.size())
       tmp << " " << formats;
     if (title.size())
@@ -557,9 +587,9 @@ public:
 
   void set_xy_lines(const std::vector<T> &x, const std::vector<S> &y, const std::string title, const uint64_t lw, const std::string formats = "") {
 
-    this->set_data(x, y);
+    const size_t offset = this->set_data(x, y);
     std::ostringstream tmp;
-    tmp << "'-' binary record=(" << x.size() << ") " << this->data_format.str() << " with lines" << this->set_lw(lw);
+    tmp << this->data_source(offset) << " record=(" << x.size() << ") " << this->data_format.str() << " with lines" << this->set_lw(lw);
     if (formats.size())
       tmp << " " << formats;
     if (title.size())
@@ -569,9 +599,9 @@ public:
 
   void set_xy_linespoints(const std::vector<T> &x, const std::vector<S> &y, const std::string &title, const uint64_t &lw, const uint64_t &ps, const std::string &formats = "") {
 
-    this->set_data(x, y);
+    const size_t offset = this->set_data(x, y);
     std::ostringstream tmp;
-    tmp << "'-' binary record=(" << x.size() << ") " << this->data_format.str() << " with linespoints" << this->set_lw(lw) << this->set_ps(ps);
+    tmp << this->data_source(offset) << " record=(" << x.size() << ") " << this->data_format.str() << " with linespoints" << this->set_lw(lw) << this->set_ps(ps);
     if (formats.size())
       tmp << " " << formats;
     if (title.size())
@@ -584,13 +614,16 @@ public:
 
   std::ostringstream data_format;
 
-  std::queue<std::vector<T>> xaxis;
-  std::queue<std::vector<S>> yaxis;
-
 private:
   FILE *plotHandle = nullptr;
   std::filesystem::path outfile;
 
+  std::vector<char> data_buf;      //!< x0 y0 x1 y1 ... of all pending plots, interleaved as gnuplot reads them
+  std::vector<size_t> data_records; //!< records of each pending plot
+  bool use_data_file = false;      //!< data via binary file instead of the pipe
+  std::filesystem::path data_dir;  //!< directory of the temporary data files
+  std::vector<std::filesystem::path> data_files; //!< one file per plot() call
+
   uint64_t max_sizes = 100;
 
   std::string set_lw(const uint64_t &lw) {
@@ -611,39 +644,86 @@ private:
     return tmp.str();
   }
 
-  void set_data(const std::vector<T> &x, const std::vector<S> &y) {
+  /*!
+   * \brief set_data appends x and y interleaved to the data buffer
+   * \return byte offset of this block in the buffer
+   */
+  size_t set_data(const std::vector<T> &x, const std::vector<S> &y) {
 
     if (x.size() != y.size()) {
       std::ostringstream err_str(__func__, std::ios_base::ate);
       err_str << "::vectors have different sizes! " << x.size() << ", " << y.size();
       throw std::runtime_error(err_str.str());
     }
-    this->xaxis.push(std::vector<T>(x));
-    this->yaxis.push(std::vector<S>(y));
+    const size_t offset = this->data_buf.size();
+    this->data_buf.resize(offset + x.size() * (sizeof(T) + sizeof(S)));
+    char *dst = this->data_buf.data() + offset;
+    for (size_t i = 0; i < x.size(); ++i) {
+      std::memcpy(dst, &x[i], sizeof(T));
+      dst += sizeof(T);
+      std::memcpy(dst, &y[i], sizeof(S));
+      dst += sizeof(S);
+    }
+    this->data_records.push_back(x.size());
+    return offset;
   }
 
-  void ascci_blocks() {
-    if (this->xaxis.size() && (this->xaxis.size() == this->yaxis.size())) {
-      while (!this->xaxis.empty()) {
-        this->data.clear();
-        this->data.str().clear();
-        this->data << std::scientific;
-        auto &x = this->xaxis.front();
-        auto &y = this->yaxis.front();
+  /*!
+   * \brief data_source the data part of a plot element: the pipe '-' or the data file of the next plot() with the byte offset of the block
+   */
+  std::string data_source(const size_t &offset) const {
+    if (!this->use_data_file)
+      return "'-' binary";
+    std::ostringstream tmp;
+    tmp << "'" << this->data_file_name(this->data_files.size()).string() << "' binary";
+    if (offset)
+      tmp << " skip=" << offset;
+    return tmp.str();
+  }
 
-        for (size_t i = 0; i < x.size(); ++i) {
-          this->data << x[i] << " " << y[i] << std::endl;
-        }
-        this->data << "e" << std::endl;
-        if (this->data.tellp() > 1) {
-          fprintf(this->plotHandle, "%s", this->data.str().c_str());
+  std::filesystem::path data_file_name(const size_t &n) const {
+    std::ostringstream nam;
+    if (!this->outfile.empty()) {
+      nam << this->outfile.stem().string() << "_" << n << ".bin";
+      return this->outfile.parent_path() / nam.str();
+    }
+#if defined(__unix__)
+    nam << "gplt_" << getpid() << "_" << static_cast<const void *>(this) << "_" << n << ".bin";
+#else
+    nam << "gplt_" << static_cast<const void *>(this) << "_" << n << ".bin";
+#endif
+    return this->data_dir / nam.str();
+  }
+
+  /*!
+   * \brief write_data_file writes the data buffer into a new memory mapped file, gnuplot reads it with the next command
+   */
+  void write_data_file(const std::filesystem::path &file) {
+    bool ok = false;
+#if defined(__unix__)
+    int fd = open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+      if (ftruncate(fd, off_t(this->data_buf.size())) == 0) {
+        void *ptr = mmap(nullptr, this->data_buf.size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (ptr != MAP_FAILED) {
+          std::memcpy(ptr, this->data_buf.data(), this->data_buf.size());
+          munmap(ptr, this->data_buf.size());
+          ok = true;
         }
-        this->xaxis.pop();
-        this->yaxis.pop();
       }
+      close(fd);
     }
-    this->data.clear();
-    this->data.str().clear();
+#else
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    out.write(this->data_buf.data(), std::streamsize(this->data_buf.size()));
+    ok = bool(out);
+#endif
+    if (!ok) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::can not write gnuplot data file " << file;
+      throw std::runtime_error(err_str.str());
+    }
+    this->data_files.push_back(file);
   }
 
   // copy from my library - this plotter may wants to be copied without dependencies
@@ -5,6 +5,10 @@
 #include <vector>
 #include <iostream>
 #include <iomanip>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 
 #include "strings_etc.h"
 #include "atsheader_def.h"
@@ -25,8 +29,9 @@ struct adu_channel {
 
 public:
 
-
-
+    std::string channel_type = "Ex"; //!< Ex, Ey, Hx, Hy, Hz
+    std::string sensor = "EFP-06";   //!< sensor name as used by cal_synthetic.h, e.g. MFS-06e
+    size_t channel_no = 0;           //!< channel number of the system
     time_t tt = 0;              //!< generates the ISO 8601 in UTC , as time_t seconds since 1970, can be negative in some implementaions
     double sample_rate = 512.0; //!< in Hz always
     size_t samples = 0;         //!< samples to record
@@ -39,7 +44,7 @@ class adu_job {
 
 public:
 
-    adu_job(const std::string &Name) {
+    adu_job(const std::string &Name) : Name(Name) {
         this->TypeNo = ats_sys_types.at(Name);
         size_t chans = 0;
         if (this->TypeNo == 0) chans = 5;       // ADU-07e
@@ -50,39 +55,103 @@ public:
 
         for (size_t i = 0; i < chans; ++i) {
             this->channels.emplace_back(std::make_shared<adu_channel>());
+            this->channels.back()->channel_no = i;
         }
+        // default set: the first 5 channels are the MT set, the system can have more
+        this->set_channel_types({"Ex", "Ey", "Hx", "Hy", "Hz"});
 
     }
-    bool set_start_time(const std::string &datetime) {
 
+    /*!
+     * \brief set_channel_types uses the first channels of the system for the types given; E: EFP-06, H: MFS-06e
+     * \param types e.g. Ex Ey Hx Hy Hz
+     */
+    void set_channel_types(const std::vector<std::string> &types) {
+        if (types.size() > this->channels.size()) {
+            std::ostringstream err_str(__func__, std::ios_base::ate);
+            err_str << "::" << this->Name << " has " << this->channels.size() << " channels only, " << types.size() << " requested";
+            throw std::runtime_error(err_str.str());
+        }
+        this->used = types.size();
+        for (size_t i = 0; i < types.size(); ++i) {
+            this->channels[i]->channel_type = types[i];
+            this->channels[i]->sensor = (types[i].size() && (types[i][0] == 'H')) ? "MFS-06e" : "EFP-06";
+        }
+    }
 
+    bool set_start_time(const std::string &datetime) {
+        this->start = mstr::time_t_iso_8601_str(datetime);
+        for (auto &chan : this->channels)
+            chan->tt = this->start;
         return true;
     }
 
     bool set_stop_time(const std::string &datetime) {
-
-
+        auto stop = mstr::time_t_iso_8601_str(datetime);
+        if (stop <= this->start)
+            return false;
+        this->duration = double(stop - this->start);
+        this->update_samples();
         return true;
     }
 
     bool set_duration(const std::string &days = "", const std::string &hours = "", const std::string &minutes = "", const std::string &seconds = "" ) {
-
-
+        double dur = 0;
+        if (days.size()) dur += std::stod(days) * 86400.0;
+        if (hours.size()) dur += std::stod(hours) * 3600.0;
+        if (minutes.size()) dur += std::stod(minutes) * 60.0;
+        if (seconds.size()) dur += std::stod(seconds);
+        if (dur <= 0)
+            return false;
+        this->duration = dur;
+        this->update_samples();
         return true;
     }
 
     bool set_sample_rate(const std::string &sample_rate) {
-
+        double sr = std::stod(sample_rate);
+        if ((sr <= 0.0) || (sr > 524288.0))
+            return false;
+        for (auto &chan : this->channels)
+            chan->sample_rate = sr;
+        this->update_samples();
         return true;
     }
 
+    std::vector<std::shared_ptr<adu_channel>> get_channels() const {
+        return std::vector<std::shared_ptr<adu_channel>>(this->channels.begin(), this->channels.begin() + this->used);
+    }
+
+    std::string get_name() const {
+        return this->Name;
+    }
 
+    double get_sample_rate() const {
+        return this->channels.size() ? this->channels.front()->sample_rate : 0.0;
+    }
+
+    double get_duration() const {
+        return this->duration;
+    }
+
+    time_t get_start() const {
+        return this->start;
+    }
 
 
 private:
 
+    void update_samples() {
+        for (auto &chan : this->channels)
+            chan->samples = size_t(this->duration * chan->sample_rate);
+    }
+
     std::vector<std::shared_ptr<adu_channel>> channels;
+    std::string Name;
     int TypeNo = 0;
+    size_t used = 0;            //!< channels in use, the first ones
+    time_t start = 0;           //!< start time of the job
+    double duration = 0;        //!< seconds
 };
 
 #endif // JOB_H
@@ -0,0 +1,313 @@
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <algorithm>
+#include <atomic>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+/*!
+ * @file memory_budget.h
+ * @brief bounded memory processing: choose per run how the raw spectra are kept - in memory, spilled to a memory mapped file or stacked online
+ */
+
+/*!
+ * \brief The spc_mode enum how the spectra of a run are handled
+ */
+enum class spc_mode {
+  in_memory, //!< all raw spectra in RAM (fastest, exact)
+  spill,     //!< raw spectra in a temporary memory mapped file (exact, RAM is only the page cache)
+  online     //!< stacked while reading (O(frequencies), median range mean approximated)
+};
+
+inline std::string spc_mode_to_string(const spc_mode mode) {
+  if (mode == spc_mode::in_memory)
+    return "in memory";
+  if (mode == spc_mode::spill)
+    return "spill";
+  return "online";
+}
+
+/*!
+ * \brief The spc_spill_file class is a temporary file of rows x cols complex values, mapped into memory;
+ * the file is unlinked immediately after creation - it disappears when the object is destroyed or the program crashes
+ */
+class spc_spill_file {
+public:
+  spc_spill_file(const std::filesystem::path &dir, const size_t &rows, const size_t &cols) : n_rows(rows), n_cols(cols) {
+#if defined(__unix__)
+    if (!rows || !cols) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::empty spill file " << rows << " x " << cols;
+      throw std::runtime_error(err_str.str());
+    }
+    std::string tmpl = (dir / "mth_spill_XXXXXX").string();
+    this->fd = mkstemp(tmpl.data());
+    if (this->fd < 0) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::can not create spill file in " << dir;
+      throw std::runtime_error(err_str.str());
+    }
+    unlink(tmpl.c_str());
+    this->bytes = rows * cols * sizeof(std::complex<double>);
+    if (ftruncate(this->fd, off_t(this->bytes)) != 0) {
+      close(this->fd);
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::can not allocate " << this->bytes << " bytes in " << dir;
+      throw std::runtime_error(err_str.str());
+    }
+    void *ptr = mmap(nullptr, this->bytes, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+    if (ptr == MAP_FAILED) {
+      close(this->fd);
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::can not map spill file " << this->bytes << " bytes";
+      throw std::runtime_error(err_str.str());
+    }
+    this->data = static_cast<std::complex<double> *>(ptr);
+#else
+    throw std::runtime_error("spc_spill_file: not supported on this platform");
+#endif
+  }
+
+  ~spc_spill_file() {
+#if defined(__unix__)
+    if (this->data != nullptr)
+      munmap(this->data, this->bytes);
+    if (this->fd >= 0)
+      close(this->fd);
+#endif
+  }
+
+  spc_spill_file(const spc_spill_file &) = delete;
+  spc_spill_file &operator=(const spc_spill_file &) = delete;
+
+  std::complex<double> *row(const size_t &j) {
+    return this->data + j * this->n_cols;
+  }
+
+  const std::complex<double> *row(const size_t &j) const {
+    return this->data + j * this->n_cols;
+  }
+
+  /*!
+   * \brief release_pages removes the pages from our resident set; the data stays in the file / page cache
+   */
+  void release_pages() {
+#if defined(__unix__)
+    madvise(this->data, this->bytes, MADV_DONTNEED);
+#endif
+  }
+
+  size_t rows() const {
+    return this->n_rows;
+  }
+
+  size_t cols() const {
+    return this->n_cols;
+  }
+
+  static bool supported() {
+#if defined(__unix__)
+    return true;
+#else
+    return false;
+#endif
+  }
+
+private:
+  size_t n_rows = 0;
+  size_t n_cols = 0;
+  size_t bytes = 0;
+  int fd = -1;
+  std::complex<double> *data = nullptr;
+};
+
+/*!
+ * \brief The run_memory_estimate struct bytes needed by one run for each mode
+ */
+struct run_memory_estimate {
+  size_t in_memory = 0;  //!< raw spectra (fftw queue and trimmed) of all channels
+  size_t spill_ram = 0;  //!< working buffers when spilled
+  size_t spill_disk = 0; //!< size of the spill files
+  size_t online = 0;     //!< accumulators
+  spc_mode mode = spc_mode::in_memory;
+  size_t planned = 0; //!< RAM of the chosen mode
+};
+
+/*!
+ * \brief The memory_budget class plans the spc_mode for each run and reports the peak memory
+ * The runs are processed at the same time (task_dag), so the sum of all planned RAM must fit into the budget.
+ * Runs are upgraded from online (smallest) to in memory, smallest first; the rest gets spill if it is exact where online is not (fraction < 1)
+ */
+class memory_budget {
+public:
+  /*!
+   * \brief memory_budget
+   * \param budget_bytes 0 means unlimited - everything in memory
+   * \param spill_dir directory for the spill files; empty: temp directory
+   */
+  memory_budget(const size_t &budget_bytes, const std::filesystem::path &spill_dir = "") : budget(budget_bytes), spill_dir(spill_dir) {
+    if (this->spill_dir.empty())
+      this->spill_dir = std::filesystem::temp_directory_path();
+  }
+
+  /*!
+   * \brief estimate memory of a run
+   * \param stacks windows per channel (samples / rl)
+   * \param full_fl length of the complete fftw result (wl / 2 + 1)
+   * \param fl trimmed length
+   * \param channels channels with fft
+   * \param spectra auto and cross spectra to stack
+   * \param block frequencies per block when stacking from the spill file
+   */
+  static run_memory_estimate estimate(const size_t &stacks, const size_t &full_fl, const size_t &fl, const size_t &channels, const size_t &spectra, const size_t &block = 64) {
+    const size_t cplx = sizeof(std::complex<double>);
+    run_memory_estimate est;
+    // queue of complete spectra and the trimmed vectors exist at the same time during prepare_raw_spc
+    est.in_memory = channels * stacks * (full_fl + fl) * cplx + spectra * fl * sizeof(double);
+    est.spill_ram = channels * (full_fl + fl) * cplx + 2 * stacks * block * cplx + spectra * fl * sizeof(double);
+    est.spill_disk = channels * stacks * fl * cplx;
+    // welford / cross power accumulators, quantile sketch (50 bins of count + sum) and its warm up buffer of 32 windows
+    est.online = channels * (full_fl + fl) * cplx + spectra * fl * (4 * cplx + 50 * 12 + 32 * sizeof(double) + sizeof(double));
+    return est;
+  }
+
+  /*!
+   * \brief plan sets mode and planned of each estimate
+   * \param runs estimates
+   * \param fraction_to_use < 1 means median range mean; online is approximate then and spill is preferred
+   * \return planned RAM of all runs
+   */
+  size_t plan(std::vector<run_memory_estimate> &runs, const double &fraction_to_use) const {
+    if (!this->budget) {
+      for (auto &r : runs) {
+        r.mode = spc_mode::in_memory;
+        r.planned = r.in_memory;
+      }
+      return this->planned_sum(runs);
+    }
+    for (auto &r : runs) {
+      r.mode = spc_mode::online;
+      r.planned = r.online;
+    }
+    size_t used = this->planned_sum(runs);
+    if (used > this->budget) {
+      std::cerr << "memory_budget: even online stacking needs " << to_mb(used) << " MB, budget is " << to_mb(this->budget) << " MB" << std::endl;
+      return used;
+    }
+    std::vector<size_t> order(runs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&runs](const size_t a, const size_t b) { return runs[a].in_memory < runs[b].in_memory; });
+    for (const auto &i : order) {
+      auto &r = runs[i];
+      if (r.in_memory <= r.online || (r.in_memory - r.online) <= (this->budget - used)) {
+        used = used - r.online + r.in_memory;
+        r.mode = spc_mode::in_memory;
+        r.planned = r.in_memory;
+      }
+    }
+    if (fraction_to_use >= 1.0 || !spc_spill_file::supported())
+      return used; // online is exact for the mean
+
+    uintmax_t disk_free = 0;
+    try {
+      disk_free = std::filesystem::space(this->spill_dir).available;
+    } catch (const std::filesystem::filesystem_error &e) {
+      std::cerr << "memory_budget: " << e.what() << std::endl;
+      return used;
+    }
+    for (const auto &i : order) {
+      auto &r = runs[i];
+      if (r.mode != spc_mode::online)
+        continue;
+      if (r.spill_disk < disk_free && (r.spill_ram <= r.online || (r.spill_ram - r.online) <= (this->budget - used))) {
+        used = used - r.online + r.spill_ram;
+        disk_free -= r.spill_disk;
+        r.mode = spc_mode::spill;
+        r.planned = r.spill_ram;
+      }
+    }
+    return used;
+  }
+
+  /*!
+   * \brief report prints the plan; names same order as runs
+   */
+  void report(const std::vector<run_memory_estimate> &runs, const std::vector<std::string> &names) const {
+    std::cout << "memory budget: " << (this->budget ? std::to_string(to_mb(this->budget)) + " MB" : std::string("unlimited")) << std::endl;
+    for (size_t i = 0; i < runs.size(); ++i) {
+      std::cout << "  " << std::setw(10) << std::left << ((i < names.size()) ? names[i] : std::to_string(i)) << std::right
+                << " in memory " << std::setw(8) << to_mb(runs[i].in_memory) << " MB, spill " << std::setw(8) << to_mb(runs[i].spill_disk) << " MB disk"
+                << ", online " << std::setw(8) << to_mb(runs[i].online) << " MB -> " << spc_mode_to_string(runs[i].mode) << std::endl;
+    }
+    std::cout << "  planned peak " << to_mb(this->planned_sum(runs)) << " MB" << std::endl;
+  }
+
+  std::filesystem::path get_spill_dir() const {
+    return this->spill_dir;
+  }
+
+  size_t get_budget() const {
+    return this->budget;
+  }
+
+  /*!
+   * \brief peak_rss maximum resident set size of this process so far in bytes (VmHWM)
+   */
+  static size_t peak_rss() {
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+      if (line.rfind("VmHWM:", 0) == 0) {
+        std::istringstream iss(line.substr(6));
+        size_t kb = 0;
+        iss >> kb;
+        return kb * 1024;
+      }
+    }
+#endif
+#if defined(__unix__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+      return size_t(usage.ru_maxrss) * 1024;
+#endif
+    return 0;
+  }
+
+  static size_t to_mb(const size_t &bytes) {
+    return (bytes + (1 << 20) - 1) >> 20;
+  }
+
+private:
+  size_t planned_sum(const std::vector<run_memory_estimate> &runs) const {
+    size_t sum = 0;
+    for (const auto &r : runs)
+      sum += r.planned;
+    return sum;
+  }
+
+  size_t budget = 0;                //!< bytes, 0 is unlimited
+  std::filesystem::path spill_dir;  //!< where the spill files go
+};
+
+#endif // MEMORY_BUDGET_H
@@ -9,6 +9,7 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <list>
 #include <mutex>
 #include <sstream>
 #include <string>
@@ -23,6 +24,21 @@
 
 using jsn = nlohmann::ordered_json;
 
+/*!
+ * @brief msg_row is a message as plain values, ready to be bound to a prepared statement; see msg_to_sqlite::to_row
+ */
+struct msg_row {
+  int idx = 0;        //!< row of the status table
+  int ref_idx = 0;    //!< reference to a detailed explanation
+  int severity = 0;   //!< 0 = info ... warning = 1 ... error = 2
+  int log_only = 0;   //!< do not update the status table
+  std::string date;   //!< date as text, as written by insert_into_table_log
+  std::string time;   //!< time as text
+  std::string sender; //!< also the name of the status table
+  std::string key;    //!< key
+  std::string value;  //!< value as text
+};
+
 /*!
  * @brief message_to_sqlite is the class for messages adds SQL commands to the JSON message;
  * @details it is like a  R O W  in a  T A B L E  of a database; the json data is  P R I V A T E  and can not be changed from outside: when running the rows of a table are fixed
@@ -177,6 +193,30 @@ public:
     return sst.str();
   }
 
+  /*!
+   * @brief to_row the values as text exactly as they appear in insert_into_table_log and update_table_status, without building SQL
+   */
+  msg_row to_row() const {
+    msg_row row;
+    row.idx = msg["idx"].get<int>();
+    row.ref_idx = msg["ref_idx"].get<int>();
+    row.severity = msg["severity"].get<int>();
+    row.log_only = msg["log_only"].get<int>();
+    for (auto &it : msg.items()) {
+      if (it.key() == "date")
+        row.date = to_text(it);
+      else if (it.key() == "time")
+        row.time = to_text(it);
+      else if (it.key() == "sender")
+        row.sender = to_text(it);
+      else if (it.key() == "key")
+        row.key = to_text(it);
+      else if (it.key() == "value")
+        row.value = to_text(it);
+    }
+    return row;
+  }
+
   void set_date_time(const std::string &date, const std::string &time) {
     msg["date"] = date;
     msg["time"] = time;
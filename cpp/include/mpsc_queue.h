@@ -0,0 +1,77 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/*!
+ * @file mpsc_queue.h
+ * @brief lock free multiple producer / single consumer queue; producers never wait for each other or for the consumer
+ *
+ * push is one allocation and one compare and swap; the consumer takes ALL queued elements with a single exchange
+ * and gets them in push order (per producer); see sqlite_batch_writer
+ */
+
+template <class T>
+class mpsc_queue {
+public:
+  mpsc_queue() = default;
+  mpsc_queue(const mpsc_queue &) = delete;
+  mpsc_queue &operator=(const mpsc_queue &) = delete;
+
+  ~mpsc_queue() {
+    this->consume_all([](T &&) {});
+  }
+
+  /*!
+   * \brief push from any thread
+   * \return true if the queue was empty before
+   */
+  bool push(T &&value) {
+    node *n = new node{std::move(value), this->head.load(std::memory_order_relaxed)};
+    while (!this->head.compare_exchange_weak(n->next, n, std::memory_order_release, std::memory_order_relaxed))
+      ;
+    return n->next == nullptr;
+  }
+
+  bool empty() const {
+    return this->head.load(std::memory_order_relaxed) == nullptr;
+  }
+
+  /*!
+   * \brief consume_all calls f(T &&) for all elements queued so far, oldest first; consumer thread only
+   * \return elements consumed
+   */
+  template <class F>
+  size_t consume_all(F &&f) {
+    node *n = this->head.exchange(nullptr, std::memory_order_acquire);
+    // the stack is newest first - reverse
+    node *fifo = nullptr;
+    while (n != nullptr) {
+      node *next = n->next;
+      n->next = fifo;
+      fifo = n;
+      n = next;
+    }
+    size_t i = 0;
+    while (fifo != nullptr) {
+      node *next = fifo->next;
+      f(std::move(fifo->value));
+      delete fifo;
+      fifo = next;
+      ++i;
+    }
+    return i;
+  }
+
+private:
+  struct node {
+    T value;
+    node *next;
+  };
+
+  std::atomic<node *> head{nullptr}; //!< newest element
+};
+
+#endif // MPSC_QUEUE_H
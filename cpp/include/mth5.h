@@ -0,0 +1,614 @@
+#ifndef MTH5_H
+#define MTH5_H
+
+#include <algorithm>
+#include <atomic>
+#include <complex>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <highfive/H5DataSet.hpp>
+#include <highfive/H5DataSpace.hpp>
+#include <highfive/H5File.hpp>
+#include <highfive/H5Group.hpp>
+
+#include "BS_thread_pool.h"
+#include "atss.h"
+#include "profiler.h"
+#include "survey.h"
+
+/*!
+ * @file mth5.h
+ * @brief export / import of a survey_d to / from ONE HDF5 file in the MTH5 layout (USGS, version 0.1.0: /Survey/Stations/station/run/channel)
+ *
+ * Each channel is a chunked, extendible 1D double dataset with shuffle and deflate; the atss JSON header is kept as attribute "atss_header",
+ * so export and import are lossless. The common MTH5 attributes (component, sample_rate, time_period.start, ...) are written as well.
+ * Needs HDF5 (serial is fine) and the vendored HighFive (include path oss/); only targets including this file link hdf5.
+ *
+ * HDF5 serial builds are NOT thread safe: all HDF5 calls of the writer run in ONE writer thread; the channel readers run in parallel in the pool
+ * and hand blocks of chunk size to the writer (bounded queue, recycled buffers).
+ * \code
+ *   auto survey = std::make_shared<survey_d>("/survey/Northern_Mining");
+ *   mth5_options opts;
+ *   opts.chunk = 1 << 16;
+ *   mth5_writer writer("/archive/Northern_Mining.h5", opts);
+ *   writer.write_survey(survey, pool);
+ *
+ *   mth5_reader reader("/archive/Northern_Mining.h5");
+ *   auto chans = reader.get_channels("Sarıçam", "run_001");
+ *   chans[0]->fft_freqs = fft_freqs; chans[0]->set_fftw_plan();
+ *   while (reader.read_fftw_window(chans[0], spc) > 0) ...
+ *   reader.to_survey("/survey/restored"); // .atss / .json again
+ * \endcode
+ */
+
+/*!
+ * \brief The mth5_options struct chunking and compression; the chunk is also the block size handed from the readers to the writer
+ */
+struct mth5_options {
+  size_t chunk = 65536;     //!< samples per HDF5 chunk (512 kB); small chunks compress worse, large chunks cost more for short windows
+  unsigned deflate = 4;     //!< gzip level 1 ... 9; 0 = no compression
+  bool shuffle = true;      //!< byte shuffle before deflate; the exponents of doubles compress much better
+  size_t max_blocks = 64;   //!< blocks in flight between the channel readers and the writer thread; limits the memory
+  size_t cache_chunks = 16; //!< chunk cache per dataset for reading; overlapping windows hit the same chunk again
+};
+
+/*!
+ * \brief mth5_channel_type MTH5 type of a channel: electric, magnetic or auxiliary
+ */
+inline std::string mth5_channel_type(const std::string &channel_type) {
+  if (channel_type.size() && ((channel_type[0] == 'E') || (channel_type[0] == 'e')))
+    return "electric";
+  if (channel_type.size() && ((channel_type[0] == 'H') || (channel_type[0] == 'h')))
+    return "magnetic";
+  return "auxiliary";
+}
+
+/*!
+ * \brief mth5_dataset_name MTH5 uses lower case components: ex, ey, hx ...
+ */
+inline std::string mth5_dataset_name(const std::string &channel_type) {
+  std::string name(channel_type);
+  std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+  return name;
+}
+
+/*!
+ * \brief mth5_attribute creates or overwrites an attribute of a group or dataset
+ */
+template <class Obj, class T>
+void mth5_attribute(Obj &obj, const std::string &name, const T &value) {
+  if (obj.hasAttribute(name))
+    obj.getAttribute(name).write(value);
+  else
+    obj.createAttribute(name, value);
+}
+
+/*!
+ * \brief The mth5_writer class writes channels into one MTH5 file; only the writer thread touches HDF5 while writing
+ * add_channel (all) -> start -> push (any thread) -> finish; or simply write_survey
+ */
+class mth5_writer {
+public:
+  /*!
+   * \brief mth5_writer creates (truncates) the file and the groups /Survey/Stations
+   * \param h5file file to write
+   * \param opts chunking and compression
+   */
+  mth5_writer(const std::filesystem::path &h5file, const mth5_options &opts = mth5_options())
+      : file(h5file.string(), HighFive::File::ReadWrite | HighFive::File::Create | HighFive::File::Truncate), opts(opts) {
+    if (!this->opts.chunk || !this->opts.max_blocks) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << " :: chunk and max_blocks must be > 0";
+      throw std::runtime_error(err_str.str());
+    }
+    HighFive::Group root = this->file.getGroup("/");
+    mth5_attribute(root, "file.type", std::string("MTH5"));
+    mth5_attribute(root, "file.version", std::string("0.1.0"));
+    mth5_attribute(root, "file.access.platform", std::string("MTHotel"));
+    HighFive::Group survey = this->file.createGroup("/Survey");
+    mth5_attribute(survey, "mth5_type", std::string("Survey"));
+    HighFive::Group stations = this->file.createGroup("/Survey/Stations");
+    mth5_attribute(stations, "mth5_type", std::string("Stations"));
+  }
+
+  ~mth5_writer() {
+    try {
+      this->finish();
+    } catch (const std::exception &e) {
+      std::cerr << "mth5_writer::" << __func__ << " " << e.what() << std::endl;
+    }
+  }
+
+  mth5_writer(const mth5_writer &) = delete;
+  mth5_writer &operator=(const mth5_writer &) = delete;
+
+  /*!
+   * \brief set_survey_id the id attribute of /Survey, e.g. the survey directory name
+   */
+  void set_survey_id(const std::string &id) {
+    this->no_writer_thread(__func__);
+    HighFive::Group survey = this->file.getGroup("/Survey");
+    mth5_attribute(survey, "id", id);
+  }
+
+  /*!
+   * \brief add_channel creates station and run group (if needed) and the dataset of the channel with its attributes; NOT while the writer thread runs
+   * \param chan channel, the header is taken from here
+   * \param station station name
+   * \param run run name like run_001
+   * \param n_samples size of the dataset; the dataset is extendible, push beyond enlarges it
+   * \return index for push
+   */
+  size_t add_channel(const std::shared_ptr<channel> &chan, const std::string &station, const std::string &run, const size_t &n_samples) {
+    this->no_writer_thread(__func__);
+    const std::string station_path = "/Survey/Stations/" + station;
+    const std::string run_path = station_path + "/" + run;
+    if (!this->file.exist(station_path)) {
+      HighFive::Group grp = this->file.createGroup(station_path);
+      mth5_attribute(grp, "mth5_type", std::string("Station"));
+      mth5_attribute(grp, "id", station);
+      mth5_attribute(grp, "location.latitude", chan->latitude);
+      mth5_attribute(grp, "location.longitude", chan->longitude);
+      mth5_attribute(grp, "location.elevation", chan->elevation);
+    }
+    if (!this->file.exist(run_path)) {
+      HighFive::Group grp = this->file.createGroup(run_path);
+      mth5_attribute(grp, "mth5_type", std::string("Run"));
+      mth5_attribute(grp, "id", run);
+      mth5_attribute(grp, "sample_rate", chan->get_sample_rate());
+      mth5_attribute(grp, "data_logger.id", std::string(chan->get_system() + "_" + std::to_string(chan->get_serial())));
+    }
+    const std::string ds_path = run_path + "/" + mth5_dataset_name(chan->get_channel_type());
+    if (this->file.exist(ds_path)) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << " :: " << ds_path << " already exists";
+      throw std::runtime_error(err_str.str());
+    }
+
+    HighFive::DataSetCreateProps props;
+    props.add(HighFive::Chunking(std::vector<hsize_t>{hsize_t(this->opts.chunk)}));
+    if (this->opts.deflate) {
+      if (this->opts.shuffle)
+        props.add(HighFive::Shuffle());
+      props.add(HighFive::Deflate(this->opts.deflate));
+    }
+    HighFive::DataSpace space({n_samples}, {HighFive::DataSpace::UNLIMITED});
+    HighFive::DataSet ds = this->file.createDataSet<double>(ds_path, space, props);
+
+    mth5_attribute(ds, "mth5_type", mth5_channel_type(chan->get_channel_type()));
+    mth5_attribute(ds, "type", mth5_channel_type(chan->get_channel_type()));
+    mth5_attribute(ds, "component", mth5_dataset_name(chan->get_channel_type()));
+    mth5_attribute(ds, "channel_number", int64_t(chan->get_channel_no()));
+    mth5_attribute(ds, "sample_rate", chan->get_sample_rate());
+    mth5_attribute(ds, "time_period.start", chan->start_datetime());
+    mth5_attribute(ds, "units", chan->units);
+    mth5_attribute(ds, "measurement_azimuth", chan->angle);
+    mth5_attribute(ds, "measurement_tilt", chan->tilt);
+    mth5_attribute(ds, "atss_name", chan->filename());
+    mth5_attribute(ds, "atss_header", chan->header_string());
+
+    this->datasets.emplace_back(std::move(ds));
+    this->sizes.push_back(n_samples);
+    return this->datasets.size() - 1;
+  }
+
+  /*!
+   * \brief start the writer thread; after add_channel
+   */
+  void start() {
+    if (this->writer.joinable())
+      return;
+    this->done = false;
+    this->error = nullptr;
+    this->writer = std::thread(&mth5_writer::run, this);
+  }
+
+  /*!
+   * \brief buffer an empty vector with capacity chunk - recycled from the blocks already written
+   */
+  std::vector<double> buffer() {
+    std::vector<double> buf;
+    {
+      std::lock_guard<std::mutex> lock(this->mtx);
+      if (this->free_buffers.size()) {
+        buf = std::move(this->free_buffers.back());
+        this->free_buffers.pop_back();
+      }
+    }
+    buf.clear();
+    buf.reserve(this->opts.chunk);
+    return buf;
+  }
+
+  /*!
+   * \brief push a block for the writer thread; from any thread, blocks if max_blocks are in flight
+   * \param idx from add_channel
+   * \param offset first sample of the block in the dataset
+   * \param data block, best taken from buffer()
+   */
+  void push(const size_t &idx, const size_t &offset, std::vector<double> &&data) {
+    if (idx >= this->datasets.size()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << " :: no dataset " << idx;
+      throw std::runtime_error(err_str.str());
+    }
+    std::unique_lock<std::mutex> lock(this->mtx);
+    this->cv_space.wait(lock, [this] { return (this->queue.size() < this->opts.max_blocks) || (this->error != nullptr); });
+    if (this->error != nullptr) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << " :: writer thread failed";
+      throw std::runtime_error(err_str.str());
+    }
+    this->queue.push_back(block{idx, offset, std::move(data)});
+    lock.unlock();
+    this->cv_data.notify_one();
+  }
+
+  /*!
+   * \brief finish writes all pending blocks, stops the writer thread and flushes the file; rethrows an error of the writer thread
+   */
+  void finish() {
+    if (this->writer.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->done = true;
+      }
+      this->cv_data.notify_one();
+      this->writer.join();
+    }
+    if (this->error != nullptr) {
+      auto err = this->error;
+      this->error = nullptr;
+      std::rethrow_exception(err);
+    }
+    this->file.flush();
+  }
+
+  /*!
+   * \brief write_survey exports all stations, runs and channels; the .atss files are read in parallel, HDF5 is written by one thread
+   * \param survey survey to export
+   * \param pool channel readers; nullptr: one thread (still overlapped with the writer thread)
+   * \return samples written
+   */
+  size_t write_survey(const std::shared_ptr<survey_d> &survey, std::shared_ptr<BS::thread_pool> pool = nullptr) {
+    mtprof::scoped_timer prof("mth5_write_survey", survey->get_name());
+    this->set_survey_id(survey->get_name());
+    std::vector<std::pair<std::shared_ptr<channel>, size_t>> jobs;
+    for (const auto &name : survey->get_station_names()) {
+      const auto station = survey->get_station(name);
+      for (const auto &run : station->runs) {
+        for (const auto &chan : run->get_channels()) {
+          jobs.emplace_back(chan, this->add_channel(chan, station->get_name(), run->get_name(), chan->samples()));
+        }
+      }
+    }
+    const size_t before = this->written();
+    this->start();
+    if (pool == nullptr)
+      pool = std::make_shared<BS::thread_pool>(1);
+    std::vector<std::future<void>> futures;
+    futures.reserve(jobs.size());
+    for (const auto &job : jobs) {
+      futures.emplace_back(pool->submit_task([this, job]() { this->read_channel(job.first, job.second); }));
+    }
+    std::exception_ptr read_error = nullptr;
+    for (auto &f : futures) {
+      try {
+        f.get();
+      } catch (...) {
+        if (read_error == nullptr)
+          read_error = std::current_exception();
+      }
+    }
+    // an error of the writer is the reason for the readers to fail: finish rethrows that first
+    this->finish();
+    if (read_error != nullptr)
+      std::rethrow_exception(read_error);
+    prof.arg("samples", double(this->written() - before));
+    return this->written() - before;
+  }
+
+  /*!
+   * \brief written samples so far
+   */
+  size_t written() const {
+    return this->n_written.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct block {
+    size_t idx;               //!< dataset
+    size_t offset;            //!< first sample
+    std::vector<double> data; //!< samples
+  };
+
+  void no_writer_thread(const char *func) const {
+    if (this->writer.joinable()) {
+      std::ostringstream err_str(func, std::ios_base::ate);
+      err_str << " :: not allowed while the writer thread runs";
+      throw std::runtime_error(err_str.str());
+    }
+  }
+
+  /*!
+   * \brief read_channel the .atss file in blocks of chunk size, pool thread
+   */
+  void read_channel(const std::shared_ptr<channel> &chan, const size_t &idx) {
+    std::ifstream file(chan->get_atss_filepath(), std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << " :: can not open " << chan->get_atss_filepath();
+      throw std::runtime_error(err_str.str());
+    }
+    size_t offset = 0;
+    for (;;) {
+      std::vector<double> buf = this->buffer();
+      buf.resize(this->opts.chunk);
+      file.read(static_cast<char *>(static_cast<void *>(buf.data())), std::streamsize(buf.size() * sizeof(double)));
+      const size_t n = size_t(file.gcount()) / sizeof(double);
+      if (!n)
+        break;
+      buf.resize(n);
+      this->push(idx, offset, std::move(buf));
+      offset += n;
+      if (n < this->opts.chunk)
+        break;
+    }
+  }
+
+  /*!
+   * \brief run writer thread: the only thread writing to HDF5
+   */
+  void run() {
+    std::deque<block> work;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(this->mtx);
+        this->cv_data.wait(lock, [this] { return this->queue.size() || this->done; });
+        if (this->queue.empty() && this->done)
+          return;
+        work.swap(this->queue);
+      }
+      this->cv_space.notify_all();
+      try {
+        for (auto &blk : work) {
+          const size_t end = blk.offset + blk.data.size();
+          if (end > this->sizes[blk.idx]) {
+            this->datasets[blk.idx].resize({end});
+            this->sizes[blk.idx] = end;
+          }
+          this->datasets[blk.idx].select({blk.offset}, {blk.data.size()}).write_raw(blk.data.data());
+          this->n_written.fetch_add(blk.data.size(), std::memory_order_relaxed);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->error = std::current_exception();
+        this->queue.clear();
+        this->cv_space.notify_all();
+        return;
+      }
+      std::lock_guard<std::mutex> lock(this->mtx);
+      for (auto &blk : work) {
+        if (this->free_buffers.size() < this->opts.max_blocks)
+          this->free_buffers.emplace_back(std::move(blk.data));
+      }
+      work.clear();
+    }
+  }
+
+  HighFive::File file;
+  mth5_options opts;
+  std::vector<HighFive::DataSet> datasets; //!< index from add_channel
+  std::vector<size_t> sizes;               //!< current size of the datasets
+
+  std::mutex mtx;
+  std::condition_variable cv_data;                //!< writer waits for blocks
+  std::condition_variable cv_space;               //!< producers wait for space in the queue
+  std::deque<block> queue;                        //!< blocks in flight
+  std::vector<std::vector<double>> free_buffers;  //!< written blocks, recycled by buffer()
+  bool done = false;                              //!< finish was called
+  std::exception_ptr error = nullptr;             //!< error of the writer thread
+  std::atomic<size_t> n_written{0};               //!< samples
+  std::thread writer;
+};
+
+/*!
+ * \brief The mth5_reader class reads an MTH5 file written by mth5_writer: channels with their headers, windows directly into the FFT buffers of the channel
+ * not thread safe (HDF5 serial); use one reader per thread or read from one thread and process in others
+ */
+class mth5_reader {
+public:
+  mth5_reader(const std::filesystem::path &h5file, const mth5_options &opts = mth5_options()) : file(h5file.string(), HighFive::File::ReadOnly), opts(opts) {
+    if (!this->file.exist("/Survey/Stations")) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << " :: no /Survey/Stations in " << h5file;
+      throw std::runtime_error(err_str.str());
+    }
+  }
+
+  std::vector<std::string> get_station_names() const {
+    return this->file.getGroup("/Survey/Stations").listObjectNames();
+  }
+
+  std::vector<std::string> get_run_names(const std::string &station) const {
+    return this->file.getGroup("/Survey/Stations/" + station).listObjectNames();
+  }
+
+  /*!
+   * \brief get_channels of a run, created from the attributes; the file path is station/run/name (relative, no files) - get_site_name() and get_run() work
+   * \param station station name
+   * \param run run name like run_001
+   * \return channels, the samples are the dataset size
+   */
+  std::vector<std::shared_ptr<channel>> get_channels(const std::string &station, const std::string &run) {
+    std::vector<std::shared_ptr<channel>> chans;
+    const std::string run_path = "/Survey/Stations/" + station + "/" + run;
+    HighFive::Group grp = this->file.getGroup(run_path);
+    for (const auto &name : grp.listObjectNames()) {
+      if (grp.getObjectType(name) != HighFive::ObjectType::Dataset)
+        continue;
+      HighFive::DataSetAccessProps access;
+      access.add(HighFive::Caching(521, this->opts.cache_chunks * this->opts.chunk * sizeof(double)));
+      HighFive::DataSet ds = grp.getDataSet(name, access);
+      std::string atss_name, atss_header;
+      ds.getAttribute("atss_name").read(atss_name);
+      ds.getAttribute("atss_header").read(atss_header);
+      auto chan = std::make_shared<channel>();
+      // serial, system, channel number, type and sample rate come from the file name
+      chan->parse_json_filename(std::filesystem::path(station) / run / (atss_name + ".json"), false);
+      chan->from_header_string(atss_header, run_path + "/" + name);
+      chan->pt.samples = ds.getElementCount();
+      this->cursors.emplace(chan, cursor{ds, 0, ds.getElementCount()});
+      chans.emplace_back(chan);
+    }
+    std::sort(chans.begin(), chans.end(), compare_channel_name_lt);
+    return chans;
+  }
+
+  /*!
+   * \brief goto_sample_pos moves the read position of the channel; same as channel::goto_sample_pos for files
+   */
+  void goto_sample_pos(const std::shared_ptr<channel> &chan, const size_t &sample_pos) {
+    this->get_cursor(chan, __func__).pos = sample_pos;
+  }
+
+  /*!
+   * \brief read_window reads the next read length samples into data; the step is ts_chunk.size() if set (overlapping) or the read length
+   * \param chan channel from get_channels with fft_freqs
+   * \param data resized to the read length if needed
+   * \return sample position after the window like channel::read_bin, -1 at the end (incomplete windows are not read)
+   */
+  int64_t read_window(const std::shared_ptr<channel> &chan, std::vector<double> &data) {
+    auto &cur = this->get_cursor(chan, __func__);
+    const size_t rl = (chan->fft_freqs != nullptr) ? chan->fft_freqs->get_rl() : data.size();
+    if (!rl || (cur.pos + rl > cur.n))
+      return -1;
+    if (data.size() != rl)
+      data.resize(rl);
+    cur.ds.select({cur.pos}, {rl}).read(data.data());
+    chan->read_pos.first = int64_t(cur.pos);
+    chan->read_pos.second = int64_t(cur.pos + rl);
+    cur.pos += chan->ts_chunk.size() ? chan->ts_chunk.size() : rl;
+    chan->read_count++;
+    return chan->read_pos.second;
+  }
+
+  /*!
+   * \brief read_fftw_window reads into ts_slice (the fftw plan input) and transforms like channel::read_fftw_window
+   * \param out trimmed spectrum of the window
+   * \return same as read_window
+   */
+  int64_t read_fftw_window(const std::shared_ptr<channel> &chan, std::vector<std::complex<double>> &out, const bool bcal = true, const bool bwincal = true) {
+    const int64_t reads = this->read_window(chan, chan->ts_slice);
+    if (reads > 0)
+      chan->fftw_window(out, bcal, bwincal);
+    return reads;
+  }
+
+  /*!
+   * \brief read_all_fftw fills chan->qspc with the untrimmed spectra like channel::read_all_fftw
+   */
+  void read_all_fftw(const std::shared_ptr<channel> &chan) {
+    mtprof::scoped_timer prof("mth5_read_all_fftw", chan->prof_name());
+    while (!chan->qspc.empty())
+      chan->qspc.pop();
+    while (this->read_window(chan, chan->ts_slice) > 0) {
+      detrend_and_hanning<double>(chan->ts_slice.begin(), chan->ts_slice.end());
+      if (chan->ts_slice_padded.size()) {
+        for (size_t i = 0; i < chan->ts_slice.size(); ++i) {
+          chan->ts_slice_padded[i] = chan->ts_slice[i]; // copy first part; rest is zero
+        }
+      }
+      fftw_execute(chan->plan);
+      chan->qspc.push(chan->spc_slice);
+    }
+    prof.arg("windows", double(chan->qspc.size()));
+  }
+
+  /*!
+   * \brief read_all complete time series of the channel
+   */
+  std::vector<double> read_all(const std::shared_ptr<channel> &chan) {
+    auto &cur = this->get_cursor(chan, __func__);
+    std::vector<double> data(cur.n);
+    if (cur.n)
+      cur.ds.read(data.data());
+    return data;
+  }
+
+  /*!
+   * \brief to_survey imports the file as survey: stations/station/run_nnn with .json and .atss files, block wise
+   * \param survey_dir created if not existing; throws if a station exists already
+   * \return channels written
+   */
+  size_t to_survey(const std::filesystem::path &survey_dir) {
+    mtprof::scoped_timer prof("mth5_to_survey", survey_dir.filename().string());
+    auto survey = std::make_shared<survey_d>(survey_dir, false);
+    size_t n_chan = 0;
+    std::vector<double> buf;
+    for (const auto &station : this->get_station_names()) {
+      const auto station_dir = survey->create_station(station);
+      for (const auto &run : this->get_run_names(station)) {
+        const auto run_dir = station_dir / run;
+        std::filesystem::create_directories(run_dir);
+        for (auto &chan : this->get_channels(station, run)) {
+          chan->set_dir(run_dir);
+          chan->write_header();
+          auto &cur = this->get_cursor(chan, __func__);
+          std::ofstream out(chan->get_atss_filepath(), std::ios::out | std::ios::trunc | std::ios::binary);
+          if (!out.is_open()) {
+            std::ostringstream err_str(__func__, std::ios_base::ate);
+            err_str << " :: can not write " << chan->get_atss_filepath();
+            throw std::runtime_error(err_str.str());
+          }
+          for (size_t pos = 0; pos < cur.n; pos += this->opts.chunk) {
+            buf.resize(std::min(this->opts.chunk, cur.n - pos));
+            cur.ds.select({pos}, {buf.size()}).read(buf.data());
+            out.write(static_cast<char *>(static_cast<void *>(buf.data())), std::streamsize(buf.size() * sizeof(double)));
+          }
+          out.close();
+          this->cursors.erase(chan);
+          ++n_chan;
+        }
+      }
+    }
+    prof.arg("channels", double(n_chan));
+    return n_chan;
+  }
+
+private:
+  struct cursor {
+    HighFive::DataSet ds;
+    size_t pos = 0; //!< next sample to read
+    size_t n = 0;   //!< samples in the dataset
+  };
+
+  cursor &get_cursor(const std::shared_ptr<channel> &chan, const char *func) {
+    auto it = this->cursors.find(chan);
+    if (it == this->cursors.end()) {
+      std::ostringstream err_str(func, std::ios_base::ate);
+      err_str << " :: channel was not created by this reader";
+      throw std::runtime_error(err_str.str());
+    }
+    return it->second;
+  }
+
+  HighFive::File file;
+  mth5_options opts;
+  std::map<std::shared_ptr<channel>, cursor> cursors; //!< datasets and read positions of the channels handed out
+};
+
+#endif // MTH5_H
@@ -0,0 +1,346 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BS_thread_pool.h"
+#include "json.h"
+
+/*!
+ * @file profiler.h
+ * @brief scoped timers and counters for the processing chain; summary table and Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev)
+ *
+ * Disabled by default: a timer costs one relaxed atomic load and a branch. Compiled with MTH_NO_PROFILE everything is removed by the compiler.
+ * Events are meant for coarse sections: per run, per channel, per task - not per FFT window; use section_timer for short, frequent sections.
+ * \code
+ *   mtprof::enable();
+ *   {
+ *     mtprof::scoped_timer st("read_all_fftw", chan->get_name());
+ *     st.arg("bytes", bytes);
+ *   }
+ *   mtprof::summary(std::cout);
+ *   mtprof::write_chrome_trace("trace.json");
+ * \endcode
+ */
+
+namespace mtprof {
+
+using clock = std::chrono::steady_clock;
+
+/*!
+ * \brief The event struct is a finished section
+ */
+struct event {
+  std::string name;                                 //!< stage, e.g. read_all_fftw; the summary groups by name
+  std::string detail;                               //!< e.g. run and channel; empty if not needed
+  int64_t start_ns = 0;                             //!< since enable()
+  int64_t dur_ns = 0;                               //!< duration
+  uint32_t tid = 0;                                 //!< 0 main thread (or any thread not in a pool), pool threads 1 ... n
+  std::vector<std::pair<std::string, double>> args; //!< numbers shown with the event, e.g. bytes, windows
+};
+
+/*!
+ * \brief The counter_stats struct accumulates a counter, e.g. bytes read or queue wait
+ */
+struct counter_stats {
+  size_t n = 0;
+  double sum = 0.0;
+  double max = 0.0;
+};
+
+/*!
+ * \brief The profiler class collects events and counters of all threads; use the free functions below
+ */
+class profiler {
+public:
+  static profiler &instance() {
+    static profiler prof;
+    return prof;
+  }
+
+  void enable() {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->t0 = clock::now();
+    this->on.store(true, std::memory_order_relaxed);
+  }
+
+  void disable() {
+    this->on.store(false, std::memory_order_relaxed);
+  }
+
+  bool enabled() const {
+    return this->on.load(std::memory_order_relaxed);
+  }
+
+  int64_t since_start(const clock::time_point &t) const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t - this->t0).count();
+  }
+
+  void add_event(event &&ev) {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->events.emplace_back(std::move(ev));
+  }
+
+  void count(const std::string &name, const double &value) {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    auto &c = this->counters[name];
+    ++c.n;
+    c.sum += value;
+    c.max = std::max(c.max, value);
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->events.clear();
+    this->counters.clear();
+  }
+
+  /*!
+   * \brief summary table per stage: calls, total, mean and max time, the slowest detail; then the counters
+   * the slowest detail shows e.g. the channel which stalls a station
+   */
+  void summary(std::ostream &os) const {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    struct stage {
+      size_t n = 0;
+      int64_t total = 0;
+      int64_t max = 0;
+      std::string slowest;
+    };
+    std::map<std::string, stage> stages;
+    int64_t first = INT64_MAX, last = 0;
+    for (const auto &ev : this->events) {
+      auto &st = stages[ev.name];
+      ++st.n;
+      st.total += ev.dur_ns;
+      if (ev.dur_ns >= st.max) {
+        st.max = ev.dur_ns;
+        st.slowest = ev.detail;
+      }
+      first = std::min(first, ev.start_ns);
+      last = std::max(last, ev.start_ns + ev.dur_ns);
+    }
+    // sort by total time, largest first
+    std::vector<std::pair<std::string, stage>> sorted(stages.begin(), stages.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) { return a.second.total > b.second.total; });
+
+    const auto old_flags = os.flags();
+    const auto old_prec = os.precision();
+    os << std::fixed << std::setprecision(3);
+    if (this->events.size())
+      os << "profile: " << this->events.size() << " events in " << double(last - first) * 1.0E-6 << " ms wall time" << std::endl;
+    os << std::left << std::setw(28) << "stage" << std::right << std::setw(8) << "calls" << std::setw(14) << "total ms" << std::setw(12) << "mean ms" << std::setw(12) << "max ms"
+       << "  slowest" << std::endl;
+    for (const auto &st : sorted) {
+      os << std::left << std::setw(28) << st.first << std::right << std::setw(8) << st.second.n << std::setw(14) << double(st.second.total) * 1.0E-6
+         << std::setw(12) << double(st.second.total) * 1.0E-6 / double(st.second.n) << std::setw(12) << double(st.second.max) * 1.0E-6 << "  " << st.second.slowest << std::endl;
+    }
+    if (this->counters.size()) {
+      os << std::left << std::setw(28) << "counter" << std::right << std::setw(8) << "n" << std::setw(14) << "sum" << std::setw(12) << "mean" << std::setw(12) << "max" << std::endl;
+      for (const auto &c : this->counters) {
+        os << std::left << std::setw(28) << c.first << std::right << std::setw(8) << c.second.n << std::setw(14) << c.second.sum << std::setw(12) << c.second.sum / double(c.second.n)
+           << std::setw(12) << c.second.max << std::endl;
+      }
+    }
+    os.flags(old_flags);
+    os.precision(old_prec);
+  }
+
+  /*!
+   * \brief write_chrome_trace writes all events as complete events ("ph": "X") in microseconds; counters go to otherData
+   * \return false if the file can not be written
+   */
+  bool write_chrome_trace(const std::filesystem::path &file) const {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    nlohmann::ordered_json trace;
+    trace["displayTimeUnit"] = "ms";
+    auto &tev = trace["traceEvents"] = nlohmann::ordered_json::array();
+    std::vector<uint32_t> tids;
+    for (const auto &ev : this->events) {
+      nlohmann::ordered_json j;
+      j["name"] = ev.detail.size() ? ev.name + " " + ev.detail : ev.name;
+      j["cat"] = ev.name;
+      j["ph"] = "X";
+      j["ts"] = double(ev.start_ns) * 1.0E-3;
+      j["dur"] = double(ev.dur_ns) * 1.0E-3;
+      j["pid"] = 1;
+      j["tid"] = ev.tid;
+      if (ev.args.size()) {
+        for (const auto &a : ev.args)
+          j["args"][a.first] = a.second;
+      }
+      tev.push_back(j);
+      if (std::find(tids.begin(), tids.end(), ev.tid) == tids.end())
+        tids.push_back(ev.tid);
+    }
+    for (const auto &tid : tids) {
+      nlohmann::ordered_json j;
+      j["name"] = "thread_name";
+      j["ph"] = "M";
+      j["pid"] = 1;
+      j["tid"] = tid;
+      j["args"]["name"] = tid ? ("pool " + std::to_string(tid - 1)) : std::string("main");
+      tev.push_back(j);
+    }
+    for (const auto &c : this->counters) {
+      trace["otherData"][c.first]["n"] = c.second.n;
+      trace["otherData"][c.first]["sum"] = c.second.sum;
+      trace["otherData"][c.first]["max"] = c.second.max;
+    }
+    std::ofstream out(file);
+    if (!out.is_open())
+      return false;
+    out << trace.dump() << std::endl;
+    return out.good();
+  }
+
+private:
+  profiler() = default;
+
+  std::atomic<bool> on{false};
+  clock::time_point t0 = clock::now();
+  mutable std::mutex mtx;
+  std::vector<event> events;
+  std::map<std::string, counter_stats> counters;
+};
+
+inline bool enabled() {
+#ifdef MTH_NO_PROFILE
+  return false;
+#else
+  return profiler::instance().enabled();
+#endif
+}
+
+inline void enable() {
+  profiler::instance().enable();
+}
+
+inline void disable() {
+  profiler::instance().disable();
+}
+
+inline void count(const std::string &name, const double &value) {
+  if (enabled())
+    profiler::instance().count(name, value);
+}
+
+inline void summary(std::ostream &os) {
+  profiler::instance().summary(os);
+}
+
+inline bool write_chrome_trace(const std::filesystem::path &file) {
+  return profiler::instance().write_chrome_trace(file);
+}
+
+/*!
+ * \brief thread_id 0 for the main thread, 1 ... n for the threads of a BS::thread_pool
+ */
+inline uint32_t thread_id() {
+  const auto idx = BS::this_thread::get_index();
+  return idx.has_value() ? uint32_t(idx.value() + 1) : 0;
+}
+
+/*!
+ * \brief The scoped_timer class records an event from construction to destruction (or stop())
+ */
+class scoped_timer {
+public:
+  scoped_timer(const char *name, const std::string &detail = "") : active(enabled()) {
+    if (this->active) {
+      this->ev.name = name;
+      this->ev.detail = detail;
+      this->start = clock::now();
+    }
+  }
+
+  ~scoped_timer() {
+    this->stop();
+  }
+
+  scoped_timer(const scoped_timer &) = delete;
+  scoped_timer &operator=(const scoped_timer &) = delete;
+
+  /*!
+   * \brief arg adds a number to the event, e.g. bytes or windows
+   */
+  void arg(const char *key, const double &value) {
+    if (this->active)
+      this->ev.args.emplace_back(key, value);
+  }
+
+  /*!
+   * \brief stop ends the section early; the destructor does nothing then
+   */
+  void stop() {
+    if (!this->active)
+      return;
+    this->active = false;
+    const auto end = clock::now();
+    auto &prof = profiler::instance();
+    this->ev.start_ns = prof.since_start(this->start);
+    this->ev.dur_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - this->start).count();
+    this->ev.tid = thread_id();
+    prof.add_event(std::move(this->ev));
+  }
+
+  bool is_active() const {
+    return this->active;
+  }
+
+private:
+  bool active;
+  clock::time_point start;
+  event ev;
+};
+
+/*!
+ * \brief The section_timer class sums up many short sections, e.g. the FFT of each window; report ms() as arg or counter at the end
+ */
+class section_timer {
+public:
+  section_timer() : active(enabled()) {
+  }
+
+  void begin() {
+    if (this->active)
+      this->t = clock::now();
+  }
+
+  void end() {
+    if (this->active) {
+      this->ns += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - this->t).count();
+      ++this->n;
+    }
+  }
+
+  double ms() const {
+    return double(this->ns) * 1.0E-6;
+  }
+
+  size_t calls() const {
+    return this->n;
+  }
+
+private:
+  bool active;
+  clock::time_point t;
+  int64_t ns = 0;
+  size_t n = 0;
+};
+
+} // namespace mtprof
+
+#endif // PROFILER_H
@@ -98,6 +98,14 @@ public:
    * @param chan the channel object can be set to be remote or emap; this will be considered
    */
   void add_spectra(std::shared_ptr<channel> chan) {
+    auto name = std::pair<std::string, std::string>(spectra_name(chan), "");
+    this->add_spectra(name, chan->spc, chan->bw, true);
+  }
+
+  /*!
+   * @brief spectra_name name of the channel inside the collection, e.g. Hx, RHx (remote) or EEx (emap)
+   */
+  static std::string spectra_name(const std::shared_ptr<channel> &chan) {
     std::string name_in = chan->channel_type;
     if (is_E(name_in) && chan->is_emap && !chan->is_remote) {
       name_in = "E" + name_in;
@@ -105,8 +113,7 @@ public:
     if (!chan->is_emap && chan->is_remote) {
       name_in = "R" + name_in;
     }
-    auto name = std::pair<std::string, std::string>(name_in, "");
-    this->add_spectra(name, chan->spc, chan->bw, true);
+    return name_in;
   }
 
   // ******************************************************  R E T R I E V I N G   S P E C T R A  ****************************************************************
@@ -0,0 +1,217 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+/*!
+ * @file spsc_ring.h
+ * @brief lock free single producer / single consumer ring of preallocated blocks; replaces threadbuffer for the window pipeline
+ *
+ * The slots are created once (e.g. vectors of window length) and handed over by reference - no swap, no allocation, no mutex.
+ * Producer and consumer work in batches: acquire / publish n slots, fetch / release n slots; one atomic store per batch.
+ * A waiting side spins first and parks (C++20 atomic wait) afterwards; the other side only notifies if somebody is parked.
+ * \code
+ *   spsc_ring<std::vector<double>> ring(64, [](std::vector<double> &v) { v.resize(1024); });
+ *   // producer thread                            // consumer thread
+ *   size_t n = ring.acquire(8);                   size_t n = ring.fetch(8);
+ *   for (i < n) fill(ring.write_slot(i));         for (i < n) use(ring.read_slot(i));
+ *   ring.publish(n);                              ring.release(n);
+ *   ring.close(); // at the end                   // fetch returns 0 when closed and empty
+ * \endcode
+ */
+
+/*!
+ * \brief The spsc_ring class; exactly ONE producer thread and ONE consumer thread
+ * close() can be called by both: the producer says "no more data" (the consumer drains the ring), the consumer cancels the producer
+ */
+template <class T>
+class spsc_ring {
+public:
+  /*!
+   * \brief spsc_ring
+   * \param capacity slots; rounded up to a power of two
+   * \param init called once for each slot, e.g. resize to the block size
+   * \param spins polling rounds before a waiting thread parks; 0 parks immediately
+   */
+  spsc_ring(const size_t &capacity, const std::function<void(T &)> &init = nullptr, const size_t &spins = 4096) : spins(spins) {
+    if (!capacity) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << " :: capacity must be > 0";
+      throw std::runtime_error(err_str.str());
+    }
+    size_t cap = 1;
+    while (cap < capacity)
+      cap <<= 1;
+    this->mask = cap - 1;
+    this->slots.resize(cap);
+    if (init) {
+      for (auto &s : this->slots)
+        init(s);
+    }
+  }
+
+  spsc_ring(const spsc_ring &) = delete;
+  spsc_ring &operator=(const spsc_ring &) = delete;
+
+  size_t capacity() const {
+    return this->slots.size();
+  }
+
+  //////////////////////////////////////////////////////////// producer
+
+  /*!
+   * \brief acquire waits for at least one free slot
+   * \param max_slots batch size wanted
+   * \return free slots (1 ... max_slots) to fill with write_slot(0 ... n-1); 0 if the ring was closed
+   */
+  size_t acquire(const size_t &max_slots = 1) {
+    const size_t tail = this->prod.pos.load(std::memory_order_relaxed);
+    size_t n_free = this->capacity() - (tail - this->prod.cached);
+    if (!n_free) {
+      n_free = this->wait(this->prod, this->cons.pos, this->cons_wake, [&](const size_t &head) { return this->capacity() - (tail - head); });
+      if (!n_free)
+        return 0;
+    }
+    if (this->is_closed())
+      return 0;
+    return (n_free < max_slots) ? n_free : max_slots;
+  }
+
+  T &write_slot(const size_t &i) {
+    return this->slots[(this->prod.pos.load(std::memory_order_relaxed) + i) & this->mask];
+  }
+
+  /*!
+   * \brief publish hands n filled slots to the consumer
+   */
+  void publish(const size_t &n) {
+    if (!n)
+      return;
+    this->prod.pos.store(this->prod.pos.load(std::memory_order_relaxed) + n, std::memory_order_seq_cst);
+    this->wake(this->cons.parked, this->prod_wake);
+  }
+
+  //////////////////////////////////////////////////////////// consumer
+
+  /*!
+   * \brief fetch waits for at least one filled slot
+   * \param max_slots batch size wanted
+   * \return filled slots (1 ... max_slots) to read with read_slot(0 ... n-1); 0 if the ring is closed AND empty
+   */
+  size_t fetch(const size_t &max_slots = 1) {
+    const size_t head = this->cons.pos.load(std::memory_order_relaxed);
+    size_t filled = this->cons.cached - head;
+    if (!filled) {
+      filled = this->wait(this->cons, this->prod.pos, this->prod_wake, [&](const size_t &tail) { return tail - head; });
+      if (!filled)
+        return 0;
+    }
+    return (filled < max_slots) ? filled : max_slots;
+  }
+
+  T &read_slot(const size_t &i) {
+    return this->slots[(this->cons.pos.load(std::memory_order_relaxed) + i) & this->mask];
+  }
+
+  /*!
+   * \brief release gives n consumed slots back to the producer
+   */
+  void release(const size_t &n) {
+    if (!n)
+      return;
+    this->cons.pos.store(this->cons.pos.load(std::memory_order_relaxed) + n, std::memory_order_seq_cst);
+    this->wake(this->prod.parked, this->cons_wake);
+  }
+
+  //////////////////////////////////////////////////////////// both
+
+  /*!
+   * \brief close wakes both sides; acquire returns 0 from now on, fetch returns 0 when the ring is empty
+   */
+  void close() {
+    this->closed.store(true, std::memory_order_seq_cst);
+    this->prod_wake.fetch_add(1, std::memory_order_seq_cst);
+    this->prod_wake.notify_all();
+    this->cons_wake.fetch_add(1, std::memory_order_seq_cst);
+    this->cons_wake.notify_all();
+  }
+
+  bool is_closed() const {
+    return this->closed.load(std::memory_order_acquire);
+  }
+
+  /*!
+   * \brief parks how often a side had to sleep; high numbers: ring too small or spins too low
+   */
+  size_t parks() const {
+    return this->prod.n_parks + this->cons.n_parks;
+  }
+
+private:
+  static constexpr size_t cache_line = 64;
+
+  /*!
+   * \brief The side struct is owned by one thread; pos is read by the other - one cache line each, no false sharing
+   */
+  struct alignas(cache_line) side {
+    std::atomic<size_t> pos{0};      //!< tail for the producer, head for the consumer; counts up, index is pos & mask
+    std::atomic<bool> parked{false}; //!< set while sleeping; the other side notifies only then
+    size_t cached = 0;               //!< last seen pos of the other side, avoids reading the other cache line
+    size_t n_parks = 0;              //!< statistics
+  };
+
+  /*!
+   * \brief wait spins, then parks until avail(other) > 0 or the ring is closed
+   * \return avail, 0 if closed and nothing available
+   */
+  template <class Avail>
+  size_t wait(side &me, const std::atomic<size_t> &other, std::atomic<uint32_t> &wake_me, Avail &&avail) {
+    for (size_t i = 0; i < this->spins; ++i) {
+      me.cached = other.load(std::memory_order_acquire);
+      if (const size_t n = avail(me.cached))
+        return n;
+      if (this->is_closed())
+        break;
+      if ((i & 63) == 63)
+        std::this_thread::yield();
+    }
+    for (;;) {
+      me.parked.store(true, std::memory_order_seq_cst);
+      const uint32_t ticket = wake_me.load(std::memory_order_seq_cst);
+      me.cached = other.load(std::memory_order_seq_cst);
+      size_t n = avail(me.cached);
+      if (n || this->is_closed()) {
+        me.parked.store(false, std::memory_order_relaxed);
+        return n;
+      }
+      ++me.n_parks;
+      wake_me.wait(ticket, std::memory_order_seq_cst);
+      me.parked.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  void wake(const std::atomic<bool> &parked, std::atomic<uint32_t> &wake_other) {
+    if (parked.load(std::memory_order_seq_cst)) {
+      wake_other.fetch_add(1, std::memory_order_seq_cst);
+      wake_other.notify_one();
+    }
+  }
+
+  side prod;                                              //!< producer: tail
+  side cons;                                              //!< consumer: head
+  alignas(cache_line) std::atomic<uint32_t> prod_wake{0}; //!< producer -> parked consumer
+  std::atomic<uint32_t> cons_wake{0};                     //!< consumer -> parked producer
+  std::atomic<bool> closed{false};
+  alignas(cache_line) std::vector<T> slots;
+  size_t mask = 0;
+  size_t spins = 4096;
+};
+
+#endif // SPSC_RING_H
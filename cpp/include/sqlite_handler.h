@@ -5,11 +5,15 @@
 #include <filesystem>
 #include <iomanip>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <ostream>
 #include <sqlite3.h>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 /**
@@ -238,8 +242,126 @@ inline int sqlite_handler_scolumn_uint64_t_callback(void *ptr, int argc, char **
 // sqlite3_open_v2("database.db", &db, SQLITE_OPEN_READWRITE, NULL );
 // sqlite3_open_v2("database.db", &db, SQLITE_OPEN_READONLY, NULL );
 
+/*!
+ * \brief The sqlite_stmt class is a prepared statement: bind the parameters, step through the rows and read the columns typed - no string conversion
+ * \code
+ *   auto &st = db->prepare("SELECT f, a, p FROM `MFS-06e` WHERE chopper = ?");
+ *   st.bind_all(1);
+ *   db->select_doubles(st, f, a, p); // resets st, ready for the next bind
+ * \endcode
+ */
+class sqlite_stmt {
+public:
+  sqlite_stmt(sqlite3 *db, const std::string &query) : db(db) {
+    if (sqlite3_prepare_v2(db, query.c_str(), int(query.size()), &this->stmt, NULL) != SQLITE_OK) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << ":: " << std::string(sqlite3_errmsg(db)) << " -> " << query;
+      throw std::runtime_error(err_str.str());
+    }
+  }
+
+  ~sqlite_stmt() {
+    if (this->stmt != nullptr)
+      sqlite3_finalize(this->stmt);
+  }
+
+  sqlite_stmt(const sqlite_stmt &) = delete;
+  sqlite_stmt &operator=(const sqlite_stmt &) = delete;
+
+  // parameters count from 1, as in sqlite
+  sqlite_stmt &bind(const int &pos, const double &value) {
+    this->bind_error(sqlite3_bind_double(this->stmt, pos, value));
+    return *this;
+  }
+
+  sqlite_stmt &bind(const int &pos, const int &value) {
+    this->bind_error(sqlite3_bind_int(this->stmt, pos, value));
+    return *this;
+  }
+
+  sqlite_stmt &bind(const int &pos, const int64_t &value) {
+    this->bind_error(sqlite3_bind_int64(this->stmt, pos, value));
+    return *this;
+  }
+
+  sqlite_stmt &bind(const int &pos, const std::string &value) {
+    this->bind_error(sqlite3_bind_text(this->stmt, pos, value.c_str(), int(value.size()), SQLITE_TRANSIENT));
+    return *this;
+  }
+
+  /*!
+   * \brief bind_all binds all parameters from 1 ... n
+   */
+  template <class... Args>
+  sqlite_stmt &bind_all(const Args &...args) {
+    int pos = 1;
+    (this->bind(pos++, args), ...);
+    return *this;
+  }
+
+  /*!
+   * \brief step to the next row
+   * \return true if a row is available, false at the end
+   */
+  bool step() {
+    const int rc = sqlite3_step(this->stmt);
+    if (rc == SQLITE_ROW)
+      return true;
+    if (rc == SQLITE_DONE)
+      return false;
+    std::ostringstream err_str(__func__, std::ios_base::ate);
+    err_str << ":: " << std::string(sqlite3_errmsg(this->db)) << " -> " << sqlite3_sql(this->stmt);
+    sqlite3_reset(this->stmt);
+    throw std::runtime_error(err_str.str());
+  }
+
+  /*!
+   * \brief reset for the next execution; the bindings are cleared
+   */
+  void reset() {
+    sqlite3_reset(this->stmt);
+    sqlite3_clear_bindings(this->stmt);
+  }
+
+  int columns() const {
+    return sqlite3_column_count(this->stmt);
+  }
+
+  // columns count from 0, as in sqlite
+  bool is_null(const int &col) const {
+    return sqlite3_column_type(this->stmt, col) == SQLITE_NULL;
+  }
+
+  double col_double(const int &col) const {
+    return sqlite3_column_double(this->stmt, col);
+  }
+
+  int64_t col_int64(const int &col) const {
+    return sqlite3_column_int64(this->stmt, col);
+  }
+
+  std::string col_text(const int &col) const {
+    const auto *txt = sqlite3_column_text(this->stmt, col);
+    return (txt != nullptr) ? std::string(reinterpret_cast<const char *>(txt), size_t(sqlite3_column_bytes(this->stmt, col))) : std::string();
+  }
+
+private:
+  void bind_error(const int &rc) const {
+    if (rc != SQLITE_OK) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << ":: " << std::string(sqlite3_errmsg(this->db)) << " -> " << sqlite3_sql(this->stmt);
+      throw std::runtime_error(err_str.str());
+    }
+  }
+
+  sqlite3 *db = nullptr;
+  sqlite3_stmt *stmt = nullptr;
+};
+
 /*!
  * \brief The sqlite_handler class - trivial C++ interface
+ * the sqlite_select / sqlite_vector functions convert all results via text and open / close for each query;
+ * for many lookups (filters, calibrations of thousands of channels) use shared_ro(), prepare() and select_doubles() / select_rows()
  */
 
 class sqlite_handler {
@@ -255,8 +377,7 @@ public:
    * \brief sqlite_handler destructor
    */
   ~sqlite_handler() {
-    if (this->DB != nullptr)
-      sqlite3_close_v2(DB);
+    this->close();
   };
 
   void create_table(const std::string query, const bool close_after_read = true) {
@@ -414,12 +535,128 @@ public:
   }
 
   void close() {
+    this->stmts.clear(); // finalize before close
     if (this->DB != nullptr)
       sqlite3_close_v2(DB);
+    this->DB = nullptr;
     this->open_mode = -1;
     this->exit = SQLITE_ERROR;
   }
 
+  /*!
+   * \brief open_ro_shared opens read only in shared cache mode, e.g. for the sql3 files in data;
+   * all connections of the process to the same file share one page cache; the connection stays open
+   */
+  void open_ro_shared() {
+    if (this->open_mode == open_ro_shared_mode)
+      return;
+    this->close();
+    if (!std::filesystem::exists(this->db_name)) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << ":: DB RO file not found -> " << std::filesystem::absolute(db_name);
+      throw std::runtime_error(err_str.str());
+    }
+    this->exit = sqlite3_open_v2(this->db_name.string().c_str(), &this->DB, SQLITE_OPEN_READONLY | SQLITE_OPEN_SHAREDCACHE, NULL);
+    if (this->exit) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << ":: " << this->db_name;
+      if (this->DB != nullptr)
+        err_str << " " << std::string(sqlite3_errmsg(this->DB));
+      this->close();
+      throw std::runtime_error(err_str.str());
+    }
+    this->open_mode = open_ro_shared_mode;
+  }
+
+  /*!
+   * \brief shared_ro one read only, shared cache connection per file and thread; use the handler in the calling thread only
+   * \param db_name e.g. working_dir_data("filter.sql3")
+   */
+  static std::shared_ptr<sqlite_handler> shared_ro(const std::filesystem::path &db_name) {
+    thread_local std::map<std::filesystem::path, std::shared_ptr<sqlite_handler>> handlers;
+    auto &handler = handlers[db_name];
+    if (handler == nullptr) {
+      auto h = std::make_shared<sqlite_handler>(db_name);
+      h->open_ro_shared();
+      handler = h;
+    }
+    return handler;
+  }
+
+  /*!
+   * \brief prepare returns the prepared statement of query; statements are cached per query and reused;
+   * if not open, the database is opened read only with shared cache
+   */
+  sqlite_stmt &prepare(const std::string &query) {
+    if (this->DB == nullptr)
+      this->open_ro_shared();
+    auto it = this->stmts.find(query);
+    if (it == this->stmts.end())
+      it = this->stmts.emplace(query, std::make_unique<sqlite_stmt>(this->DB, query)).first;
+    return *it->second;
+  }
+
+  /*!
+   * \brief select_doubles reads the first sizeof...(cols) columns of all rows into cols; the vectors are cleared, their capacity is kept
+   * \param stmt prepared and bound statement; it is reset at the end
+   * \return rows
+   */
+  template <class... Cols>
+  size_t select_doubles(sqlite_stmt &stmt, Cols &...cols) {
+    static_assert((std::is_same_v<Cols, std::vector<double>> && ...), "select_doubles: columns must be std::vector<double>");
+    (cols.clear(), ...);
+    size_t rows = 0;
+    try {
+      while (stmt.step()) {
+        int col = 0;
+        bool null = false;
+        ((null = null || stmt.is_null(col), cols.push_back(stmt.col_double(col)), ++col), ...);
+        if (null) {
+          std::ostringstream err_str(__func__, std::ios_base::ate);
+          err_str << ":: NULL in row " << rows << " -> " << this->db_name;
+          throw std::runtime_error(err_str.str());
+        }
+        ++rows;
+      }
+    } catch (...) {
+      stmt.reset();
+      throw;
+    }
+    stmt.reset();
+    return rows;
+  }
+
+  /*!
+   * \brief select_doubles with a query without parameters, e.g. "SELECT * FROM mtx32"
+   */
+  template <class... Cols>
+  size_t select_doubles(const std::string &query, Cols &...cols) {
+    return this->select_doubles(this->prepare(query), cols...);
+  }
+
+  /*!
+   * \brief select_rows reads all rows into structs
+   * \param stmt prepared and bound statement; it is reset at the end
+   * \param rows cleared, capacity is kept
+   * \param fill void(const sqlite_stmt &, Row &) reads the columns of one row
+   * \return rows
+   */
+  template <class Row, class Fill>
+  size_t select_rows(sqlite_stmt &stmt, std::vector<Row> &rows, Fill &&fill) {
+    rows.clear();
+    try {
+      while (stmt.step()) {
+        rows.emplace_back();
+        fill(static_cast<const sqlite_stmt &>(stmt), rows.back());
+      }
+    } catch (...) {
+      stmt.reset();
+      throw;
+    }
+    stmt.reset();
+    return rows.size();
+  }
+
   void exec_query_error(const int &rc) {
     if (rc != SQLITE_OK) {
       std::ostringstream err_str(__func__, std::ios_base::ate);
@@ -488,10 +725,16 @@ public:
     sqlite3_exec(this->DB, "VACUUM", 0, 0, 0);
   }
 
+  static constexpr int open_ro_shared_mode = SQLITE_OPEN_READONLY | SQLITE_OPEN_SHAREDCACHE; //!< open_mode of open_ro_shared
+
+
   sqlite3 *DB = nullptr;         //!< the database
   int exit = SQLITE_ERROR;       //!< sqlite return open value
   int open_mode = -1;            //!< SQLITE_OPEN_READONLY 1, SQLITE_OPEN_READWRITE 2, SQLITE_OPEN_CREATE 4
   std::filesystem::path db_name; //!< database file
+
+private:
+  std::unordered_map<std::string, std::unique_ptr<sqlite_stmt>> stmts; //!< prepared statements by query, see prepare()
 };
 
 #endif // SQLITE_HANDLER_H
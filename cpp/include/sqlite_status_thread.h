@@ -2,6 +2,7 @@
 #define SQLITE_STATUS_THREAD_H
 
 #include "messages.h"
+#include "mpsc_queue.h"
 #include "sqlite_handler.h"
 #include <algorithm>
 #include <atomic>
@@ -10,6 +11,7 @@
 #include <condition_variable>
 #include <exception>
 #include <iostream>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -23,127 +25,284 @@
 #include "messages.h"
 
 /*!
- * \brief The sqlite_receiver class running in a thread like  std::jthread xd(&sqlite_receiver::run, logger.get());
+ * \brief The sqlite_batch_writer class writes the status and log messages of all senders in ONE background thread
+ * senders push lock free (mpsc_queue) and never wait for the database; the writer wakes when batch_size messages are pending
+ * or every max_delay, and writes all pending messages with prepared statements inside one transaction per batch_size messages;
+ * both databases run in WAL mode, so readers (e.g. the web server) do not block the writer
+ */
+class sqlite_batch_writer {
+public:
+  /*!
+   * \brief sqlite_batch_writer opens (creates) both databases
+   * \param sqlfile_status status tables, one per sender with one row per key
+   * \param sqlfile_log log table "logs", appended
+   * \param batch_size messages per transaction; also wakes the writer
+   * \param max_delay a message is written at latest after this time
+   */
+  sqlite_batch_writer(const std::filesystem::path &sqlfile_status, const std::filesystem::path &sqlfile_log, const size_t &batch_size = 256,
+                      const std::chrono::milliseconds &max_delay = std::chrono::milliseconds(100)) : batch_size(std::max<size_t>(1, batch_size)), max_delay(max_delay) {
+    this->sql_stat = std::make_unique<sqlite_handler>(sqlfile_status);
+    this->sql_log = std::make_unique<sqlite_handler>(sqlfile_log);
+    for (auto *sql : {this->sql_stat.get(), this->sql_log.get()}) {
+      sql->open(SQLITE_OPEN_CREATE);
+      sqlite3_busy_timeout(sql->DB, 5000);
+      sql->exec_query_error(sqlite3_exec(sql->DB, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;", NULL, NULL, NULL));
+    }
+  }
+
+  ~sqlite_batch_writer() {
+    this->stop();
+    this->finalize();
+  }
+
+  sqlite_batch_writer(const sqlite_batch_writer &) = delete;
+  sqlite_batch_writer &operator=(const sqlite_batch_writer &) = delete;
+
+  /*!
+   * \brief create_tables e.g. multiple_msg_to_sqlite::create_status_table and create_log_table; may be called while running
+   */
+  void create_tables(const std::string &status_sql, const std::string &log_sql) {
+    std::lock_guard<std::mutex> lock(this->db_mtx);
+    this->sql_stat->exec_query_error(sqlite3_exec(this->sql_stat->DB, status_sql.c_str(), NULL, NULL, NULL));
+    this->sql_log->exec_query_error(sqlite3_exec(this->sql_log->DB, log_sql.c_str(), NULL, NULL, NULL));
+  }
+
+  /*!
+   * \brief start the writer thread; messages pushed before are kept
+   */
+  void start() {
+    std::lock_guard<std::mutex> lock(this->cv_mtx);
+    if (this->worker.joinable())
+      return;
+    this->stopping = false;
+    this->worker = std::thread(&sqlite_batch_writer::run, this);
+  }
+
+  /*!
+   * \brief stop writes all messages pushed so far and ends the thread
+   */
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(this->cv_mtx);
+      this->stopping = true;
+    }
+    this->cv.notify_one();
+    if (this->worker.joinable())
+      this->worker.join();
+  }
+
+  /*!
+   * \brief push from any sender thread; returns immediately
+   */
+  void push(const msg_to_sqlite &msg) {
+    this->queue.push(msg.to_row());
+    if (this->pending.fetch_add(1, std::memory_order_relaxed) + 1 == this->batch_size)
+      this->cv.notify_one(); // otherwise the writer wakes after max_delay
+  }
+
+  size_t written() const {
+    return this->n_written.load(std::memory_order_relaxed);
+  }
+
+  size_t failed() const {
+    return this->n_failed.load(std::memory_order_relaxed);
+  }
+
+  void vacuum() {
+    std::lock_guard<std::mutex> lock(this->db_mtx);
+    this->sql_stat->vacuum();
+    this->sql_log->vacuum();
+  }
+
+private:
+  void run() {
+    std::vector<msg_row> batch;
+    for (;;) {
+      bool last;
+      {
+        std::unique_lock<std::mutex> lock(this->cv_mtx);
+        this->cv.wait_for(lock, this->max_delay, [this] { return this->stopping || (this->pending.load(std::memory_order_relaxed) >= this->batch_size); });
+        last = this->stopping;
+      }
+      batch.clear();
+      const size_t n = this->queue.consume_all([&batch](msg_row &&row) { batch.emplace_back(std::move(row)); });
+      this->pending.fetch_sub(n, std::memory_order_relaxed);
+      if (n)
+        this->write(batch);
+      if (last && this->queue.empty())
+        return;
+    }
+  }
+
+  void write(const std::vector<msg_row> &batch) {
+    std::lock_guard<std::mutex> lock(this->db_mtx);
+    for (size_t first = 0; first < batch.size(); first += this->batch_size) {
+      const size_t last = std::min(batch.size(), first + this->batch_size);
+      sqlite3_exec(this->sql_stat->DB, "BEGIN", NULL, NULL, NULL);
+      sqlite3_exec(this->sql_log->DB, "BEGIN", NULL, NULL, NULL);
+      for (size_t i = first; i < last; ++i) {
+        const auto &row = batch[i];
+        try {
+          if (!row.log_only) {
+            auto *stmt = this->status_stmt(row.sender);
+            bind_text(stmt, 1, row.date);
+            bind_text(stmt, 2, row.time);
+            sqlite3_bind_int(stmt, 3, row.ref_idx);
+            bind_text(stmt, 4, row.sender);
+            bind_text(stmt, 5, row.key);
+            bind_text(stmt, 6, row.value);
+            sqlite3_bind_int(stmt, 7, row.severity);
+            sqlite3_bind_int(stmt, 8, row.idx);
+            this->step(this->sql_stat.get(), stmt);
+          }
+          if (this->log_stmt == nullptr)
+            this->log_stmt = this->prepare(this->sql_log.get(), "INSERT INTO `logs` (`ref_idx`, `date`, `time`, `sender`, `key`, `value`, `severity`) VALUES (?, ?, ?, ?, ?, ?, ?);");
+          sqlite3_bind_int(this->log_stmt, 1, row.ref_idx);
+          bind_text(this->log_stmt, 2, row.date);
+          bind_text(this->log_stmt, 3, row.time);
+          bind_text(this->log_stmt, 4, row.sender);
+          bind_text(this->log_stmt, 5, row.key);
+          bind_text(this->log_stmt, 6, row.value);
+          sqlite3_bind_int(this->log_stmt, 7, row.severity);
+          this->step(this->sql_log.get(), this->log_stmt);
+          this->n_written.fetch_add(1, std::memory_order_relaxed);
+        } catch (const std::runtime_error &error) {
+          std::cerr << error.what() << " " << row.sender << " " << row.key << " " << row.value << std::endl;
+          this->n_failed.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+      sqlite3_exec(this->sql_log->DB, "COMMIT", NULL, NULL, NULL);
+      sqlite3_exec(this->sql_stat->DB, "COMMIT", NULL, NULL, NULL);
+    }
+  }
+
+  sqlite3_stmt *prepare(const sqlite_handler *sql, const std::string &query) const {
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(sql->DB, query.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << " " << sql->db_name << " " << std::string(sqlite3_errmsg(sql->DB)) << " -> " << query;
+      throw std::runtime_error(err_str.str());
+    }
+    return stmt;
+  }
+
+  sqlite3_stmt *status_stmt(const std::string &sender) {
+    auto it = this->status_stmts.find(sender);
+    if (it != this->status_stmts.end())
+      return it->second;
+    auto *stmt = this->prepare(this->sql_stat.get(), "UPDATE `" + sender + "` SET `date` = ?, `time` = ?, `ref_idx` = ?, `sender` = ?, `key` = ?, `value` = ?, `severity` = ? WHERE `idx` = ?;");
+    this->status_stmts.emplace(sender, stmt);
+    return stmt;
+  }
+
+  void step(const sqlite_handler *sql, sqlite3_stmt *stmt) const {
+    const int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    if (rc != SQLITE_DONE) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << " " << sql->db_name << " " << std::string(sqlite3_errmsg(sql->DB));
+      throw std::runtime_error(err_str.str());
+    }
+  }
+
+  static void bind_text(sqlite3_stmt *stmt, const int &pos, const std::string &text) {
+    sqlite3_bind_text(stmt, pos, text.c_str(), int(text.size()), SQLITE_STATIC);
+  }
+
+  void finalize() {
+    std::lock_guard<std::mutex> lock(this->db_mtx);
+    for (auto &st : this->status_stmts)
+      sqlite3_finalize(st.second);
+    this->status_stmts.clear();
+    if (this->log_stmt != nullptr)
+      sqlite3_finalize(this->log_stmt);
+    this->log_stmt = nullptr;
+  }
+
+  std::unique_ptr<sqlite_handler> sql_stat;                    //!< status database, kept open
+  std::unique_ptr<sqlite_handler> sql_log;                     //!< log database, kept open
+  std::unordered_map<std::string, sqlite3_stmt *> status_stmts; //!< one UPDATE per sender table
+  sqlite3_stmt *log_stmt = nullptr;                            //!< INSERT into logs
+  std::mutex db_mtx;                                           //!< writer thread vs create_tables / vacuum
+
+  mpsc_queue<msg_row> queue;           //!< filled by the senders
+  std::atomic<size_t> pending{0};      //!< pushed, not taken yet
+  std::atomic<size_t> n_written{0};    //!< statistics
+  std::atomic<size_t> n_failed{0};     //!< statistics
+  size_t batch_size;                   //!< messages per transaction
+  std::chrono::milliseconds max_delay; //!< latest write of a message
+
+  std::mutex cv_mtx;
+  std::condition_variable cv;
+  bool stopping = false;
+  std::thread worker;
+};
+
+/*!
+ * \brief The sqlite_receiver class creates the senders and owns the writer thread (sqlite_batch_writer) they share
  */
 
 // forward declaration because the receiver will create the sender
 class sqlite_sender;
 
-// make a template out of this for T message queue
-
 class sqlite_receiver {
 public:
-  sqlite_receiver(std::filesystem::path sqlfile_status, std::filesystem::path sqlfile_log) : sqlfile_status(sqlfile_status), sqlfile_log(sqlfile_log) {
-
-    this->mtx = new std::mutex();
-    this->act = new std::atomic<int>(0); // thread can not run yet
-    this->cond = new std::condition_variable();
-    // create a message queue where senders can push messages to
-    // this->message_queue = std::make_shared < std::queue < message_to_sqlite >>> ();
-    // this->message_queue = std::make_shared<std::queue<message_to_sqlite>>();
+  sqlite_receiver(std::filesystem::path sqlfile_status, std::filesystem::path sqlfile_log, const size_t &batch_size = 256, const std::chrono::milliseconds &max_delay = std::chrono::milliseconds(100))
+      : sqlfile_status(sqlfile_status), sqlfile_log(sqlfile_log) {
+
     // write to two different databases; status has constant size, log is appended
     // status table has to be created by the sender; log may be continued
     std::filesystem::remove(this->sqlfile_status);
-    this->sql_log = std::make_unique<sqlite_handler>(this->sqlfile_log);
-    this->sql_stat = std::make_unique<sqlite_handler>(this->sqlfile_status);
-    // queue to share with multiple senders
-    this->message_queue = std::make_shared<std::queue<msg_to_sqlite>>();
+    std::filesystem::remove(this->sqlfile_status.string() + "-wal");
+    std::filesystem::remove(this->sqlfile_status.string() + "-shm");
+    this->writer = std::make_shared<sqlite_batch_writer>(this->sqlfile_status, this->sqlfile_log, batch_size, max_delay);
   }
 
   void reset_db() {
-    if (this->sql_log != nullptr)
-      this->sql_log.reset();
-    if (this->sql_stat != nullptr)
-      this->sql_stat.reset();
+    if (this->writer != nullptr)
+      this->writer->stop();
+    this->writer.reset();
   }
 
   std::unique_ptr<sqlite_sender> create_status_sender(const std::string &sender_name, const std::filesystem::path &json_file) {
 
-    ++(*this->act);
     // create a sender and let it create the table
     // we have a forward declaration of sqlite_sender - all we can do is construct it
     auto multi = multiple_msg_to_sqlite(sender_name, json_file);
     // create the status in case it does not exist
-    this->sql_stat->create_table(multi.create_status_table(sender_name));
-    this->sql_log->create_table(multi.create_log_table("logs"));
+    this->writer->create_tables(multi.create_status_table(sender_name), multi.create_log_table("logs"));
 
-    if (*this->act == 1)
-      this->run();
+    // first sender starts the writer
+    this->run();
 
     // we have a forward declaration of sqlite_sender - all we can do is construct it
     return std::make_unique<sqlite_sender>(this, sender_name, json_file);
   }
 
   ~sqlite_receiver() {
-    // stop the thread
-    if (tr != nullptr) {
-      tr->join();
-      delete tr;
-    }
-    delete this->mtx;
-    delete this->act;
-    delete this->cond;
-    this->message_queue.reset();
-    if (this->sql_log != nullptr) {
-      this->sql_log->vacuum();
-      this->sql_log->close();
-      this->sql_log.reset();
-      this->sql_stat->vacuum();
-      this->sql_stat->close();
-      this->sql_stat.reset();
+    if (this->writer != nullptr) {
+      // writes all pending messages; a sender living longer keeps the writer object, its messages are not written anymore
+      this->writer->stop();
+      this->writer->vacuum();
+      std::cout << this->writer->written() << " messages caught";
+      if (this->writer->failed())
+        std::cout << ", " << this->writer->failed() << " failed";
+      std::cout << std::endl;
+      this->writer.reset();
     }
-
-    std::cout << counter << " messages caught" << std::endl;
   }
 
   /*!
-   * @brief starts the thread; e.g. you start the receiver thread first and then the sender threads
+   * @brief starts the writer thread; e.g. you start the receiver thread first and then the sender threads
    */
   void run() {
-    tr = new std::jthread([this]() { sub(); });
+    this->writer->start();
   }
 
-  mutable std::mutex *mtx;
-  std::atomic<int> *act;
-  std::condition_variable *cond;
-  std::shared_ptr<std::queue<msg_to_sqlite>> message_queue;
+  std::shared_ptr<sqlite_batch_writer> writer; //!< shared with all senders
 
 private:
-  std::string sql_query;
-  std::unique_ptr<sqlite_handler> sql_log;
-  std::unique_ptr<sqlite_handler> sql_stat;
   std::filesystem::path sqlfile_status, sqlfile_log;
-  uint64_t counter = 0;
-  std::jthread *tr = nullptr;
-
-  /*!
-   * \brief sub is the thread worker started via run()
-   */
-  void sub() {
-    while (true) {
-      std::unique_lock lock(*this->mtx);
-      cond->wait(lock, [this] { return !(*this->act) || !this->message_queue->empty(); }); // spurious wakeup protection, i.e:
-      while (!message_queue->empty()) {
-
-        try {
-          if (this->message_queue->front().is_log_only() == 0) {
-            this->sql_stat->insert(this->message_queue->front().update_table_status(), true);
-          }
-          this->sql_log->insert(this->message_queue->front().insert_into_table_log("logs"), true);
-
-        } catch (const std::runtime_error &error) {
-          std::cerr << error.what() << std::endl;
-          std::cerr << this->message_queue->front().insert_into_table_log("logs") << std::endl;
-          std::cerr << this->message_queue->front().update_table_status() << std::endl;
-        }
-        ++this->counter;
-        message_queue->pop();
-      }
-      if (*this->act == 0) { // ends when all senders are finished
-        break;
-      }
-    }
-  }
 };
 
 // ************************************************************* S T A T U S or M E S S A G E *****************************************************************
@@ -154,29 +313,23 @@ private:
 class sqlite_sender : public multiple_msg_to_sqlite {
 public:
   // remember: let the receiver create the multiple_msg_to_sqlite!! We need a valid status_index!!
-  sqlite_sender(const sqlite_receiver *msc, const std::string &sender_name, const std::vector<std::string> &keys) : mtx(msc->mtx), act(msc->act), cond(msc->cond), multiple_msg_to_sqlite(sender_name, keys) {
-
-    this->message_queue = msc->message_queue; // shared pointer to message queue
+  sqlite_sender(const sqlite_receiver *msc, const std::string &sender_name, const std::vector<std::string> &keys) : multiple_msg_to_sqlite(sender_name, keys), writer(msc->writer) {
   }
 
-  sqlite_sender(const sqlite_receiver *msc, const std::string &sender_name, const std::filesystem::path &json_file) : mtx(msc->mtx), act(msc->act), cond(msc->cond), multiple_msg_to_sqlite(sender_name, json_file) {
-
-    this->message_queue = msc->message_queue; // shared pointer to message queue
+  sqlite_sender(const sqlite_receiver *msc, const std::string &sender_name, const std::filesystem::path &json_file) : multiple_msg_to_sqlite(sender_name, json_file), writer(msc->writer) {
   }
 
   // use in try block please
   void set_key_value(const std::string &key, const auto &T, const int &severity = 0) {
     // call base class
     multiple_msg_to_sqlite::set_value(key, T, severity); // can  (shall) throw an exception
-    std::lock_guard lock(*mtx);
-    message_queue->emplace(this->get(key));
+    this->writer->push(this->get(key));
   }
 
   // use in try block please
   void log_only_message(const std::string &key, const auto &T, const int &severity = 0, const int &ref_idx = 0) {
     // call base class
-    std::lock_guard lock(*mtx);
-    message_queue->emplace(multiple_msg_to_sqlite::log_only_message(key, T, severity, ref_idx));
+    this->writer->push(multiple_msg_to_sqlite::log_only_message(key, T, severity, ref_idx));
   }
 
   void watchdog() {
@@ -225,11 +378,9 @@ public:
   }
 
   /*!
-   * @brief when finished, wake up others in case they are waiting
+   * @brief stops the simulation and watchdog threads
    */
   ~sqlite_sender() {
-    --(*this->act);
-    cond->notify_all();
     this->running_thread = false;
     // stop the threads
     for (auto &tr : threads) {
@@ -321,10 +472,7 @@ public:
   }
 
 private:
-  mutable std::mutex *mtx;
-  std::atomic<int> *act;
-  std::condition_variable *cond;
-  std::shared_ptr<std::queue<msg_to_sqlite>> message_queue;
+  std::shared_ptr<sqlite_batch_writer> writer;      // shared with all senders of a receiver
   std::list<std::unique_ptr<std::jthread>> threads; // for a simulation we can make a thread where values are changing
   std::mutex mll;                                   // mutex lock local
 
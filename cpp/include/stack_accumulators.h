@@ -0,0 +1,409 @@
+#ifndef STACK_ACCUMULATORS_H
+#define STACK_ACCUMULATORS_H
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "vector_math.h"
+
+/*!
+ * @file stack_accumulators.h
+ * @brief online (streaming) stacking: the windows are consumed as they are produced and discarded afterwards;
+ * memory is O(frequencies) instead of O(stacks * frequencies)
+ */
+
+/*!
+ * \brief The welford_accumulator class is a running mean and variance per frequency (Welford's algorithm); T is double or std::complex<double>
+ * for complex the variance is the mean of |x - mean|²
+ */
+template <typename T>
+class welford_accumulator {
+public:
+  welford_accumulator() = default;
+
+  welford_accumulator(const size_t &size) {
+    this->resize(size);
+  }
+
+  void resize(const size_t &size) {
+    this->m.assign(size, T(0));
+    this->m2.assign(size, 0.0);
+    this->n = 0;
+  }
+
+  void clear() {
+    std::fill(this->m.begin(), this->m.end(), T(0));
+    std::fill(this->m2.begin(), this->m2.end(), 0.0);
+    this->n = 0;
+  }
+
+  /*!
+   * \brief add one window (one stack)
+   * \param v vector of the same size as the accumulator; first call sets the size
+   */
+  void add(const std::vector<T> &v) {
+    if (!this->m.size())
+      this->resize(v.size());
+    if (v.size() != this->m.size()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::size mismatch " << v.size() << " accumulator " << this->m.size();
+      throw std::runtime_error(err_str.str());
+    }
+    ++this->n;
+    const double dn = double(this->n);
+    for (size_t i = 0; i < v.size(); ++i) {
+      const T delta = v[i] - this->m[i];
+      this->m[i] += delta / dn;
+      if constexpr (std::is_same_v<T, std::complex<double>>)
+        this->m2[i] += std::real(delta * std::conj(v[i] - this->m[i]));
+      else
+        this->m2[i] += delta * (v[i] - this->m[i]);
+    }
+  }
+
+  const std::vector<T> &mean() const {
+    return this->m;
+  }
+
+  /*!
+   * \brief variance sample variance (n - 1)
+   */
+  std::vector<double> variance() const {
+    std::vector<double> var(this->m2.size(), 0.0);
+    if (this->n < 2)
+      return var;
+    const double dn = double(this->n - 1);
+    for (size_t i = 0; i < var.size(); ++i)
+      var[i] = this->m2[i] / dn;
+    return var;
+  }
+
+  size_t size() const {
+    return this->m.size();
+  }
+
+  size_t count() const {
+    return this->n;
+  }
+
+private:
+  std::vector<T> m;       //!< running mean
+  std::vector<double> m2; //!< running sum of squared distances from the mean
+  size_t n = 0;           //!< stacks
+};
+
+/*!
+ * \brief The cross_power_accumulator class accumulates the complex cross power a * conj(b) and the amplitude sqrt(|a * conj(b)|)
+ * the amplitude is the same quantity as bvec::make_cross_sqrt_conj_abs uses for the advanced stacking
+ */
+class cross_power_accumulator {
+public:
+  cross_power_accumulator() = default;
+
+  void add(const std::vector<std::complex<double>> &a, const std::vector<std::complex<double>> &b) {
+    if (a.size() != b.size()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::size mismatch " << a.size() << " " << b.size();
+      throw std::runtime_error(err_str.str());
+    }
+    this->xpow.resize(a.size());
+    this->ampl.resize(a.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+      this->xpow[i] = a[i] * std::conj(b[i]);
+      this->ampl[i] = std::sqrt(std::abs(this->xpow[i]));
+    }
+    this->xpow_acc.add(this->xpow);
+    this->ampl_acc.add(this->ampl);
+  }
+
+  const std::vector<std::complex<double>> &mean_cross_power() const {
+    return this->xpow_acc.mean();
+  }
+
+  const std::vector<double> &mean_ampl() const {
+    return this->ampl_acc.mean();
+  }
+
+  /*!
+   * \brief last_ampl the amplitudes of the last added window, e.g. for feeding a quantile sketch
+   */
+  const std::vector<double> &last_ampl() const {
+    return this->ampl;
+  }
+
+  size_t count() const {
+    return this->xpow_acc.count();
+  }
+
+private:
+  welford_accumulator<std::complex<double>> xpow_acc; //!< running mean of a * conj(b)
+  welford_accumulator<double> ampl_acc;               //!< running mean of sqrt(|a * conj(b)|)
+  std::vector<std::complex<double>> xpow;             //!< scratch, last window
+  std::vector<double> ampl;                           //!< scratch, last window
+};
+
+/*!
+ * \brief The quantile_sketch class is an approximate streaming quantile estimator per frequency for positive values (amplitudes)
+ * The first warmup windows are buffered; from them a logarithmic histogram range is set for each frequency (with a margin of half a decade).
+ * Each bin keeps the count AND the sum, so the median range mean (bvec::median_range_mean) can be approximated without keeping the stacks.
+ * If less than warmup windows arrive, the result is exact. Memory is (bins + 2) * 12 bytes per frequency, independent of the stacks.
+ */
+class quantile_sketch {
+public:
+  /*!
+   * \brief quantile_sketch
+   * \param bins logarithmic bins per frequency (plus under- and overflow)
+   * \param warmup windows to buffer for finding the range
+   */
+  quantile_sketch(const size_t &bins = 48, const size_t &warmup = 32) : bins(bins), warmup(warmup) {
+    if (this->bins < 8)
+      this->bins = 8;
+    if (!this->warmup)
+      this->warmup = 1;
+  }
+
+  void add(const std::vector<double> &v) {
+    if (!this->nf) {
+      this->nf = v.size();
+      this->buffer.reserve(this->warmup * this->nf);
+    }
+    if (v.size() != this->nf) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::size mismatch " << v.size() << " sketch " << this->nf;
+      throw std::runtime_error(err_str.str());
+    }
+    ++this->n;
+    if (!this->is_binned) {
+      this->buffer.insert(this->buffer.end(), v.cbegin(), v.cend());
+      if (this->n == this->warmup)
+        this->init_bins();
+      return;
+    }
+    for (size_t i = 0; i < this->nf; ++i)
+      this->insert(i, v[i]);
+  }
+
+  /*!
+   * \brief median_range_mean approximates bvec::median_range_mean for each frequency
+   * \param fraction_to_use 0.1 ... 1
+   */
+  std::vector<double> median_range_mean(const double &fraction_to_use) const {
+    std::vector<double> out(this->nf, 0.0);
+    if (!this->n)
+      return out;
+    if (!this->is_binned) {
+      // exact - all values are still in the buffer
+      std::vector<double> w(this->n);
+      for (size_t i = 0; i < this->nf; ++i) {
+        for (size_t j = 0; j < this->n; ++j)
+          w[j] = this->buffer[j * this->nf + i];
+        out[i] = bvec::median_range_mean(w, fraction_to_use);
+      }
+      return out;
+    }
+    // same rank limits as bvec::median_range_mean
+    size_t use = size_t(double(this->n) * fraction_to_use) / 2;
+    size_t half = this->n / 2;
+    size_t lo = (half > use) ? half - use : 0;
+    size_t hi = (this->n % 2 == 0) ? half + use : half + use + 1;
+    if (hi > this->n)
+      hi = this->n;
+    if (fraction_to_use >= 1.0 || fraction_to_use < 0.01) {
+      lo = 0;
+      hi = this->n;
+    }
+    if (hi <= lo)
+      return out;
+    for (size_t i = 0; i < this->nf; ++i)
+      out[i] = this->rank_range_mean(i, lo, hi);
+    return out;
+  }
+
+  /*!
+   * \brief quantile approximated by linear interpolation inside the bin
+   * \param q 0 ... 1, 0.5 is the median
+   */
+  std::vector<double> quantile(const double &q) const {
+    std::vector<double> out(this->nf, 0.0);
+    if (!this->n)
+      return out;
+    if (!this->is_binned) {
+      std::vector<double> w(this->n);
+      for (size_t i = 0; i < this->nf; ++i) {
+        for (size_t j = 0; j < this->n; ++j)
+          w[j] = this->buffer[j * this->nf + i];
+        size_t k = std::min(this->n - 1, size_t(q * double(this->n - 1) + 0.5));
+        std::nth_element(w.begin(), w.begin() + k, w.end());
+        out[i] = w[k];
+      }
+      return out;
+    }
+    const double rank = q * double(this->n);
+    const size_t stride = this->bins + 2;
+    for (size_t i = 0; i < this->nf; ++i) {
+      double cum = 0.0;
+      for (size_t b = 0; b < stride; ++b) {
+        const double c = double(this->counts[i * stride + b]);
+        if (cum + c >= rank && c > 0) {
+          if (b == 0 || b == stride - 1) {
+            out[i] = this->sums[i * stride + b] / c; // no edges for under- / overflow
+          } else {
+            double frac = (rank - cum) / c;
+            double l0 = this->log_min[i] + double(b - 1) * this->log_step[i];
+            out[i] = std::pow(10.0, l0 + frac * this->log_step[i]);
+          }
+          break;
+        }
+        cum += c;
+      }
+    }
+    return out;
+  }
+
+  size_t count() const {
+    return this->n;
+  }
+
+  size_t size() const {
+    return this->nf;
+  }
+
+private:
+  void init_bins() {
+    const size_t stride = this->bins + 2;
+    this->counts.assign(this->nf * stride, 0);
+    this->sums.assign(this->nf * stride, 0.0);
+    this->log_min.assign(this->nf, 0.0);
+    this->log_step.assign(this->nf, 1.0);
+    for (size_t i = 0; i < this->nf; ++i) {
+      double vmin = DBL_MAX, vmax = 0.0;
+      for (size_t j = 0; j < this->n; ++j) {
+        double v = this->buffer[j * this->nf + i];
+        if (v > 0.0) {
+          vmin = std::min(vmin, v);
+          vmax = std::max(vmax, v);
+        }
+      }
+      if (vmax <= 0.0) { // all zero
+        vmin = 1.0E-30;
+        vmax = 1.0;
+      }
+      double lmin = std::log10(vmin) - 0.5; // half a decade margin
+      double lmax = std::log10(vmax) + 0.5;
+      this->log_min[i] = lmin;
+      this->log_step[i] = (lmax - lmin) / double(this->bins);
+    }
+    this->is_binned = true;
+    for (size_t j = 0; j < this->n; ++j) {
+      for (size_t i = 0; i < this->nf; ++i)
+        this->insert(i, this->buffer[j * this->nf + i]);
+    }
+    this->buffer.clear();
+    this->buffer.shrink_to_fit();
+  }
+
+  void insert(const size_t &i, const double &v) {
+    const size_t stride = this->bins + 2;
+    size_t b;
+    if (v <= 0.0)
+      b = 0;
+    else {
+      double pos = (std::log10(v) - this->log_min[i]) / this->log_step[i];
+      if (pos < 0.0)
+        b = 0;
+      else if (pos >= double(this->bins))
+        b = stride - 1;
+      else
+        b = size_t(pos) + 1;
+    }
+    ++this->counts[i * stride + b];
+    this->sums[i * stride + b] += v;
+  }
+
+  /*!
+   * \brief rank_range_mean mean of the values with ranks lo ... < hi; partially covered bins contribute with their bin mean
+   */
+  double rank_range_mean(const size_t &i, const size_t &lo, const size_t &hi) const {
+    const size_t stride = this->bins + 2;
+    size_t cum = 0;
+    double sum = 0.0;
+    for (size_t b = 0; b < stride && cum < hi; ++b) {
+      const size_t c = size_t(this->counts[i * stride + b]);
+      if (!c)
+        continue;
+      const size_t b_lo = std::max(cum, lo);
+      const size_t b_hi = std::min(cum + c, hi);
+      if (b_hi > b_lo)
+        sum += (this->sums[i * stride + b] / double(c)) * double(b_hi - b_lo);
+      cum += c;
+    }
+    return sum / double(hi - lo);
+  }
+
+  size_t bins;                 //!< logarithmic bins
+  size_t warmup;               //!< windows buffered before binning
+  size_t nf = 0;               //!< frequencies
+  size_t n = 0;                //!< stacks
+  bool is_binned = false;      //!< warm up done
+  std::vector<double> buffer;  //!< warm up buffer [stack][f]
+  std::vector<uint32_t> counts; //!< [f][bins + 2]
+  std::vector<double> sums;    //!< [f][bins + 2]
+  std::vector<double> log_min; //!< lower log10 edge per frequency
+  std::vector<double> log_step; //!< log10 bin width per frequency
+};
+
+/*!
+ * \brief The online_stack class is the streaming counterpart of raw_spectra::do_advanced_stack_auto / do_advanced_stack_cross for one spectrum
+ * auto spectra stack |a|, cross spectra stack sqrt(|a * conj(b)|); with fraction_to_use < 1 the median range mean is approximated by a quantile_sketch
+ */
+class online_stack {
+public:
+  online_stack(const double &fraction_to_use = 1.0) : fraction_to_use(fraction_to_use) {
+  }
+
+  void add_auto(const std::vector<std::complex<double>> &a) {
+    this->xpow.add(a, a);
+    if (this->fraction_to_use < 1.0)
+      this->sketch.add(this->xpow.last_ampl());
+  }
+
+  void add_cross(const std::vector<std::complex<double>> &a, const std::vector<std::complex<double>> &b) {
+    this->xpow.add(a, b);
+    if (this->fraction_to_use < 1.0)
+      this->sketch.add(this->xpow.last_ampl());
+  }
+
+  /*!
+   * \brief result same meaning as the sa spectra of raw_spectra
+   */
+  std::vector<double> result() const {
+    if (this->fraction_to_use < 1.0)
+      return this->sketch.median_range_mean(this->fraction_to_use);
+    return this->xpow.mean_ampl();
+  }
+
+  const std::vector<std::complex<double>> &mean_cross_power() const {
+    return this->xpow.mean_cross_power();
+  }
+
+  size_t count() const {
+    return this->xpow.count();
+  }
+
+private:
+  double fraction_to_use = 1.0;
+  cross_power_accumulator xpow;
+  quantile_sketch sketch;
+};
+
+#endif // STACK_ACCUMULATORS_H
@@ -1,6 +1,8 @@
 #ifndef STATMAPS_H
 #define STATMAPS_H
 
+#include <array>
+#include <cfloat>
 #include <string>
 #include <vector>
 #include <algorithm>
@@ -108,5 +110,57 @@ template<class T> size_t statmap_name_to_idx (const std::string_view &statname){
 
 } // end namespace
 
+/*!
+ * \brief statrec is the fixed layout alternative to statmap: an array indexed by g_stat, no allocation, no hashing
+ * not calculated values are DBL_MAX (same as the initial values of mk_regression_data); use has() instead of find()
+ */
+struct statrec {
+
+    std::array<double, g_stat::statmap_size> v;
+
+    statrec() {
+        this->v.fill(DBL_MAX);
+    }
+
+    double &operator[](const size_t i) {
+        return this->v[i];
+    }
+
+    const double &operator[](const size_t i) const {
+        return this->v[i];
+    }
+
+    bool has(const size_t i) const {
+        return this->v[i] != DBL_MAX;
+    }
+
+    /*!
+     * \brief valid at least 4 x values have been used (same as the checks of two_pass_variance)
+     */
+    bool valid() const {
+        return this->has(g_stat::d_n_x) && (this->v[g_stat::d_n_x] >= 4.0);
+    }
+
+    void clear() {
+        this->v.fill(DBL_MAX);
+    }
+
+    statmap to_statmap() const {
+        statmap datamap;
+        for (size_t i = 0; i < this->v.size(); ++i) {
+            if (this->has(i)) datamap[i] = this->v[i];
+        }
+        return datamap;
+    }
+
+    static statrec from_statmap(const statmap &datamap) {
+        statrec rec;
+        for (const auto &kv : datamap) {
+            if (kv.first < g_stat::statmap_size) rec.v[kv.first] = kv.second;
+        }
+        return rec;
+    }
+};
+
 
 #endif // STATMAPS_H
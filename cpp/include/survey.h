@@ -3,7 +3,9 @@
 
 #include "atss.h" // channels - n channels for ech run
 #include "files_dirs.h"
+#include "memory_budget.h"
 #include "raw_spectra.h"
+#include "spsc_ring.h"
 
 /*!
  * @file survey.h
@@ -107,6 +109,15 @@ public:
     return this->run_dir.filename();
   }
 
+  /*!
+   * \brief prof_name station/run for the profiler; empty if profiling is off
+   */
+  std::string prof_name() const {
+    if (!mtprof::enabled())
+      return std::string();
+    return (this->run_dir.parent_path().filename() / this->run_dir.filename()).string();
+  }
+
   void clear() {
     for (auto &chan : this->channels) {
       if (chan != nullptr)
@@ -251,6 +262,293 @@ public:
     }
   }
 
+  /*!
+   * \brief stack_online reads all channels with initialized fftw window by window and stacks them immediately into raw_spc->sa;
+   * replaces read_all_fftw, prepare_raw_spc, fetch_raw_spectra and advanced_stack_all - no raw spectra are kept;
+   * the sa spectra must have been added and the frequency range / calibration set in advance
+   * \param fraction_to_use see raw_spectra::advanced_stack_all
+   * \param bcal divide by calibration
+   * \param bwincal scale with the window calibration
+   * \return stacks; the shortest channel determines the number of stacks
+   */
+  size_t stack_online(const double &fraction_to_use, const bool bcal = true, const bool bwincal = true) {
+    if (this->raw_spc == nullptr) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << " Station " << this->run_dir.parent_path().filename() << " " << this->run_dir.filename() << " raw_spc is nullptr";
+      throw std::runtime_error(err_str.str());
+    }
+    std::vector<std::shared_ptr<channel>> fft_channels;
+    for (auto &ch : this->channels) {
+      if (ch->fft_freqs != nullptr) {
+        fft_channels.push_back(ch);
+        if (std::find(this->raw_spc->channels.begin(), this->raw_spc->channels.end(), ch) == this->raw_spc->channels.end())
+          this->raw_spc->channels.push_back(ch);
+      }
+    }
+    if (!fft_channels.size()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << " Station " << this->run_dir.parent_path().filename() << " " << this->run_dir.filename() << " no channel with fftw";
+      throw std::runtime_error(err_str.str());
+    }
+    mtprof::scoped_timer prof("stack_online", this->prof_name());
+    this->raw_spc->init_online_stack(fraction_to_use);
+    size_t stacks = 0;
+    // overlapping chunks shift inside ts_slice and can not be read ahead
+    const bool pipelined = std::none_of(fft_channels.begin(), fft_channels.end(), [](const auto &ch) { return ch->ts_chunk.size(); });
+    if (pipelined)
+      stacks = this->stack_online_pipelined(fft_channels, bcal, bwincal);
+    else {
+      std::map<std::string, std::vector<std::complex<double>>> window;
+      bool complete = true;
+      while (complete) {
+        for (auto &ch : fft_channels) {
+          if (ch->read_fftw_window(window[spc_base<double>::spectra_name(ch)], bcal, bwincal) <= 0) {
+            complete = false;
+            break;
+          }
+        }
+        if (complete) {
+          this->raw_spc->add_online_window(window);
+          ++stacks;
+        }
+      }
+    }
+    for (auto &ch : fft_channels) {
+      ch->close_atss_read();
+      ch->fft_freqs->set_raw_stacks(stacks);
+    }
+    this->raw_spc->finish_online_stack();
+    prof.arg("stacks", double(stacks));
+    prof.arg("channels", double(fft_channels.size()));
+    return stacks;
+  }
+
+  /*!
+   * \brief stack_online_pipelined reads, transforms and stacks in three threads: reader -> spsc_ring -> fftw -> spsc_ring -> stacking (calling thread);
+   * the handoffs are lock free and batched, so high window rates (e.g. wl 256 at 65536 Hz) are limited by the FFT and not by the exchange
+   * \param fft_channels channels with initialized fftw and no overlapping chunks
+   * \return stacks; the shortest channel determines the number of stacks
+   */
+  size_t stack_online_pipelined(const std::vector<std::shared_ptr<channel>> &fft_channels, const bool bcal = true, const bool bwincal = true) {
+    constexpr size_t slots = 64; //!< windows in flight per ring
+    constexpr size_t batch = 16; //!< windows per publish / release
+    const size_t nch = fft_channels.size();
+    std::vector<std::string> names;
+    for (const auto &ch : fft_channels)
+      names.push_back(spc_base<double>::spectra_name(ch));
+
+    // time series of one window, all channels
+    spsc_ring<std::vector<std::vector<double>>> ring_ts(slots, [&](std::vector<std::vector<double>> &w) {
+      w.resize(nch);
+      for (size_t c = 0; c < nch; ++c)
+        w[c].resize(fft_channels[c]->fft_freqs->get_rl());
+    });
+    // spectra of one window, all channels; as expected by add_online_window
+    spsc_ring<std::map<std::string, std::vector<std::complex<double>>>> ring_spc(slots, [&](std::map<std::string, std::vector<std::complex<double>>> &w) {
+      for (size_t c = 0; c < nch; ++c)
+        w[names[c]].reserve(fft_channels[c]->fft_freqs->get_fl());
+    });
+
+    std::exception_ptr err_read, err_fftw;
+    std::thread reader([&]() {
+      try {
+        bool eof = false;
+        while (!eof) {
+          const size_t n = ring_ts.acquire(batch);
+          if (!n)
+            break; // cancelled
+          size_t done = 0;
+          while ((done < n) && !eof) {
+            auto &w = ring_ts.write_slot(done);
+            for (size_t c = 0; c < nch; ++c) {
+              if (fft_channels[c]->read_window(w[c]) <= 0) {
+                eof = true;
+                break;
+              }
+            }
+            if (!eof)
+              ++done;
+          }
+          ring_ts.publish(done);
+        }
+      } catch (...) {
+        err_read = std::current_exception();
+      }
+      ring_ts.close();
+    });
+
+    std::thread transform([&]() {
+      try {
+        bool cancelled = false;
+        while (!cancelled) {
+          const size_t n = ring_ts.fetch(batch);
+          if (!n)
+            break;
+          size_t done = 0;
+          while (done < n) {
+            const size_t m = ring_spc.acquire(n - done);
+            if (!m) {
+              cancelled = true;
+              break;
+            }
+            for (size_t j = 0; j < m; ++j) {
+              const auto &ts = ring_ts.read_slot(done + j);
+              auto &w = ring_spc.write_slot(j);
+              for (size_t c = 0; c < nch; ++c) {
+                std::copy(ts[c].cbegin(), ts[c].cend(), fft_channels[c]->ts_slice.begin());
+                fft_channels[c]->fftw_window(w[names[c]], bcal, bwincal);
+              }
+            }
+            ring_spc.publish(m);
+            done += m;
+          }
+          ring_ts.release(n);
+        }
+      } catch (...) {
+        err_fftw = std::current_exception();
+      }
+      ring_ts.close(); // stops the reader if we stop early
+      ring_spc.close();
+    });
+
+    size_t stacks = 0;
+    try {
+      for (;;) {
+        const size_t n = ring_spc.fetch(batch);
+        if (!n)
+          break;
+        for (size_t j = 0; j < n; ++j)
+          this->raw_spc->add_online_window(ring_spc.read_slot(j));
+        ring_spc.release(n);
+        stacks += n;
+      }
+    } catch (...) {
+      ring_spc.close();
+      ring_ts.close();
+      reader.join();
+      transform.join();
+      throw;
+    }
+    reader.join();
+    transform.join();
+    if (err_read)
+      std::rethrow_exception(err_read);
+    if (err_fftw)
+      std::rethrow_exception(err_fftw);
+    mtprof::count("ring parks", double(ring_ts.parks() + ring_spc.parks()));
+    return stacks;
+  }
+
+  /*!
+   * \brief memory_estimate bytes for the channels with initialized fftw, see memory_budget::estimate; frequency range must be set
+   * \param spectra auto and cross spectra to stack
+   */
+  run_memory_estimate memory_estimate(const size_t &spectra) const {
+    size_t stacks = 0, full_fl = 0, fl = 0, n = 0;
+    for (const auto &ch : this->channels) {
+      if (ch->fft_freqs == nullptr)
+        continue;
+      stacks = std::max(stacks, ch->pt.samples / ch->fft_freqs->get_rl());
+      full_fl = std::max(full_fl, ch->fft_freqs->get_wl() / 2 + 1);
+      fl = std::max(fl, ch->fft_freqs->get_fl());
+      ++n;
+    }
+    return memory_budget::estimate(stacks, full_fl, fl, n, spectra);
+  }
+
+  /*!
+   * \brief stack_spilled same result as read_all_fftw ... advanced_stack_all, but the raw spectra are written to temporary memory mapped files
+   * and stacked block wise from there; the RAM needed is independent of the run length
+   * the sa spectra must have been added and the frequency range / calibration set in advance
+   * \param fraction_to_use see raw_spectra::advanced_stack_all
+   * \param spill_dir directory for the temporary files
+   * \param bcal divide by calibration
+   * \param bwincal scale with the window calibration
+   * \return stacks
+   */
+  size_t stack_spilled(const double &fraction_to_use, const std::filesystem::path &spill_dir, const bool bcal = true, const bool bwincal = true) {
+    if (this->raw_spc == nullptr) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << " Station " << this->run_dir.parent_path().filename() << " " << this->run_dir.filename() << " raw_spc is nullptr";
+      throw std::runtime_error(err_str.str());
+    }
+    const size_t block = 64; // frequencies per block; keep in sync with memory_budget::estimate
+    std::map<std::string, std::shared_ptr<spc_spill_file>> files;
+    std::vector<std::shared_ptr<channel>> fft_channels;
+    for (auto &ch : this->channels) {
+      if (ch->fft_freqs == nullptr)
+        continue;
+      fft_channels.push_back(ch);
+      if (std::find(this->raw_spc->channels.begin(), this->raw_spc->channels.end(), ch) == this->raw_spc->channels.end())
+        this->raw_spc->channels.push_back(ch);
+      files[spc_base<double>::spectra_name(ch)] = std::make_shared<spc_spill_file>(spill_dir, ch->pt.samples / ch->fft_freqs->get_rl(), ch->fft_freqs->get_fl());
+    }
+    if (!fft_channels.size()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << " Station " << this->run_dir.parent_path().filename() << " " << this->run_dir.filename() << " no channel with fftw";
+      throw std::runtime_error(err_str.str());
+    }
+
+    // write: one window of all channels at a time, like stack_online
+    mtprof::scoped_timer prof_write("spill_write", this->prof_name());
+    std::vector<std::complex<double>> window;
+    size_t stacks = 0;
+    bool complete = true;
+    while (complete) {
+      for (auto &ch : fft_channels) {
+        auto &file = files[spc_base<double>::spectra_name(ch)];
+        if ((stacks >= file->rows()) || (ch->read_fftw_window(window, bcal, bwincal) <= 0)) {
+          complete = false;
+          break;
+        }
+        std::copy(window.begin(), window.end(), file->row(stacks));
+      }
+      if (complete)
+        ++stacks;
+      if (complete && !(stacks % 4096)) {
+        for (auto &f : files)
+          f.second->release_pages();
+      }
+    }
+    for (auto &ch : fft_channels) {
+      ch->close_atss_read();
+      ch->fft_freqs->set_raw_stacks(stacks);
+    }
+    for (auto &f : files)
+      f.second->release_pages();
+    prof_write.arg("stacks", double(stacks));
+    prof_write.stop();
+
+    // read: block of frequencies for all stacks, then the same statistics as do_advanced_stack_auto / do_advanced_stack_cross
+    mtprof::scoped_timer prof_stack("spill_stack", this->prof_name());
+    for (auto &ac : this->raw_spc->sa) {
+      auto &f1 = files.at(ac.first.first);
+      auto &f2 = this->raw_spc->sa.is_auto_spc(ac.first) ? f1 : files.at(ac.first.second);
+      const size_t fl = f1->cols();
+      auto out = ac.second;
+      out->assign(fl, 0.0);
+      std::vector<std::vector<double>> columns(block, std::vector<double>(stacks));
+      for (size_t b = 0; b < fl; b += block) {
+        const size_t e = std::min(fl, b + block);
+        for (size_t j = 0; j < stacks; ++j) {
+          const auto *r1 = f1->row(j);
+          const auto *r2 = f2->row(j);
+          for (size_t i = b; i < e; ++i)
+            columns[i - b][j] = std::sqrt(std::abs(r1[i] * std::conj(r2[i]))); // |X| for auto spectra
+        }
+        for (size_t i = b; i < e; ++i) {
+          if (fraction_to_use < 1.0)
+            out->at(i) = bvec::median_range_mean(columns[i - b], fraction_to_use);
+          else
+            out->at(i) = bvec::mean(columns[i - b]);
+        }
+        f1->release_pages();
+        f2->release_pages();
+      }
+    }
+    return stacks;
+  }
+
   // std::vector<size_t> get_channel_with_spectra(bool parzen_spectra) const {
   //   std::vector<size_t> channels_with_spectra;
   //   for (size_t i = 0; i < this->channels.size(); ++i) {
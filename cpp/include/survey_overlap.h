@@ -0,0 +1,312 @@
+#ifndef SURVEY_OVERLAP_H
+#define SURVEY_OVERLAP_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "atss.h"
+#include "survey.h"
+
+/*!
+ * @file survey_overlap.h
+ * @brief time overlap index over the runs of a survey, e.g. for pairing local and remote reference runs
+ *
+ * a run is indexed with the common interval of its channels: latest start, earliest stop (from samples()); one bucket per sample rate,
+ * sorted by start, with an implicit max-stop tree on top - a query is O(log n + k log n) for k hits instead of a scan of all runs.
+ * The sample offsets of a pair are calculated from the start time difference (not from absolute times), so they are exact;
+ * a start time difference which is not a multiple of the sample period is reported as misalign (use the resampler to fix).
+ * \code
+ *   time_overlap_index idx(survey);
+ *   for (const auto &ov : idx.find(survey->get_run("site_1", 1))) {
+ *     // channels of ov.local: open_atss_read(); skip_samples(ov.skip_local);
+ *     // channels of ov.remote: open_atss_read(); skip_samples(ov.skip_remote); -> both at ov.start, ov.samples in common
+ *   }
+ * \endcode
+ */
+
+/*!
+ * \brief The run_interval struct one indexed run
+ */
+struct run_interval {
+  std::shared_ptr<run_d> run;
+  std::string station;      //!< station name (directory)
+  size_t run_no = SIZE_MAX; //!< run number
+  double sample_rate = 0.0; //!< in Hz
+  p_timer start;            //!< latest start of all channels
+  size_t samples = 0;       //!< samples all channels have in common from start
+  double t0 = 0.0;          //!< start in seconds relative to the index epoch
+  double t1 = 0.0;          //!< stop in seconds relative to the index epoch
+};
+
+/*!
+ * \brief The run_overlap struct the common window of two runs with the same sample rate
+ */
+struct run_overlap {
+  std::shared_ptr<run_d> local, remote;
+  std::string remote_station;
+  p_timer start;            //!< start of the common window (on the local sample grid)
+  size_t samples = 0;       //!< samples of the common window
+  size_t skip_local = 0;    //!< samples to skip in the local run to reach start
+  size_t skip_remote = 0;   //!< samples to skip in the remote run to reach start
+  double misalign = 0.0;    //!< remote sample grid against the local in samples after skip_local / skip_remote, [-0.5, 0.5]; 0 for synchronous recordings
+  double sample_rate = 0.0; //!< in Hz
+
+  bool synchronous(const double &tolerance = 1.0E-6) const {
+    return std::abs(this->misalign) <= tolerance;
+  }
+};
+
+/*!
+ * \brief The time_overlap_index class
+ */
+class time_overlap_index {
+public:
+  time_overlap_index() = default;
+
+  /*!
+   * \brief time_overlap_index of all runs of all stations
+   */
+  explicit time_overlap_index(const std::shared_ptr<survey_d> &survey) {
+    if (survey == nullptr) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << ":: survey is nullptr";
+      throw std::runtime_error(err_str.str());
+    }
+    for (const auto &name : survey->get_station_names()) {
+      auto station = survey->get_station(name);
+      for (const auto &run : station->runs)
+        this->add(run, name);
+    }
+    this->build();
+  }
+
+  /*!
+   * \brief add a run; runs without channels or samples are ignored; call build() after the last add
+   * \return true if added
+   */
+  bool add(const std::shared_ptr<run_d> &run, const std::string &station_name = "") {
+    if ((run == nullptr) || run->channels.empty())
+      return false;
+    run_interval ri;
+    ri.run = run;
+    ri.station = station_name.size() ? station_name : run->run_dir.parent_path().filename().string();
+    ri.run_no = run->get_run_no();
+    ri.sample_rate = run->channels.front()->get_sample_rate();
+    if (ri.sample_rate < treat_as_null)
+      return false;
+    // latest start and earliest stop of all channels, the start is kept as tt and fracs
+    ri.start = run->channels.front()->pt;
+    for (const auto &chan : run->channels) {
+      if (ri.start < chan->pt)
+        ri.start = chan->pt;
+    }
+    bool first = true;
+    for (const auto &chan : run->channels) {
+      const size_t n = chan->samples();
+      const int64_t skip = llround(seconds_between(chan->pt, ri.start) * ri.sample_rate);
+      const size_t avail = (int64_t(n) > skip) ? n - size_t(skip) : 0;
+      ri.samples = first ? avail : std::min(ri.samples, avail);
+      first = false;
+    }
+    if (!ri.samples)
+      return false;
+    this->runs.emplace_back(std::move(ri));
+    this->built = false;
+    return true;
+  }
+
+  /*!
+   * \brief build the buckets and trees
+   */
+  void build() {
+    this->buckets.clear();
+    this->by_run.clear();
+    if (this->runs.empty()) {
+      this->built = true;
+      return;
+    }
+    this->epoch = this->runs.front().start.tt;
+    for (const auto &ri : this->runs)
+      this->epoch = std::min(this->epoch, ri.start.tt);
+    for (size_t i = 0; i < this->runs.size(); ++i) {
+      auto &ri = this->runs[i];
+      ri.t0 = double(ri.start.tt - this->epoch) + ri.start.fracs;
+      ri.t1 = ri.t0 + double(ri.samples) / ri.sample_rate;
+      this->buckets[ri.sample_rate].idx.push_back(i);
+      this->by_run.emplace(ri.run.get(), i);
+    }
+    for (auto &b : this->buckets) {
+      auto &bk = b.second;
+      std::sort(bk.idx.begin(), bk.idx.end(), [this](const size_t a, const size_t b) { return this->runs[a].t0 < this->runs[b].t0; });
+      bk.starts.resize(bk.idx.size());
+      for (size_t i = 0; i < bk.idx.size(); ++i)
+        bk.starts[i] = this->runs[bk.idx[i]].t0;
+      bk.leaves = 1;
+      while (bk.leaves < bk.idx.size())
+        bk.leaves *= 2;
+      bk.max_stop.assign(2 * bk.leaves, std::numeric_limits<double>::lowest());
+      for (size_t i = 0; i < bk.idx.size(); ++i)
+        bk.max_stop[bk.leaves + i] = this->runs[bk.idx[i]].t1;
+      for (size_t i = bk.leaves - 1; i > 0; --i)
+        bk.max_stop[i] = std::max(bk.max_stop[2 * i], bk.max_stop[2 * i + 1]);
+    }
+    this->built = true;
+  }
+
+  size_t size() const {
+    return this->runs.size();
+  }
+
+  const std::vector<run_interval> &get_runs() const {
+    return this->runs;
+  }
+
+  /*!
+   * \brief find_intervals all runs with sample_rate overlapping [start, start + samples / sample_rate)
+   * \return indices into get_runs(), sorted by start
+   */
+  std::vector<size_t> find_intervals(const p_timer &start, const size_t &samples, const double &sample_rate) const {
+    this->check_built(__func__);
+    std::vector<size_t> hits;
+    auto b = this->buckets.find(sample_rate);
+    if ((b == this->buckets.end()) || !samples)
+      return hits;
+    const double t0 = double(start.tt - this->epoch) + start.fracs;
+    const double t1 = t0 + double(samples) / sample_rate;
+    const auto &bk = b->second;
+    // candidates start before t1; of those the ones which stop after t0
+    const size_t n = size_t(std::lower_bound(bk.starts.begin(), bk.starts.end(), t1) - bk.starts.begin());
+    if (n)
+      this->collect(bk, 1, 0, bk.leaves, n, t0, hits);
+    return hits;
+  }
+
+  /*!
+   * \brief find all runs overlapping the local run at the same sample rate
+   * \param local run, must be in the index
+   * \param other_stations_only skip the runs of the local station
+   * \return common windows with the sample offsets of both runs, sorted by remote start
+   */
+  std::vector<run_overlap> find(const std::shared_ptr<run_d> &local, const bool other_stations_only = true) const {
+    this->check_built(__func__);
+    const auto pos = this->by_run.find(local.get());
+    if (pos == this->by_run.end()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << ":: run is not in the index " << ((local != nullptr) ? local->run_dir.string() : std::string("nullptr"));
+      throw std::runtime_error(err_str.str());
+    }
+    const auto it = this->runs.begin() + std::ptrdiff_t(pos->second);
+    std::vector<run_overlap> result;
+    for (const auto &i : this->find_intervals(it->start, it->samples, it->sample_rate)) {
+      const auto &ri = this->runs[i];
+      if ((ri.run == local) || (other_stations_only && (ri.station == it->station)))
+        continue;
+      run_overlap ov;
+      if (overlap(*it, ri, ov))
+        result.emplace_back(std::move(ov));
+    }
+    return result;
+  }
+
+  /*!
+   * \brief all_pairs all overlapping pairs of different stations, each pair once (local is the station name sorting first)
+   */
+  std::vector<run_overlap> all_pairs() const {
+    this->check_built(__func__);
+    std::vector<run_overlap> result;
+    for (const auto &ri : this->runs) {
+      for (const auto &i : this->find_intervals(ri.start, ri.samples, ri.sample_rate)) {
+        const auto &rj = this->runs[i];
+        if (!(ri.station < rj.station))
+          continue;
+        run_overlap ov;
+        if (overlap(ri, rj, ov))
+          result.emplace_back(std::move(ov));
+      }
+    }
+    return result;
+  }
+
+  /*!
+   * \brief overlap of two runs with the same sample rate; the offsets are calculated from the start difference only
+   * \return false if the common window is empty
+   */
+  static bool overlap(const run_interval &local, const run_interval &remote, run_overlap &ov) {
+    if (local.sample_rate != remote.sample_rate)
+      return false;
+    const double fs = local.sample_rate;
+    const double ds = seconds_between(local.start, remote.start) * fs;
+    const double n = std::round(ds);
+    ov = run_overlap();
+    ov.local = local.run;
+    ov.remote = remote.run;
+    ov.remote_station = remote.station;
+    ov.sample_rate = fs;
+    ov.misalign = ds - n; // belongs to the grid of skip_local / skip_remote; std::round: [-0.5, 0.5]
+    if (n >= 0.0)
+      ov.skip_local = size_t(n);
+    else
+      ov.skip_remote = size_t(-n);
+    if ((ov.skip_local >= local.samples) || (ov.skip_remote >= remote.samples))
+      return false;
+    ov.samples = std::min(local.samples - ov.skip_local, remote.samples - ov.skip_remote);
+    // start on the local grid: local start + skip_local samples
+    ov.start = local.start;
+    double fullsecs;
+    const double fracs = modf(double(ov.skip_local) / fs, &fullsecs);
+    ov.start.add_secs(int64_t(fullsecs), fracs);
+    return ov.samples > 0;
+  }
+
+  /*!
+   * \brief seconds_between rhs - lhs in seconds; full seconds and fracs are subtracted separately
+   */
+  static double seconds_between(const p_timer &lhs, const p_timer &rhs) {
+    return double(rhs.tt - lhs.tt) + (rhs.fracs - lhs.fracs);
+  }
+
+private:
+  struct bucket {
+    std::vector<size_t> idx;      //!< runs of this sample rate, sorted by start
+    std::vector<double> starts;   //!< t0 of idx
+    std::vector<double> max_stop; //!< implicit tree, node i has children 2i, 2i + 1; leaves at leaves + i
+    size_t leaves = 1;            //!< power of 2 >= idx.size()
+  };
+
+  // all leaves in [lo, hi) of node with index < n and stop > t0
+  void collect(const bucket &bk, const size_t node, const size_t lo, const size_t hi, const size_t n, const double &t0, std::vector<size_t> &hits) const {
+    if ((lo >= n) || (bk.max_stop[node] <= t0))
+      return;
+    if (hi - lo == 1) {
+      hits.push_back(bk.idx[lo]);
+      return;
+    }
+    const size_t mid = (lo + hi) / 2;
+    this->collect(bk, 2 * node, lo, mid, n, t0, hits);
+    this->collect(bk, 2 * node + 1, mid, hi, n, t0, hits);
+  }
+
+  void check_built(const char *func) const {
+    if (!this->built) {
+      std::ostringstream err_str(func, std::ios_base::ate);
+      err_str << ":: index not built, call build() after add()";
+      throw std::runtime_error(err_str.str());
+    }
+  }
+
+  std::vector<run_interval> runs;
+  std::map<double, bucket> buckets;       //!< per sample rate
+  std::map<const run_d *, size_t> by_run; //!< run -> index of runs
+  time_t epoch = 0;                       //!< earliest start, keeps t0 / t1 small
+  bool built = false;
+};
+
+#endif // SURVEY_OVERLAP_H
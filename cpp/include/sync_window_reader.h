@@ -0,0 +1,389 @@
+#ifndef SYNC_WINDOW_READER_H
+#define SYNC_WINDOW_READER_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "BS_thread_pool.h"
+#include "atmm.h"
+#include "atss.h"
+#include "bitmask.h"
+#include "raw_spectra.h"
+#include "spc_base.h"
+#include "survey_overlap.h"
+
+/*!
+ * @file sync_window_reader.h
+ * @brief time aligned windows of channels from several stations (local, remote reference, EMAP) read together
+ *
+ * all channels are mapped onto one common sample axis starting at a common start time; window k covers the samples
+ * [k * step, k * step + rl) of that axis for every channel. A window is skipped if any member excludes one of its samples in its .atmm file.
+ * Consecutive valid windows are read as one block per channel (one pread per channel and block, the channels in parallel on the pool);
+ * the next block is read while the current one is handed out - memory is two blocks, independent of the run length.
+ * \code
+ *   auto ov = time_overlap_index(survey).find(local_run).front();
+ *   auto channels = sync_window_reader::channels_of(ov);      // local channels and the remote ones flagged as is_remote
+ *   ... init_fftw / calibration of the channels, raw_spc->sa spectra added as for run_d::stack_online
+ *   sync_window_reader rd(channels, 1024, pool, ov.start, ov.samples);
+ *   size_t stacks = rd.stack_online(raw_spc, 0.8);
+ * \endcode
+ */
+
+/*!
+ * \brief The sync_window struct one window of all channels, valid inside the callback only
+ */
+struct sync_window {
+  size_t window = 0;              //!< window number on the common axis
+  size_t sample = 0;              //!< first sample on the common axis
+  std::vector<const double *> ts; //!< rl samples per channel, in the order of the channels
+};
+
+class sync_window_reader {
+public:
+  /*!
+   * \brief sync_window_reader
+   * \param channels of the same sample rate, e.g. local and remote channels; the files must exist
+   * \param rl read length of a window
+   * \param pool reads the channels of a block in parallel
+   * \param start common start; empty (tt == 0) takes the latest start of the channels
+   * \param samples samples of the common axis, 0 for all the channels have in common
+   * \param step window advance, 0 for rl (no overlap)
+   * \param max_misalign start times which are not a multiple of the sample period (in samples) are rejected; use the resampler first
+   */
+  sync_window_reader(const std::vector<std::shared_ptr<channel>> &channels, const size_t &rl, std::shared_ptr<BS::thread_pool> &pool,
+                     const p_timer &start = p_timer(), const size_t &samples = 0, const size_t &step = 0, const double &max_misalign = 0.01) :
+      channels(channels), pool(pool), rl(rl), step(step ? step : rl) {
+    if (this->pool == nullptr) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << ":: pool is nullptr";
+      throw std::runtime_error(err_str.str());
+    }
+    if (this->channels.empty() || !this->rl) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << ":: no channels or read length 0";
+      throw std::runtime_error(err_str.str());
+    }
+    this->sample_rate = this->channels.front()->get_sample_rate();
+    this->start = this->channels.front()->pt;
+    for (const auto &chan : this->channels) {
+      if (chan->get_sample_rate() != this->sample_rate) {
+        std::ostringstream err_str(__func__, std::ios_base::ate);
+        err_str << ":: different sample rates " << this->sample_rate << " " << chan->get_sample_rate() << " " << chan->get_atss_filepath();
+        throw std::runtime_error(err_str.str());
+      }
+      if (this->start < chan->pt)
+        this->start = chan->pt;
+    }
+    if (start.tt != 0)
+      this->start = start;
+
+    // offsets of the common axis in each file, from the start difference only
+    bool first = true;
+    for (const auto &chan : this->channels) {
+      const double ds = time_overlap_index::seconds_between(chan->pt, this->start) * this->sample_rate;
+      const double n = std::round(ds);
+      if ((n < 0.0) || (std::abs(ds - n) > max_misalign)) {
+        std::ostringstream err_str(__func__, std::ios_base::ate);
+        err_str << ":: channel does not cover the start or is not on the sample grid (" << ds << " samples) " << chan->get_atss_filepath();
+        throw std::runtime_error(err_str.str());
+      }
+      this->skips.push_back(size_t(n));
+      const size_t total = chan->samples();
+      const size_t avail = (total > this->skips.back()) ? total - this->skips.back() : 0;
+      this->n_samples = first ? avail : std::min(this->n_samples, avail);
+      first = false;
+    }
+    if (samples)
+      this->n_samples = std::min(this->n_samples, samples);
+    const size_t n_windows = (this->n_samples >= this->rl) ? (this->n_samples - this->rl) / this->step + 1 : 0;
+
+    this->valid.assign(n_windows, true);
+    for (size_t c = 0; c < this->channels.size(); ++c)
+      this->apply_atmm(c);
+    this->make_blocks();
+    this->open_files();
+  }
+
+  ~sync_window_reader() {
+    this->close_files();
+  }
+
+  sync_window_reader(const sync_window_reader &) = delete;
+  sync_window_reader &operator=(const sync_window_reader &) = delete;
+
+  /*!
+   * \brief channels_of an overlap: the channels of the local run, followed by copies of the remote channels flagged as is_remote
+   * \param remote_types channel types taken from the remote run, e.g. Hx, Hy
+   */
+  static std::vector<std::shared_ptr<channel>> channels_of(const run_overlap &ov, const std::vector<std::string> &remote_types = {"Hx", "Hy"}) {
+    std::vector<std::shared_ptr<channel>> chans;
+    for (const auto &chan : ov.local->channels)
+      chans.push_back(chan);
+    for (const auto &chan : ov.remote->channels) {
+      if (std::find(remote_types.begin(), remote_types.end(), chan->get_channel_type()) == remote_types.end())
+        continue;
+      chans.emplace_back(std::make_shared<channel>(chan)); // the remote run may be local in an other pairing
+      chans.back()->is_remote = true;
+    }
+    return chans;
+  }
+
+  size_t windows() const {
+    return this->valid.size();
+  }
+
+  /*!
+   * \brief valid_windows not excluded by any .atmm
+   */
+  size_t valid_windows() const {
+    return this->valid.count();
+  }
+
+  const bitmask &get_valid() const {
+    return this->valid;
+  }
+
+  size_t get_skip(const size_t &channel_index) const {
+    return this->skips.at(channel_index);
+  }
+
+  /*!
+   * \brief window_start time of the first sample of window k
+   */
+  p_timer window_start(const size_t &k) const {
+    p_timer pt(this->start);
+    double fullsecs;
+    const double fracs = modf(double(k * this->step) / this->sample_rate, &fullsecs);
+    pt.add_secs(int64_t(fullsecs), fracs);
+    return pt;
+  }
+
+  /*!
+   * \brief for_each_window calls f(const sync_window &) for every valid window in ascending order; the next block is read meanwhile
+   * \return windows handed out
+   */
+  template <class F>
+  size_t for_each_window(F &&f) {
+    if (this->blocks.empty())
+      return 0;
+    const size_t nch = this->channels.size();
+    std::vector<std::vector<double>> buf[2];
+    buf[0].resize(nch);
+    buf[1].resize(nch);
+    std::vector<std::future<void>> pending[2];
+    const auto wait_all = [](std::vector<std::future<void>> &futs) {
+      for (auto &fut : futs) {
+        if (fut.valid())
+          fut.wait();
+      }
+    };
+
+    this->read_block(this->blocks.front(), buf[0], pending[0]);
+    sync_window w;
+    w.ts.resize(nch);
+    size_t done = 0;
+    for (size_t b = 0; b < this->blocks.size(); ++b) {
+      auto &cur = buf[b % 2];
+      try {
+        for (auto &fut : pending[b % 2])
+          fut.get();
+        pending[b % 2].clear();
+        if (b + 1 < this->blocks.size())
+          this->read_block(this->blocks[b + 1], buf[(b + 1) % 2], pending[(b + 1) % 2]);
+        const auto &blk = this->blocks[b];
+        for (size_t k = blk.first; k < blk.second; ++k) {
+          w.window = k;
+          w.sample = k * this->step;
+          const size_t offset = (k - blk.first) * this->step;
+          for (size_t c = 0; c < nch; ++c)
+            w.ts[c] = cur[c].data() + offset;
+          f(w);
+          ++done;
+        }
+      } catch (...) {
+        // the other buffer may still be written
+        wait_all(pending[0]);
+        wait_all(pending[1]);
+        throw;
+      }
+    }
+    return done;
+  }
+
+  /*!
+   * \brief stack_online synchronous counterpart of run_d::stack_online: all channels (local, remote, emap) window by window into raw_spc;
+   * the channels need initialized fftw with this read length and the sa spectra of raw_spc must have been added before
+   * \return stacks
+   */
+  size_t stack_online(std::shared_ptr<raw_spectra> &raw_spc, const double &fraction_to_use, const bool bcal = true, const bool bwincal = true) {
+    if (raw_spc == nullptr) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << ":: raw_spc is nullptr";
+      throw std::runtime_error(err_str.str());
+    }
+    std::vector<std::string> names;
+    for (auto &ch : this->channels) {
+      if ((ch->fft_freqs == nullptr) || (ch->fft_freqs->get_rl() != this->rl)) {
+        std::ostringstream err_str(__func__, std::ios_base::ate);
+        err_str << ":: channel fftw not initialized with read length " << this->rl << " " << ch->get_atss_filepath();
+        throw std::runtime_error(err_str.str());
+      }
+      names.push_back(spc_base<double>::spectra_name(ch));
+      if (std::find(raw_spc->channels.begin(), raw_spc->channels.end(), ch) == raw_spc->channels.end())
+        raw_spc->channels.push_back(ch);
+    }
+    mtprof::scoped_timer prof("stack_online_sync", this->channels.front()->prof_name());
+    raw_spc->init_online_stack(fraction_to_use);
+    std::map<std::string, std::vector<std::complex<double>>> window;
+    const size_t stacks = this->for_each_window([&](const sync_window &w) {
+      for (size_t c = 0; c < this->channels.size(); ++c) {
+        auto &ch = this->channels[c];
+        ch->ts_slice.assign(w.ts[c], w.ts[c] + this->rl);
+        ch->fftw_window(window[names[c]], bcal, bwincal);
+      }
+      raw_spc->add_online_window(window);
+    });
+    for (auto &ch : this->channels)
+      ch->fft_freqs->set_raw_stacks(stacks);
+    raw_spc->finish_online_stack();
+    prof.arg("stacks", double(stacks));
+    prof.arg("channels", double(this->channels.size()));
+    return stacks;
+  }
+
+private:
+  // excluded samples [first, second) of the channel -> windows touching them are invalid
+  void apply_atmm(const size_t &c) {
+    atmm sel;
+    sel.read_data(this->channels[c]->get_atss_filepath(), 0);
+    const size_t n_windows = this->valid.size();
+    for (const auto &ex : sel.atmm_data) {
+      if ((ex.second <= ex.first) || (ex.second <= this->skips[c]))
+        continue;
+      const size_t a = (ex.first > this->skips[c]) ? size_t(ex.first) - this->skips[c] : 0; // on the common axis
+      const size_t b = size_t(ex.second) - this->skips[c];
+      // window k covers [k * step, k * step + rl)
+      const size_t k0 = (a + 1 > this->rl) ? (a + 1 - this->rl + this->step - 1) / this->step : 0;
+      const size_t k1 = std::min(n_windows, (b - 1) / this->step + 1);
+      for (size_t k = k0; k < k1; ++k)
+        this->valid.reset(k);
+    }
+  }
+
+  // runs of consecutive valid windows, limited to about block_samples samples per channel
+  void make_blocks() {
+    const size_t max_windows = std::max(size_t(1), block_samples / this->step);
+    size_t k = 0;
+    const size_t n = this->valid.size();
+    while (k < n) {
+      if (!this->valid.test(k)) {
+        ++k;
+        continue;
+      }
+      size_t e = k + 1;
+      while ((e < n) && (e - k < max_windows) && this->valid.test(e))
+        ++e;
+      this->blocks.emplace_back(k, e);
+      k = e;
+    }
+  }
+
+  void read_block(const std::pair<size_t, size_t> &blk, std::vector<std::vector<double>> &buf, std::vector<std::future<void>> &pending) {
+    const size_t count = (blk.second - blk.first - 1) * this->step + this->rl;
+    const size_t first = blk.first * this->step;
+    for (size_t c = 0; c < this->channels.size(); ++c) {
+      pending.emplace_back(this->pool->submit_task([this, c, first, count, &buf]() {
+        buf[c].resize(count);
+        this->read_samples(c, first + this->skips[c], count, buf[c].data());
+      }));
+    }
+  }
+
+  void read_samples(const size_t &c, const size_t &first, const size_t &count, double *dst) {
+    const size_t bytes = count * sizeof(double);
+#if defined(__unix__)
+    size_t got = 0;
+    while (got < bytes) {
+      const ssize_t r = ::pread(this->fds[c], reinterpret_cast<char *>(dst) + got, bytes - got, off_t(first * sizeof(double) + got));
+      if (r <= 0)
+        break;
+      got += size_t(r);
+    }
+#else
+    this->files[c]->seekg(std::streamoff(first * sizeof(double)));
+    this->files[c]->read(reinterpret_cast<char *>(dst), std::streamsize(bytes));
+    const size_t got = size_t(this->files[c]->gcount());
+#endif
+    if (got != bytes) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << ":: short read " << this->channels[c]->get_atss_filepath();
+      throw std::runtime_error(err_str.str());
+    }
+  }
+
+  void open_files() {
+    for (const auto &chan : this->channels) {
+#if defined(__unix__)
+      const int fd = ::open(chan->get_atss_filepath().c_str(), O_RDONLY);
+      if (fd >= 0)
+        this->fds.push_back(fd);
+#else
+      auto file = std::make_unique<std::ifstream>(chan->get_atss_filepath(), std::ios::in | std::ios::binary);
+      if (file->is_open())
+        this->files.emplace_back(std::move(file));
+#endif
+      else {
+        this->close_files();
+        std::ostringstream err_str(__func__, std::ios_base::ate);
+        err_str << ":: can not open " << chan->get_atss_filepath();
+        throw std::runtime_error(err_str.str());
+      }
+    }
+  }
+
+  void close_files() {
+#if defined(__unix__)
+    for (const auto &fd : this->fds)
+      ::close(fd);
+    this->fds.clear();
+#else
+    this->files.clear();
+#endif
+  }
+
+  static constexpr size_t block_samples = size_t(1) << 18; //!< samples per channel and block
+
+  std::vector<std::shared_ptr<channel>> channels;
+  std::shared_ptr<BS::thread_pool> pool;
+  size_t rl = 0;                                 //!< read length
+  size_t step = 0;                               //!< window advance
+  double sample_rate = 0.0;                      //!< common sample rate
+  p_timer start;                                 //!< sample 0 of the common axis
+  size_t n_samples = 0;                          //!< samples of the common axis
+  std::vector<size_t> skips;                     //!< sample of the file at sample 0 of the common axis
+  bitmask valid;                                 //!< windows not excluded by any .atmm
+  std::vector<std::pair<size_t, size_t>> blocks; //!< [first, last) windows read at once
+#if defined(__unix__)
+  std::vector<int> fds;
+#else
+  std::vector<std::unique_ptr<std::ifstream>> files;
+#endif
+};
+
+#endif // SYNC_WINDOW_READER_H
@@ -0,0 +1,184 @@
+#ifndef TASK_DAG_H
+#define TASK_DAG_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BS_thread_pool.h"
+#include "profiler.h"
+
+/*!
+ * @file task_dag.h
+ * @brief dependency graph of tasks on top of the BS::thread_pool; a task starts as soon as all of its inputs are done - no global barriers
+ */
+
+/*!
+ * \brief The task_dag class: add all tasks with their dependencies first, then run() and wait()
+ * e.g. for a survey: read (run, channel) -> prepare (run, channel) -> fetch (run) -> stack (run, spectra) -> ...
+ * each run proceeds on its own, a short run does not wait for the longest one.
+ * If a task throws, all tasks depending on it are skipped and wait() rethrows the first exception.
+ * Tasks must NOT call pool->wait() - the pool is shared; that would dead lock.
+ */
+class task_dag {
+public:
+  task_dag(std::shared_ptr<BS::thread_pool> &pool) : pool(pool) {
+    if (this->pool == nullptr)
+      throw std::runtime_error("task_dag: pool is nullptr");
+  }
+
+  ~task_dag() {
+    // tasks refer to this - never leave with running tasks
+    if (this->started) {
+      std::unique_lock<std::mutex> lock(this->mtx);
+      this->cv.wait(lock, [this] { return this->n_done == this->nodes.size(); });
+    }
+  }
+
+  task_dag(const task_dag &) = delete;
+  task_dag &operator=(const task_dag &) = delete;
+
+  /*!
+   * \brief add a task
+   * \param fn the task
+   * \param deps ids of tasks which must be finished before; they must have been added before
+   * \param name for error messages
+   * \return id of the task
+   */
+  size_t add(std::function<void()> fn, const std::vector<size_t> &deps = {}, const std::string &name = "") {
+    if (this->started) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::can not add " << name << " after run()";
+      throw std::runtime_error(err_str.str());
+    }
+    const size_t id = this->nodes.size();
+    auto nd = std::make_unique<node>();
+    nd->fn = std::move(fn);
+    nd->name = name.size() ? name : ("task " + std::to_string(id));
+    nd->n_deps = deps.size();
+    for (const auto &dep : deps) {
+      if (dep >= id) {
+        std::ostringstream err_str(__func__, std::ios_base::ate);
+        err_str << "::" << nd->name << " depends on unknown task " << dep;
+        throw std::runtime_error(err_str.str());
+      }
+      this->nodes[dep]->successors.push_back(id);
+    }
+    nd->remaining.store(nd->n_deps);
+    this->nodes.push_back(std::move(nd));
+    return id;
+  }
+
+  /*!
+   * \brief run starts all tasks without dependencies; returns immediately
+   */
+  void run() {
+    if (this->started)
+      return;
+    this->started = true;
+    if (!this->nodes.size())
+      return;
+    for (size_t i = 0; i < this->nodes.size(); ++i) {
+      if (!this->nodes[i]->n_deps)
+        this->submit(i);
+    }
+  }
+
+  /*!
+   * \brief wait until all tasks are done or skipped; rethrows the first exception of a task
+   */
+  void wait() {
+    this->run();
+    std::unique_lock<std::mutex> lock(this->mtx);
+    this->cv.wait(lock, [this] { return this->n_done == this->nodes.size(); });
+    if (this->first_error) {
+      auto err = this->first_error;
+      this->first_error = nullptr;
+      std::rethrow_exception(err);
+    }
+  }
+
+  size_t size() const {
+    return this->nodes.size();
+  }
+
+  /*!
+   * \brief failed_task name of the task which threw first, empty if none
+   */
+  std::string failed_task() const {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    return this->first_failed;
+  }
+
+private:
+  struct node {
+    std::function<void()> fn;
+    std::string name;
+    std::vector<size_t> successors;
+    size_t n_deps = 0;                //!< dependencies as added
+    std::atomic<size_t> remaining{0}; //!< dependencies not finished yet
+    std::atomic<bool> skip{false};    //!< a dependency failed
+    mtprof::clock::time_point queued; //!< submitted to the pool, profiling only
+  };
+
+  void submit(const size_t id) {
+    if (mtprof::enabled())
+      this->nodes[id]->queued = mtprof::clock::now();
+    this->pool->detach_task([this, id]() { this->execute(id); });
+  }
+
+  void execute(const size_t id) {
+    auto &nd = this->nodes[id];
+    bool ok = !nd->skip.load();
+    mtprof::scoped_timer prof("task", nd->name);
+    if (prof.is_active()) {
+      // time in the queue of the pool: all threads busy with other tasks
+      const double wait_ms = std::chrono::duration<double, std::milli>(mtprof::clock::now() - nd->queued).count();
+      prof.arg("wait_ms", wait_ms);
+      mtprof::count("queue wait ms", wait_ms);
+    }
+    if (ok) {
+      try {
+        nd->fn();
+      } catch (...) {
+        ok = false;
+        std::lock_guard<std::mutex> lock(this->mtx);
+        if (!this->first_error) {
+          this->first_error = std::current_exception();
+          this->first_failed = nd->name;
+        }
+      }
+    }
+    nd->fn = nullptr; // release captures early
+    prof.stop();
+    for (const auto &succ : nd->successors) {
+      if (!ok)
+        this->nodes[succ]->skip.store(true);
+      if (this->nodes[succ]->remaining.fetch_sub(1) == 1)
+        this->submit(succ);
+    }
+    // notify under the lock: wait() may return and the dag may be destroyed right after
+    std::lock_guard<std::mutex> lock(this->mtx);
+    ++this->n_done;
+    this->cv.notify_all();
+  }
+
+  std::shared_ptr<BS::thread_pool> pool;    //!< shared pool from main program
+  std::vector<std::unique_ptr<node>> nodes; //!< index is the task id
+  mutable std::mutex mtx;
+  std::condition_variable cv;
+  size_t n_done = 0;                     //!< executed or skipped
+  bool started = false;                  //!< run() has been called
+  std::exception_ptr first_error;        //!< first exception of a task
+  std::string first_failed;              //!< name of that task
+};
+
+#endif // TASK_DAG_H
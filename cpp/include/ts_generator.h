@@ -0,0 +1,216 @@
+#ifndef TS_GENERATOR_H
+#define TS_GENERATOR_H
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "BS_thread_pool.h"
+
+/*!
+ * @file ts_generator.h
+ * @brief fast synthetic time series for tests and simulations: gaussian noise and sinusoids
+ *
+ * The random numbers are counter based: sample i of stream key is a pure function of (key, i).
+ * Blocks can therefore be generated in any order and by any number of threads - the result is always the same;
+ * a data set is reproduced by its key only.
+ * Sinusoids use a phase recurrence (one complex multiplication per sample) instead of sin() per sample;
+ * each block restarts from the exact phase, so there is no drift over hundreds of millions of samples.
+ */
+
+namespace tsgen {
+
+static constexpr size_t block_size = 4096; //!< samples per block, also the unit of parallel work
+
+/*!
+ * \brief mix is the splitmix64 finalizer of key and counter; passes BigCrush as counter based generator
+ */
+inline uint64_t mix(const uint64_t &key, const uint64_t &counter) {
+  uint64_t z = key + (counter + 1) * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+/*!
+ * \brief uniform in (0, 1] from the upper 53 bits
+ */
+inline double uniform(const uint64_t &key, const uint64_t &counter) {
+  return double((mix(key, counter) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+/*!
+ * \brief unit_12 maps the upper 52 bits to [1, 2) by bit pattern - no integer to double conversion, vectorizes
+ */
+inline double unit_12(const uint64_t &r) {
+  return std::bit_cast<double>((r >> 12) | 0x3FF0000000000000ULL);
+}
+
+/*!
+ * \brief log_unit natural log of x in (0, 1]; branch free polynomial, relative error about 1e-12, vectorizes (std::log does not)
+ */
+inline double log_unit(const double &x) {
+  const uint64_t bits = std::bit_cast<uint64_t>(x);
+  int32_t e = int32_t(bits >> 52) - 1023;
+  double m = std::bit_cast<double>((bits & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL); // [1, 2)
+  const bool big = m > M_SQRT2;                                                                // -> [sqrt(1/2), sqrt(2))
+  m = big ? 0.5 * m : m;
+  e += big;
+  const double s = (m - 1.0) / (m + 1.0), s2 = s * s; // |s| < 0.172
+  const double p = 2.0 + s2 * (2.0 / 3.0 + s2 * (2.0 / 5.0 + s2 * (2.0 / 7.0 + s2 * (2.0 / 9.0 + s2 * (2.0 / 11.0 + s2 * (2.0 / 13.0))))));
+  return s * p + double(e) * M_LN2;
+}
+
+/*!
+ * \brief sqrt_pos square root of x >= 0 by Newton iterations of 1 / sqrt; std::sqrt has an errno path which stops the vectorizer
+ */
+inline double sqrt_pos(const double &x) {
+  double y = std::bit_cast<double>(0x5FE6EB50C7B537A9ULL - (std::bit_cast<uint64_t>(x) >> 1)); // 1 / sqrt(x) within 3.5%
+  const double hx = 0.5 * x;
+  y = y * (1.5 - hx * y * y);
+  y = y * (1.5 - hx * y * y);
+  y = y * (1.5 - hx * y * y);
+  y = y * (1.5 - hx * y * y);
+  return x * y;
+}
+
+/*!
+ * \brief sincos_turn sin and cos of 2 pi t for t in [0, 1); quadrant reduction and Taylor polynomials, error < 1e-11, vectorizes
+ */
+inline void sincos_turn(const double &t, double &sn, double &cs) {
+  const double x4 = 4.0 * t;
+  const int32_t q = int32_t(x4);
+  const double a = (x4 - double(q)) * M_PI_2, a2 = a * a; // [0, pi / 2)
+  const double s = a * (1.0 - a2 / 6.0 * (1.0 - a2 / 20.0 * (1.0 - a2 / 42.0 * (1.0 - a2 / 72.0 * (1.0 - a2 / 110.0 * (1.0 - a2 / 156.0 * (1.0 - a2 / 210.0)))))));
+  const double c = 1.0 - a2 / 2.0 * (1.0 - a2 / 12.0 * (1.0 - a2 / 30.0 * (1.0 - a2 / 56.0 * (1.0 - a2 / 90.0 * (1.0 - a2 / 132.0 * (1.0 - a2 / 182.0 * (1.0 - a2 / 240.0)))))));
+  const bool swap = q & 1;
+  const double sign_s = (q & 2) ? -1.0 : 1.0;
+  const double sign_c = ((q + 1) & 2) ? -1.0 : 1.0;
+  sn = sign_s * (swap ? c : s);
+  cs = sign_c * (swap ? s : c);
+}
+
+/*!
+ * \brief normal_block gaussian samples first ... first + n of stream key (Box-Muller, two samples per pair of uniforms)
+ * \param out n samples
+ * \param n samples
+ * \param mean
+ * \param sigma
+ * \param key stream
+ * \param first index of the first sample in the stream; any index, an odd one computes one extra pair
+ */
+inline void normal_block(double *out, const size_t &n, const double &mean, const double &sigma, const uint64_t &key, const uint64_t &first) {
+  double u1[block_size / 2], u2[block_size / 2], tmp[block_size];
+  const uint64_t pair0 = first / 2;
+  const size_t skip = size_t(first & 1); // odd start: drop the first sample of the first pair
+  const size_t total_pairs = (n + skip + 1) / 2;
+  for (size_t p = 0; p < total_pairs; p += block_size / 2) {
+    const size_t pairs = std::min(block_size / 2, total_pairs - p);
+    // independent per lane, no branches - the compiler vectorizes both loops
+    for (size_t i = 0; i < pairs; ++i) {
+      u1[i] = 2.0 - unit_12(mix(key, 2 * (pair0 + p + i)));     // (0, 1]
+      u2[i] = unit_12(mix(key, 2 * (pair0 + p + i) + 1)) - 1.0; // [0, 1)
+    }
+    for (size_t i = 0; i < pairs; ++i) {
+      const double r = sigma * sqrt_pos(-2.0 * log_unit(u1[i]));
+      double sn, cs;
+      sincos_turn(u2[i], sn, cs);
+      tmp[2 * i] = mean + r * cs;
+      tmp[2 * i + 1] = mean + r * sn;
+    }
+    // tmp holds samples 2 p ... 2 (p + pairs) relative to the first pair
+    const size_t b = (p == 0) ? skip : 0;
+    const size_t pos = 2 * p + b - skip;
+    const size_t count = std::min(2 * pairs - b, n - pos);
+    std::copy(tmp + b, tmp + b + count, out + pos);
+  }
+}
+
+/*!
+ * \brief add_sine adds ampl * sin(2 pi f (first + i) / sample_rate + phase) to out
+ */
+inline void add_sine(double *out, const size_t &n, const double &f, const double &sample_rate, const double &ampl, const double &phase, const uint64_t &first) {
+  const double w = 2.0 * M_PI * f / sample_rate;
+  const std::complex<double> step = std::polar(1.0, w);
+  for (size_t b = 0; b < n; b += block_size) {
+    // exact phase at each block start; fmod keeps the argument small for long series
+    std::complex<double> z = std::polar(ampl, std::fmod(w * double(first + b), 2.0 * M_PI) + phase);
+    const size_t e = std::min(n, b + block_size);
+    for (size_t i = b; i < e; ++i) {
+      out[i] += z.imag();
+      z *= step;
+    }
+  }
+}
+
+/*!
+ * \brief for_blocks calls fn(first, count) for all blocks of n samples; in parallel if a pool is given; waits for the result
+ */
+template <class F>
+void for_blocks(const size_t &n, const std::shared_ptr<BS::thread_pool> &pool, F &&fn) {
+  const size_t chunk = 64 * block_size;
+  if ((pool == nullptr) || (n <= chunk)) {
+    fn(size_t(0), n);
+    return;
+  }
+  // wait for the blocks of this call only, the pool may be shared
+  pool->submit_blocks<size_t>(
+          0, (n + chunk - 1) / chunk,
+          [&fn, &n, chunk](const size_t start, const size_t end) {
+            for (size_t c = start; c < end; ++c) {
+              const size_t first = c * chunk;
+              fn(first, std::min(chunk, n - first));
+            }
+          })
+      .wait();
+}
+
+/*!
+ * \brief fill_normal fills data with gaussian noise of stream key; identical for any pool size
+ */
+inline void fill_normal(std::vector<double> &data, const double &mean, const double &sigma, const uint64_t &key, const std::shared_ptr<BS::thread_pool> &pool = nullptr) {
+  for_blocks(data.size(), pool, [&](const size_t first, const size_t count) { normal_block(data.data() + first, count, mean, sigma, key, first); });
+}
+
+/*!
+ * \brief add_sine adds a sinusoid to all of data
+ */
+inline void add_sine(std::vector<double> &data, const double &f, const double &sample_rate, const double &ampl = 1.0, const double &phase = 0.0, const std::shared_ptr<BS::thread_pool> &pool = nullptr) {
+  for_blocks(data.size(), pool, [&](const size_t first, const size_t count) { add_sine(data.data() + first, count, f, sample_rate, ampl, phase, first); });
+}
+
+/*!
+ * \brief The normal_stream class hands out consecutive gaussian blocks of one stream, e.g. for a real time simulation
+ */
+class normal_stream {
+public:
+  normal_stream(const uint64_t &key, const double &mean = 0.0, const double &sigma = 1.0) : key(key), mean(mean), sigma(sigma) {}
+
+  void next(double *out, const size_t &n) {
+    normal_block(out, n, this->mean, this->sigma, this->key, this->pos);
+    this->pos += n;
+  }
+
+  void next(std::vector<double> &out) {
+    this->next(out.data(), out.size());
+  }
+
+  uint64_t samples() const {
+    return this->pos;
+  }
+
+private:
+  uint64_t key;
+  double mean;
+  double sigma;
+  uint64_t pos = 0; //!< index of the next sample in the stream
+};
+
+} // namespace tsgen
+
+#endif // TS_GENERATOR_H
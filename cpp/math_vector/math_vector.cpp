@@ -1,5 +1,98 @@
 #include "math_vector.h"
 
+//////////////////////////////////////////////// bitmask kernels  //////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+constexpr size_t mask_lanes = 4; //!< independent partial sums per kernel, lets the compiler keep them in one vector register
+
+/*!
+ * \brief mask_walk calls f(index, lane, use) for all elements of non empty mask words; empty words are skipped,
+ * full words avoid the bit test; f is inlined and must be branch free (use ? value : 0.0) so the blocks of mask_lanes vectorize
+ */
+template <class F>
+inline void mask_walk(const size_t n, const bitmask &sel, F &&f) {
+  for (size_t wi = 0; wi < sel.n_words(); ++wi) {
+    const uint64_t w = sel.word(wi);
+    if (!w)
+      continue;
+    const size_t first = wi * bitmask::bits;
+    const size_t cnt = std::min(bitmask::bits, n - first);
+    size_t j = 0;
+    if (w == ~uint64_t(0)) {
+      for (; j < cnt; j += mask_lanes) {
+        for (size_t l = 0; l < mask_lanes; ++l)
+          f(first + j + l, l, true);
+      }
+    } else {
+      for (; j + mask_lanes <= cnt; j += mask_lanes) {
+        const unsigned block = unsigned(w >> j);
+        for (size_t l = 0; l < mask_lanes; ++l)
+          f(first + j + l, l, bool((block >> l) & 1));
+      }
+      for (; j < cnt; ++j)
+        f(first + j, j % mask_lanes, bool((w >> j) & 1));
+    }
+  }
+}
+
+inline double lane_sum(const double (&acc)[mask_lanes]) {
+  double sum = 0.0;
+  for (size_t l = 0; l < mask_lanes; ++l)
+    sum += acc[l];
+  return sum;
+}
+
+/*!
+ * \brief masked_sum sum of (x - offset) of the selected x
+ */
+double masked_sum(const double *x, const size_t n, const bitmask &sel, const double offset) {
+  double acc[mask_lanes] = {};
+  mask_walk(n, sel, [&](const size_t i, const size_t l, const bool use) { acc[l] += use ? x[i] - offset : 0.0; });
+  return lane_sum(acc);
+}
+
+/*!
+ * \brief masked_dot sum of x * y of the selected elements
+ */
+double masked_dot(const double *x, const double *y, const size_t n, const bitmask &sel) {
+  double acc[mask_lanes] = {};
+  mask_walk(n, sel, [&](const size_t i, const size_t l, const bool use) { acc[l] += use ? x[i] * y[i] : 0.0; });
+  return lane_sum(acc);
+}
+
+/*!
+ * \brief masked_moments second pass of two_pass_variance over the selected x: min, max, sum |x - mean|, ep, m2, m3, m4
+ */
+void masked_moments(const double *x, const size_t n, const bitmask &sel, const double mean, two_pass_variance &v) {
+  double mn[mask_lanes], mx[mask_lanes];
+  double dmean[mask_lanes] = {}, ep[mask_lanes] = {}, m2[mask_lanes] = {}, m3[mask_lanes] = {}, m4[mask_lanes] = {};
+  for (size_t l = 0; l < mask_lanes; ++l) {
+    mn[l] = DBL_MAX;
+    mx[l] = -DBL_MAX;
+  }
+  mask_walk(n, sel, [&](const size_t i, const size_t l, const bool use) {
+    const double sdiffs = use ? x[i] - mean : 0.0;
+    const double moment = sdiffs * sdiffs;
+    mn[l] = (use && (x[i] < mn[l])) ? x[i] : mn[l];
+    mx[l] = (use && (x[i] > mx[l])) ? x[i] : mx[l];
+    dmean[l] += std::fabs(sdiffs);
+    ep[l] += sdiffs;
+    m2[l] += moment;
+    m3[l] += moment * sdiffs;
+    m4[l] += moment * sdiffs * sdiffs;
+  });
+  v.d_min = *std::min_element(mn, mn + mask_lanes);
+  v.d_max = *std::max_element(mx, mx + mask_lanes);
+  v.d_dmean += lane_sum(dmean);
+  v.ep += lane_sum(ep);
+  v.d_variance += lane_sum(m2);
+  v.d_skewness += lane_sum(m3);
+  v.d_kurtosis += lane_sum(m4);
+}
+
+} // namespace
+
 math_vector::math_vector() {
 }
 
@@ -810,6 +903,61 @@ double math_vector::sel_mean(std::vector<double>::const_iterator xcbeg, std::vec
   return DBL_MAX;
 }
 
+bool math_vector::vector_size_if_min(std::vector<double>::const_iterator xcbeg, std::vector<double>::const_iterator xcend,
+                                     const bitmask &selected,
+                                     const size_t min_valid_elements, const int control) {
+  size_t xdist = (size_t)std::distance(xcbeg, xcend);
+  if (xdist < min_valid_elements) {
+    std::cerr << "x is smaller than: " << xdist << " required: " << min_valid_elements << std::endl;
+    return false;
+  } else if (control == 2) {
+    return true;
+  }
+
+  if (xdist != selected.size()) {
+    std::cerr << " x and selection mask have different sizes: " << xdist << " " << selected.size() << std::endl;
+    return false;
+  }
+
+  if (control != 1) {
+    size_t trues = selected.count();
+    if (trues < min_valid_elements) {
+      std::cerr << "selection mask has only true selections: " << trues << " required: " << min_valid_elements << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool math_vector::vector_sizes_if_min(std::vector<double>::const_iterator xcbeg, std::vector<double>::const_iterator xcend,
+                                      std::vector<double>::const_iterator ycbeg, std::vector<double>::const_iterator ycend,
+                                      const bitmask &selected,
+                                      const size_t min_valid_elements, const int control) {
+
+  size_t ydist = (size_t)std::distance(ycbeg, ycend);
+  size_t xdist = (size_t)std::distance(xcbeg, xcend);
+  if ((xdist >= min_valid_elements) && (xdist != ydist)) {
+    std::cerr << "x and y not of same size: " << xdist << " " << ydist << std::endl;
+    return false;
+  }
+  return this->vector_size_if_min(xcbeg, xcend, selected, min_valid_elements, control);
+}
+
+double math_vector::sel_mean(std::vector<double>::const_iterator xcbeg, std::vector<double>::const_iterator xcend,
+                             const bitmask &selected,
+                             const size_t min_valid_elements, const int control) {
+
+  if (!vector_size_if_min(xcbeg, xcend, selected, min_valid_elements, control)) {
+    return DBL_MAX;
+  }
+  const size_t n = (size_t)std::distance(xcbeg, xcend);
+  if (control == 2) {
+    double mymean = std::accumulate(xcbeg, xcend, 0.0);
+    return mymean / double(n);
+  }
+  return masked_sum(&*xcbeg, n, selected, 0.0) / double(selected.count());
+}
+
 // statmap math_vector::mk_variance_data(bool make_y) {
 
 //    statmap datamap;
@@ -1213,6 +1361,36 @@ statmap two_pass_variance::variance_if(std::vector<double>::const_iterator xcbeg
   return this->variance_data;
 }
 
+statmap two_pass_variance::variance_if(std::vector<double>::const_iterator xcbeg, std::vector<double>::const_iterator xcend,
+                                       const bitmask &selected,
+                                       const double median_or_mean_initvalue) {
+
+  math_vector mathv;
+
+  if (!mathv.vector_size_if_min(xcbeg, xcend, selected, 4)) {
+    return statmap();
+  }
+
+  const double *x = &*xcbeg;
+  const size_t xn = (size_t)std::distance(xcbeg, xcend);
+  this->n += selected.count();
+  this->d_n = (double)this->n;
+  if (median_or_mean_initvalue != 0.0) {
+    this->d_sum += masked_sum(x, xn, selected, median_or_mean_initvalue);
+    this->d_sum += this->d_n * median_or_mean_initvalue;
+    this->d_mean = median_or_mean_initvalue;
+  } else {
+    this->d_sum += masked_sum(x, xn, selected, 0.0);
+    this->d_mean = this->d_sum / this->d_n;
+  }
+
+  masked_moments(x, xn, selected, this->d_mean, *this);
+
+  this->calc_all();
+
+  return this->variance_data;
+}
+
 void two_pass_variance::clear() {
   this->n = 0;
   this->d_n = 0.0;
@@ -1343,6 +1521,71 @@ bool select_in_out_reg::mkselect_in_out_reg(std::vector<double>::const_iterator
     return true;
   }
 
+  return false;
+}
+
+bool select_in_out_reg::mkselect_in_out_reg(std::vector<double>::const_iterator xcbeg, std::vector<double>::const_iterator xcend,
+                                            std::vector<double>::const_iterator ycbeg, std::vector<double>::const_iterator ycend,
+                                            bitmask &selected,
+                                            const statmap &regression_data,
+                                            const double center_x, const double center_y,
+                                            const int slope_type_0s_1u_2l, double extra_offsety) {
+
+  math_vector mathv;
+  if (!mathv.vector_sizes_if_min(xcbeg, xcend, ycbeg, ycend, selected, 4, 1)) {
+    return false;
+  }
+
+  this->d_n = regression_data.at(g_stat::d_n_x);
+  this->d_slope = regression_data.at(g_stat::slope_xy);
+  this->d_abscissa = regression_data.at(g_stat::abscissa_xy);
+  this->d_lower_confidence = regression_data.at(g_stat::student_t_lower_confidence_xy);
+  this->d_upper_confidence = regression_data.at(g_stat::student_t_upper_confidence_xy);
+  this->d_varx = regression_data.at(g_stat::variance_x);
+  this->d_student_t_inv = regression_data.at(g_stat::student_t_inv);
+  this->d_meanx = regression_data.at(g_stat::mean_x);
+
+  const double *x = &*xcbeg;
+  const double *y = &*ycbeg;
+  const size_t n = selected.size();
+
+  if ((slope_type_0s_1u_2l == 1) || (slope_type_0s_1u_2l == 2)) {
+    for (size_t wi = 0; wi < selected.n_words(); ++wi) {
+      const size_t first = wi * bitmask::bits;
+      const size_t cnt = std::min(bitmask::bits, n - first);
+      uint64_t w = 0;
+      for (size_t j = 0; j < cnt; ++j) {
+        const double dx = x[first + j] - center_x;
+        const double ymax = this->d_upper_confidence * dx + center_y + extra_offsety;
+        const double ymin = this->d_lower_confidence * dx + center_y + extra_offsety;
+        w |= uint64_t((ymin < y[first + j]) && (y[first + j] < ymax)) << j;
+      }
+      selected.set_word(wi, w);
+    }
+    return true;
+  }
+
+  else if ((slope_type_0s_1u_2l == 3) || (slope_type_0s_1u_2l == 4)) {
+
+    const double denom = (this->d_n - 1.0) * this->d_varx;
+    const double factor = this->d_student_t_inv * sqrt(this->d_abscissa) / sqrt((this->d_n - 2.0));
+
+    for (size_t wi = 0; wi < selected.n_words(); ++wi) {
+      const size_t first = wi * bitmask::bits;
+      const size_t cnt = std::min(bitmask::bits, n - first);
+      uint64_t w = 0;
+      for (size_t j = 0; j < cnt; ++j) {
+        const double xm = x[first + j] - this->d_meanx;
+        const double dist_from_slope = factor * sqrt(((xm * xm) / denom) + (1.0 / this->d_n)) + extra_offsety;
+        const double ymax = this->d_slope * x[first + j] + this->d_abscissa + dist_from_slope;
+        const double ymin = this->d_slope * x[first + j] + this->d_abscissa - dist_from_slope;
+        w |= uint64_t((ymin < y[first + j]) && (y[first + j] < ymax)) << j;
+      }
+      selected.set_word(wi, w);
+    }
+    return true;
+  }
+
   return false;
 } // select_in_out_reg
 
@@ -1440,6 +1683,30 @@ statmap two_pass_linreg::linreg_if(std::vector<double>::const_iterator xcbeg, st
   return this->regression_data;
 }
 
+statmap two_pass_linreg::linreg_if(std::vector<double>::const_iterator xcbeg, std::vector<double>::const_iterator xcend,
+                                   std::vector<double>::const_iterator ycbeg, std::vector<double>::const_iterator ycend,
+                                   const bitmask &selected,
+                                   const double median_or_mean_subtract_y) {
+
+  math_vector mathv;
+  if (!mathv.vector_sizes_if_min(xcbeg, xcend, ycbeg, ycend, selected, 4)) {
+    return statmap();
+  }
+
+  x.variance_if(xcbeg, xcend, selected);
+  y.variance_if(ycbeg, ycend, selected, median_or_mean_subtract_y);
+
+  this->S_xy += masked_dot(&*xcbeg, &*ycbeg, (size_t)std::distance(xcbeg, xcend), selected);
+  this->n += selected.count();
+  this->d_n = (double)this->n;
+
+  if (!this->calc_all()) {
+    return statmap();
+  }
+
+  return this->regression_data;
+}
+
 bool two_pass_linreg::calc_all() {
   math_vector mathv;
   this->regression_data = mathv.mk_regression_data(this->x.variance_data, this->y.variance_data, this->is_ok);
@@ -1674,3 +1941,237 @@ std::ostream &operator<<(std::ostream &out,
 
   return out;
 }
+
+statrec two_pass_variance::record() const {
+  statrec rec;
+  if (this->n < 4)
+    return rec;
+  rec[g_stat::d_n_x] = this->d_n;
+  rec[g_stat::sum_x] = this->d_sum;
+  rec[g_stat::min_x] = this->d_min;
+  rec[g_stat::max_x] = this->d_max;
+  rec[g_stat::mean_x] = this->d_mean;
+  rec[g_stat::range_x] = this->d_range;
+  rec[g_stat::variance_population_x] = this->d_variance_population;
+  rec[g_stat::variance_x] = this->d_variance;
+  rec[g_stat::stddev_population_x] = this->d_stddev_population;
+  rec[g_stat::stddev_x] = this->d_stddev;
+  rec[g_stat::skewness_x] = this->d_skewness;
+  rec[g_stat::kurtosis_x] = this->d_kurtosis;
+  return rec;
+}
+
+statrec two_pass_linreg::record() const {
+  if (!this->has_data)
+    return statrec();
+  statrec rec(this->x.record());
+  const statrec yrec(this->y.record());
+  for (size_t i = 0; i < g_stat::xstat_size; ++i)
+    rec[g_stat::xstat_size + i] = yrec[i];
+  rec[g_stat::covariance_xy] = this->d_covariance;
+  rec[g_stat::correlation_xy] = this->d_correlation;
+  rec[g_stat::slope_xy] = this->d_slope;
+  rec[g_stat::abscissa_xy] = this->d_abscissa;
+  rec[g_stat::sum_alldist_from_slope_xy] = this->d_sum_alldist_from_slope;
+  if (this->d_test_against_other_slope != DBL_MAX)
+    rec[g_stat::student_t_test_against_other_slope] = this->d_test_against_other_slope;
+  return rec;
+}
+
+//////////////////////////////////////////////// batch_stats  //////////////////////////////////////////////////////////////////////////
+
+void batch_stats::moments::resize(const size_t n_series) {
+  this->sum.assign(n_series, 0.0);
+  this->min.assign(n_series, DBL_MAX);
+  this->max.assign(n_series, -DBL_MAX);
+  this->ep.assign(n_series, 0.0);
+  this->m2.assign(n_series, 0.0);
+  this->m3.assign(n_series, 0.0);
+  this->m4.assign(n_series, 0.0);
+}
+
+bool batch_stats::check(const std::vector<double> &x, const size_t n_series, const std::vector<uint8_t> *sel, const char *func) {
+  if (!n_series || (x.size() % n_series)) {
+    std::cerr << "batch_stats::" << func << " data size " << x.size() << " is not a multiple of the series " << n_series << std::endl;
+    return false;
+  }
+  if ((sel != nullptr) && (sel->size() != x.size())) {
+    std::cerr << "batch_stats::" << func << " data and selection have different sizes: " << x.size() << " " << sel->size() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void batch_stats::count(const std::vector<uint8_t> *sel, const size_t n_stacks, const size_t n_series, std::vector<double> &n) {
+  if (sel == nullptr) {
+    n.assign(n_series, double(n_stacks));
+    return;
+  }
+  n.assign(n_series, 0.0);
+  double *pn = n.data();
+  for (size_t s = 0; s < n_stacks; ++s) {
+    const uint8_t *ps = sel->data() + s * n_series;
+    for (size_t i = 0; i < n_series; ++i)
+      pn[i] += ps[i] ? 1.0 : 0.0;
+  }
+}
+
+void batch_stats::sums_row(const double *x, const uint8_t *sel, const size_t n_series, moments &m) {
+  double *sum = m.sum.data(), *mn = m.min.data(), *mx = m.max.data();
+  if (sel == nullptr) {
+    for (size_t i = 0; i < n_series; ++i) {
+      sum[i] += x[i];
+      mn[i] = (x[i] < mn[i]) ? x[i] : mn[i];
+      mx[i] = (x[i] > mx[i]) ? x[i] : mx[i];
+    }
+  } else {
+    for (size_t i = 0; i < n_series; ++i) {
+      const bool use = sel[i];
+      sum[i] += use ? x[i] : 0.0;
+      mn[i] = (use && (x[i] < mn[i])) ? x[i] : mn[i];
+      mx[i] = (use && (x[i] > mx[i])) ? x[i] : mx[i];
+    }
+  }
+}
+
+void batch_stats::moments_row(const double *x, const uint8_t *sel, const size_t n_series, const double *mean, moments &m) {
+  double *ep = m.ep.data(), *m2 = m.m2.data(), *m3 = m.m3.data(), *m4 = m.m4.data();
+  for (size_t i = 0; i < n_series; ++i) {
+    const double sdiffs = ((sel == nullptr) || sel[i]) ? x[i] - mean[i] : 0.0;
+    const double moment = sdiffs * sdiffs;
+    ep[i] += sdiffs;
+    m2[i] += moment;
+    m3[i] += moment * sdiffs;
+    m4[i] += moment * sdiffs * sdiffs;
+  }
+}
+
+void batch_stats::finish(const moments &m, const size_t i, const double d_n, const double mean, const size_t offset, statrec &rec) {
+  // same as two_pass_variance::calc_all
+  const double variance_population = (m.m2[i] - (m.ep[i] * m.ep[i] / d_n)) / d_n;
+  const double variance = (m.m2[i] - (m.ep[i] * m.ep[i] / d_n)) / (d_n - 1.0);
+  const double stddev = std::sqrt(variance);
+  rec[offset + g_stat::d_n_x] = d_n;
+  rec[offset + g_stat::sum_x] = m.sum[i];
+  rec[offset + g_stat::min_x] = m.min[i];
+  rec[offset + g_stat::max_x] = m.max[i];
+  rec[offset + g_stat::mean_x] = mean;
+  rec[offset + g_stat::range_x] = m.max[i] - m.min[i];
+  rec[offset + g_stat::variance_population_x] = variance_population;
+  rec[offset + g_stat::variance_x] = variance;
+  rec[offset + g_stat::stddev_population_x] = std::sqrt(variance_population);
+  rec[offset + g_stat::stddev_x] = stddev;
+  if (variance != 0.0) {
+    rec[offset + g_stat::skewness_x] = m.m3[i] / (d_n * variance * stddev);
+    rec[offset + g_stat::kurtosis_x] = (m.m4[i] / ((d_n - 1.0) * variance * variance)) - 3.0;
+  } else {
+    rec[offset + g_stat::skewness_x] = 0.0;
+    rec[offset + g_stat::kurtosis_x] = 0.0;
+  }
+}
+
+size_t batch_stats::variance(const std::vector<double> &x, const size_t n_series, std::vector<statrec> &out, const std::vector<uint8_t> *sel) {
+  out.assign(n_series, statrec());
+  if (!check(x, n_series, sel, __func__))
+    return 0;
+  const size_t n_stacks = x.size() / n_series;
+  const uint8_t *psel = (sel == nullptr) ? nullptr : sel->data();
+  std::vector<double> n, mean(n_series);
+  moments mx;
+  mx.resize(n_series);
+  count(sel, n_stacks, n_series, n);
+  for (size_t s = 0; s < n_stacks; ++s)
+    sums_row(x.data() + s * n_series, psel ? psel + s * n_series : nullptr, n_series, mx);
+  for (size_t i = 0; i < n_series; ++i)
+    mean[i] = mx.sum[i] / n[i];
+  for (size_t s = 0; s < n_stacks; ++s)
+    moments_row(x.data() + s * n_series, psel ? psel + s * n_series : nullptr, n_series, mean.data(), mx);
+
+  size_t valid = 0;
+  for (size_t i = 0; i < n_series; ++i) {
+    if (n[i] < 4.0)
+      continue;
+    finish(mx, i, n[i], mean[i], 0, out[i]);
+    ++valid;
+  }
+  return valid;
+}
+
+size_t batch_stats::linreg(const std::vector<double> &x, const std::vector<double> &y, const size_t n_series, std::vector<statrec> &out,
+                           const std::vector<uint8_t> *sel) {
+  out.assign(n_series, statrec());
+  if (!check(x, n_series, sel, __func__) || !check(y, n_series, sel, __func__))
+    return 0;
+  if (x.size() != y.size()) {
+    std::cerr << "batch_stats::" << __func__ << " x and y not of same size: " << x.size() << " " << y.size() << std::endl;
+    return 0;
+  }
+  const size_t n_stacks = x.size() / n_series;
+  const uint8_t *psel = (sel == nullptr) ? nullptr : sel->data();
+  std::vector<double> n, mean_x(n_series), mean_y(n_series), sxy(n_series, 0.0);
+  moments mx, my;
+  mx.resize(n_series);
+  my.resize(n_series);
+  count(sel, n_stacks, n_series, n);
+  // first pass: one stack row of x and y at a time, all accumulators updated while the row is in the cache
+  for (size_t s = 0; s < n_stacks; ++s) {
+    const double *px = x.data() + s * n_series;
+    const double *py = y.data() + s * n_series;
+    const uint8_t *ps = psel ? psel + s * n_series : nullptr;
+    sums_row(px, ps, n_series, mx);
+    sums_row(py, ps, n_series, my);
+    double *pxy = sxy.data();
+    for (size_t i = 0; i < n_series; ++i)
+      pxy[i] += ((ps == nullptr) || ps[i]) ? px[i] * py[i] : 0.0;
+  }
+  for (size_t i = 0; i < n_series; ++i) {
+    mean_x[i] = mx.sum[i] / n[i];
+    mean_y[i] = my.sum[i] / n[i];
+  }
+  for (size_t s = 0; s < n_stacks; ++s) {
+    const uint8_t *ps = psel ? psel + s * n_series : nullptr;
+    moments_row(x.data() + s * n_series, ps, n_series, mean_x.data(), mx);
+    moments_row(y.data() + s * n_series, ps, n_series, mean_y.data(), my);
+  }
+
+  size_t valid = 0;
+  for (size_t i = 0; i < n_series; ++i) {
+    if (n[i] < 4.0)
+      continue;
+    statrec &rec = out[i];
+    finish(mx, i, n[i], mean_x[i], 0, rec);
+    finish(my, i, n[i], mean_y[i], g_stat::xstat_size, rec);
+    // same as two_pass_linreg::calc_all
+    const double d_n = n[i];
+    const double s_xy = (sxy[i] - mx.sum[i] * my.sum[i] / d_n) / (d_n - 1.0);
+    const double slope = s_xy / rec[g_stat::variance_x];
+    rec[g_stat::covariance_xy] = s_xy;
+    rec[g_stat::correlation_xy] = s_xy / (rec[g_stat::stddev_x] * rec[g_stat::stddev_y]);
+    rec[g_stat::slope_xy] = slope;
+    rec[g_stat::abscissa_xy] = mean_y[i] - slope * mean_x[i];
+    rec[g_stat::sum_alldist_from_slope_xy] = (d_n - 1.0) * (rec[g_stat::variance_y] - std::pow(slope, 2.0) * rec[g_stat::variance_x]);
+    ++valid;
+  }
+  return valid;
+}
+
+size_t batch_stats::variance(const std::vector<double> &x, const size_t n_series, std::vector<statrec> &out, const bitmask &sel) {
+  if (sel.size() != x.size()) {
+    out.assign(n_series, statrec());
+    std::cerr << "batch_stats::" << __func__ << " data and selection have different sizes: " << x.size() << " " << sel.size() << std::endl;
+    return 0;
+  }
+  const std::vector<uint8_t> bytes(sel.to_bytes());
+  return variance(x, n_series, out, &bytes);
+}
+
+size_t batch_stats::linreg(const std::vector<double> &x, const std::vector<double> &y, const size_t n_series, std::vector<statrec> &out,
+                           const bitmask &sel) {
+  if (sel.size() != x.size()) {
+    out.assign(n_series, statrec());
+    std::cerr << "batch_stats::" << __func__ << " data and selection have different sizes: " << x.size() << " " << sel.size() << std::endl;
+    return 0;
+  }
+  const std::vector<uint8_t> bytes(sel.to_bytes());
+  return linreg(x, y, n_series, out, &bytes);
+}
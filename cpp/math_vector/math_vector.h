@@ -34,6 +34,7 @@
 #include <cfloat>
 #include <cmath>
 #include <complex>
+#include <cstdint>
 #include <cstdlib>
 #include <iomanip>
 #include <iostream>
@@ -42,6 +43,7 @@
 #include <utility>
 #include <vector>
 
+#include "bitmask.h"
 #include "iterator_templates.h"
 #include "statmaps.h"
 #include "vector_math.h" // template base functions for vector
@@ -76,6 +78,13 @@ public:
                           std::vector<bool>::const_iterator selected_cbeg, std::vector<bool>::const_iterator selected_cend,
                           const size_t min_valid_elements = 4, const int control = 0);
 
+  /*!
+   * \brief vector_size_if_min same for a packed selection mask; trues are counted by popcount
+   */
+  bool vector_size_if_min(std::vector<double>::const_iterator xcbeg, std::vector<double>::const_iterator xcend,
+                          const bitmask &selected,
+                          const size_t min_valid_elements = 4, const int control = 0);
+
   bool vector_size_if_min_cplx(std::vector<std::complex<double>>::const_iterator xcbeg, std::vector<std::complex<double>>::const_iterator xcend,
                                std::vector<bool>::const_iterator selected_cbeg, std::vector<bool>::const_iterator selected_cend,
                                const size_t min_valid_elements = 4, const int control = 0);
@@ -106,6 +115,18 @@ public:
                   std::vector<bool>::const_iterator selected_cbeg, std::vector<bool>::const_iterator selected_cend,
                   const size_t min_valid_elements = 4, const int control = 0);
 
+  bool vector_sizes_if_min(std::vector<double>::const_iterator xcbeg, std::vector<double>::const_iterator xcend,
+                           std::vector<double>::const_iterator ycbeg, std::vector<double>::const_iterator ycend,
+                           const bitmask &selected,
+                           const size_t min_valid_elements = 4, const int control = 0);
+
+  /*!
+   * \brief sel_mean mean of the selected x; mask words are evaluated in one go, empty words skipped
+   */
+  double sel_mean(std::vector<double>::const_iterator xcbeg, std::vector<double>::const_iterator xcend,
+                  const bitmask &selected,
+                  const size_t min_valid_elements = 4, const int control = 0);
+
   /*!
    *  mk_variance_data contains all data to transport from statistiks using
    * variance
@@ -327,6 +348,19 @@ public:
                       std::vector<bool>::const_iterator selected_cbeg, std::vector<bool>::const_iterator selected_cend,
                       const double median_or_mean_initvalue = 0.0);
 
+  /*!
+   * \brief variance_if with a packed selection mask (selected.size() == x.size()); the sums use independent partial sums
+   * per lane, so they agree with the std::vector<bool> version to rounding; min and max are taken from the selected values only
+   */
+  statmap variance_if(std::vector<double>::const_iterator xcbeg, std::vector<double>::const_iterator xcend,
+                      const bitmask &selected,
+                      const double median_or_mean_initvalue = 0.0);
+
+  /*!
+   * \brief record the results of the last variance call as fixed layout record (x part)
+   */
+  statrec record() const;
+
   friend std::ostream &operator<<(std::ostream &out,
                                   const two_pass_variance &a);
 
@@ -349,6 +383,16 @@ public:
                            const double center_x = 0.0, const double center_y = 0.0,
                            const int slope_type_0s_1u_2l = 0, double extra_offsety = 0.0);
 
+  /*!
+   * \brief mkselect_in_out_reg same, writes the in / out decision into a packed mask, word by word
+   */
+  bool mkselect_in_out_reg(std::vector<double>::const_iterator xcbeg, std::vector<double>::const_iterator xcend,
+                           std::vector<double>::const_iterator ycbeg, std::vector<double>::const_iterator ycend,
+                           bitmask &selected,
+                           const statmap &regression_data,
+                           const double center_x = 0.0, const double center_y = 0.0,
+                           const int slope_type_0s_1u_2l = 0, double extra_offsety = 0.0);
+
   double d_n = 0.0;
   double d_slope = 0.0;
   double d_abscissa = 0.0;
@@ -374,8 +418,21 @@ public:
                     std::vector<bool>::const_iterator selected_cbeg, std::vector<bool>::const_iterator selected_cend,
                     const double median_or_mean_subtract_y = 0.0);
 
+  /*!
+   * \brief linreg_if with a packed selection mask, see two_pass_variance::variance_if
+   */
+  statmap linreg_if(std::vector<double>::const_iterator xcbeg, std::vector<double>::const_iterator xcend,
+                    std::vector<double>::const_iterator ycbeg, std::vector<double>::const_iterator ycend,
+                    const bitmask &selected,
+                    const double median_or_mean_subtract_y = 0.0);
+
   double test_against_other_slope(const double &other_slope, statmap &result);
 
+  /*!
+   * \brief record the results of the last linreg call as fixed layout record, x, y and regression part
+   */
+  statrec record() const;
+
   double S_xy; //!< (covaiance * n) of this sample
   size_t n;    //!< total elements
   double d_n;  //!< above as double
@@ -439,4 +496,50 @@ private:
   void calc_all();
 };
 
+/*!
+ * \brief The batch_stats class: variance and linear regression of MANY series in one go, e.g. all frequencies of a station over all stacks
+ *
+ * data is stack major: x[stack * n_series + series]; the inner loops run over the series (contiguous) with independent accumulators
+ * per series, so they vectorize without changing the summation order - the results are the same as two_pass_variance / two_pass_linreg
+ * for each series. Two fused passes: sums, min, max (and the cross sum) first, central moments second.
+ * sel: nullptr (all) or a byte mask in the same layout, 1 = use, 0 = skip; evaluated branch free; or a bitmask in the same layout.
+ * Series with less than 4 selected values keep the DBL_MAX initialized statrec (two_pass_variance returns an empty statmap).
+ */
+class batch_stats {
+public:
+  /*!
+   * \brief variance for n_series series; out[series] gets the x part like two_pass_variance::variance
+   * \return number of valid series
+   */
+  static size_t variance(const std::vector<double> &x, const size_t n_series, std::vector<statrec> &out,
+                         const std::vector<uint8_t> *sel = nullptr);
+
+  /*!
+   * \brief linreg y = slope * x + abscissa for n_series series; out[series] gets x, y and regression part like two_pass_linreg::linreg
+   * \return number of valid series
+   */
+  static size_t linreg(const std::vector<double> &x, const std::vector<double> &y, const size_t n_series, std::vector<statrec> &out,
+                       const std::vector<uint8_t> *sel = nullptr);
+
+  static size_t variance(const std::vector<double> &x, const size_t n_series, std::vector<statrec> &out, const bitmask &sel);
+
+  static size_t linreg(const std::vector<double> &x, const std::vector<double> &y, const size_t n_series, std::vector<statrec> &out,
+                       const bitmask &sel);
+
+private:
+  /*!
+   * \brief The moments struct accumulators of one variable, one entry per series
+   */
+  struct moments {
+    std::vector<double> sum, min, max, ep, m2, m3, m4;
+    void resize(const size_t n_series);
+  };
+
+  static bool check(const std::vector<double> &x, const size_t n_series, const std::vector<uint8_t> *sel, const char *func);
+  static void sums_row(const double *x, const uint8_t *sel, const size_t n_series, moments &m);
+  static void moments_row(const double *x, const uint8_t *sel, const size_t n_series, const double *mean, moments &m);
+  static void count(const std::vector<uint8_t> *sel, const size_t n_stacks, const size_t n_series, std::vector<double> &n);
+  static void finish(const moments &m, const size_t i, const double d_n, const double mean, const size_t offset, statrec &rec);
+};
+
 #endif // MATH_VECTOR_H
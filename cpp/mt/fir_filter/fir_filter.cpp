@@ -31,14 +31,14 @@ std::shared_ptr<channel> fir_filter::set_filter(std::shared_ptr<channel> &chan,
     this->out_chan.reset();
   this->out_chan = std::make_shared<channel>(chan); // that is a new channel, not a copy
 
-  sql_filter = std::make_unique<sqlite_handler>(this->db_file);
-
   this->filter_type = filter_type;
   this->filter_factor = std::stoi(filter_type.substr(3));
 
+  // many channels are filtered with the same coefficients: the connection and the prepared statement are reused
   std::string sql_query = "SELECT * FROM " + this->filter_type;
   try {
-    this->coeff = sql_filter->sqlite_vector_double(sql_query);
+    this->sql_filter = sqlite_handler::shared_ro(this->db_file);
+    this->sql_filter->select_doubles(sql_query, this->coeff);
   } catch (const std::runtime_error &error) {
     std::cerr << error.what() << std::endl;
     this->sql_filter.reset();
@@ -62,6 +62,8 @@ void fir_filter::filter() {
   // shift samples to fit into the raster
   // filter samples
   // write samples to output channel
+  mtprof::scoped_timer prof("fir_filter", this->in_chan->prof_name());
+  size_t samples_out = 0;
   std::ofstream file;
   std::vector<double> in(this->coeff.size()), out;
   out.reserve(256); // write in chunks of 256 samples
@@ -78,16 +80,24 @@ void fir_filter::filter() {
   while (this->in_chan->read_data() > 0) {
     out.push_back(bvec::fold(this->in_chan->ts_slice, this->coeff));
     if (out.size() == 256) {
+      samples_out += out.size();
       this->out_chan->write_data(out);
       out.clear();
       out.reserve(256);
     }
   }
   if (out.size()) {
+    samples_out += out.size();
     this->out_chan->write_data(out);
   }
   this->in_chan->close_atss_read();
   this->out_chan->close_outfile();
+  if (prof.is_active()) {
+    const double bytes = double(samples_out * this->filter_factor * sizeof(double));
+    prof.arg("samples_out", double(samples_out));
+    prof.arg("bytes", bytes);
+    mtprof::count("read bytes", bytes);
+  }
 }
 
 void fir_filter::shift_to_new_start_time(const bool &shift_to_full_seconds) {
@@ -47,7 +47,7 @@ private:
 
   void shift_to_grid(const int64_t grid_raster = 0);
 
-  std::unique_ptr<sqlite_handler> sql_filter;
+  std::shared_ptr<sqlite_handler> sql_filter; //!< read only, shared cache connection of this thread, see sqlite_handler::shared_ro
   std::filesystem::path db_file; //!< path to the database file with filter coefficients
 };
 
@@ -0,0 +1,216 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numbers>
+
+resampler::resampler(const size_t &half_taps, const size_t &phases, const double &beta, const double &rolloff) :
+    half_taps(half_taps), taps(2 * half_taps), phases(phases), beta(beta), rolloff(rolloff) {
+  if ((half_taps < 2) || (phases < 1)) {
+    std::ostringstream err_str((std::string("resampler::") + __func__), std::ios_base::ate);
+    err_str << " half taps must be > 1 and phases > 0, got " << half_taps << " " << phases;
+    throw std::runtime_error(err_str.str());
+  }
+  if ((rolloff <= 0.0) || (rolloff > 1.0)) {
+    std::ostringstream err_str((std::string("resampler::") + __func__), std::ios_base::ate);
+    err_str << " rolloff must be in (0, 1], got " << rolloff;
+    throw std::runtime_error(err_str.str());
+  }
+}
+
+resampler::~resampler() {
+  if (this->in_chan != nullptr)
+    this->in_chan.reset();
+  if (this->out_chan != nullptr)
+    this->out_chan.reset();
+}
+
+void resampler::make_table(const double &cutoff) {
+  if (!this->table.empty() && (this->cutoff == cutoff))
+    return;
+  this->cutoff = cutoff;
+  this->table.assign((this->phases + 1) * this->taps, 0.0);
+  const double i0_beta = std::cyl_bessel_i(0.0, this->beta);
+  const double half = double(this->half_taps);
+  for (size_t p = 0; p <= this->phases; ++p) {
+    const double frac = double(p) / double(this->phases);
+    double *row = &this->table[p * this->taps];
+    double sum = 0.0;
+    for (size_t k = 0; k < this->taps; ++k) {
+      // distance of the input sample k to the output position
+      const double d = double(k) - (half - 1.0) - frac;
+      const double r = d / half;
+      if (std::abs(r) >= 1.0)
+        continue;
+      const double x = std::numbers::pi * cutoff * d;
+      const double sinc = (std::abs(x) < 1.0E-12) ? 1.0 : std::sin(x) / x;
+      row[k] = sinc * std::cyl_bessel_i(0.0, this->beta * std::sqrt(1.0 - r * r)) / i0_beta;
+      sum += row[k];
+    }
+    // unity gain at DC for every phase
+    for (size_t k = 0; k < this->taps; ++k)
+      row[k] /= sum;
+  }
+}
+
+void resampler::init(const double &ratio, const double &first_pos) {
+  if (ratio <= 0.0) {
+    std::ostringstream err_str((std::string("resampler::") + __func__), std::ios_base::ate);
+    err_str << " ratio must be > 0, got " << ratio;
+    throw std::runtime_error(err_str.str());
+  }
+  if (first_pos < double(this->half_taps - 1)) {
+    std::ostringstream err_str((std::string("resampler::") + __func__), std::ios_base::ate);
+    err_str << " first position " << first_pos << " needs " << this->half_taps - 1 << " samples history";
+    throw std::runtime_error(err_str.str());
+  }
+  this->ratio = ratio;
+  this->make_table(std::min(1.0, 1.0 / ratio) * this->rolloff);
+  this->pos = first_pos;
+  this->pos0 = first_pos;
+  this->n_made = 0;
+  this->consumed = 0;
+  this->hist.clear();
+  this->hist.reserve(this->block_size + this->taps);
+}
+
+size_t resampler::push(const std::vector<double> &in, std::vector<double> &out) {
+  this->hist.insert(this->hist.end(), in.begin(), in.end());
+  const size_t old_size = out.size();
+  const double *x = this->hist.data();
+  const double n = double(this->hist.size());
+  const double dphases = double(this->phases);
+  // the kernel of pos covers floor(pos) - half_taps + 1 ... floor(pos) + half_taps
+  while (this->pos + double(this->half_taps) < n) {
+    const double ipos = std::floor(this->pos);
+    const double f = (this->pos - ipos) * dphases;
+    const double fp = std::min(std::floor(f), dphases - 1.0); // f may round up to phases
+    const double a = f - fp;
+    const double *r0 = &this->table[size_t(fp) * this->taps];
+    const double *r1 = r0 + this->taps;
+    const double *xs = x + (size_t(ipos) + 1 - this->half_taps);
+    double s0 = 0.0, s1 = 0.0;
+    for (size_t k = 0; k < this->taps; ++k) {
+      s0 += r0[k] * xs[k];
+      s1 += r1[k] * xs[k];
+    }
+    out.push_back(s0 + a * (s1 - s0));
+    // from the absolute count, a running sum would drift over millions of samples
+    ++this->n_made;
+    this->pos = this->pos0 + double(this->n_made) * this->ratio - double(this->consumed);
+  }
+  // keep the history of the next kernel only
+  const double ipos = std::floor(this->pos);
+  if (ipos >= double(this->half_taps)) {
+    const size_t drop = std::min(this->hist.size(), size_t(ipos) + 1 - this->half_taps);
+    this->hist.erase(this->hist.begin(), this->hist.begin() + std::ptrdiff_t(drop));
+    this->consumed += drop;
+    this->pos = this->pos0 + double(this->n_made) * this->ratio - double(this->consumed);
+  }
+  return out.size() - old_size;
+}
+
+std::shared_ptr<channel> resampler::set_resampler(std::shared_ptr<channel> &chan, const double &new_sample_rate, const p_timer &new_start,
+                                                  const double &actual_sample_rate) {
+  if (chan == nullptr) {
+    std::ostringstream err_str((std::string("resampler::") + __func__), std::ios_base::ate);
+    err_str << " channel is null ";
+    throw std::runtime_error(err_str.str());
+  }
+  this->in_chan = chan;
+  if (this->out_chan != nullptr)
+    this->out_chan.reset();
+  this->out_chan = std::make_shared<channel>(chan); // that is a new channel, not a copy
+
+  const double fs_in = (actual_sample_rate > 0.0) ? actual_sample_rate : chan->get_sample_rate();
+  const double fs_out = (new_sample_rate > 0.0) ? new_sample_rate : chan->get_sample_rate();
+  if ((fs_in < treat_as_null) || (fs_out < treat_as_null)) {
+    std::ostringstream err_str((std::string("resampler::") + __func__), std::ios_base::ate);
+    err_str << " sample rates must be > 0, in: " << fs_in << " out: " << fs_out;
+    throw std::runtime_error(err_str.str());
+  }
+  this->out_chan->set_sample_rate(fs_out);
+
+  // offset of the new start in seconds; full seconds and fracs are kept apart for precision
+  const double history = double(this->half_taps - 1);
+  double dt = 0.0;
+  if (new_start.tt == 0) {
+    const double secs = std::ceil(chan->pt.fracs + history / fs_in);
+    dt = secs - chan->pt.fracs;
+    this->out_chan->pt.tt = chan->pt.tt + time_t(secs);
+    this->out_chan->pt.fracs = 0.0;
+  } else {
+    dt = double(new_start.tt - chan->pt.tt) + (new_start.fracs - chan->pt.fracs);
+    this->out_chan->pt.tt = new_start.tt;
+    this->out_chan->pt.fracs = new_start.fracs;
+  }
+
+  double total = dt * fs_in;
+  if (total < history - 1.0E-6) {
+    std::ostringstream err_str((std::string("resampler::") + __func__), std::ios_base::ate);
+    err_str << " new start time is " << total << " samples after the start, need at least " << history;
+    throw std::runtime_error(err_str.str());
+  }
+  total = std::max(total, history);
+  this->samples_skip = size_t(std::floor(total) - history);
+  this->first_pos = total - double(this->samples_skip);
+
+  this->init(fs_in / fs_out, this->first_pos);
+
+  // output samples with a complete kernel: floor(pos) + half_taps < available samples
+  const size_t n_in = chan->samples();
+  const double avail = double(n_in) - double(this->samples_skip) - double(this->half_taps) - this->first_pos;
+  this->samples_out = (avail > 0.0) ? size_t(std::ceil(avail / this->ratio)) : 0;
+  if (!this->samples_out) {
+    std::ostringstream err_str((std::string("resampler::") + __func__), std::ios_base::ate);
+    err_str << " channel too short for the new start time " << chan->get_atss_filepath();
+    throw std::runtime_error(err_str.str());
+  }
+  return this->out_chan;
+}
+
+void resampler::resample() {
+  std::cout << this->in_chan->get_filepath_wo_ext() << " -> " << this->out_chan->get_filepath_wo_ext() << std::endl;
+  mtprof::scoped_timer prof("resampler", this->in_chan->prof_name());
+  std::ifstream file(this->in_chan->get_atss_filepath(), std::ios::in | std::ios::binary);
+  if (!file.is_open()) {
+    std::ostringstream err_str((std::string("resampler::") + __func__), std::ios_base::ate);
+    err_str << " can not open " << this->in_chan->get_atss_filepath();
+    throw std::runtime_error(err_str.str());
+  }
+  file.seekg(std::streamoff(this->samples_skip * sizeof(double)));
+  this->init(this->ratio, this->first_pos);
+
+  std::vector<double> in(this->block_size), out;
+  out.reserve(size_t(double(this->block_size) / this->ratio) + 2);
+  size_t samples_in = 0, samples_written = 0;
+  while (file) {
+    file.read(reinterpret_cast<char *>(in.data()), std::streamsize(in.size() * sizeof(double)));
+    const size_t got = size_t(file.gcount()) / sizeof(double);
+    if (!got)
+      break;
+    in.resize(got);
+    samples_in += got;
+    out.clear();
+    this->push(in, out);
+    if (out.size()) {
+      this->out_chan->write_data(out);
+      samples_written += out.size();
+    }
+  }
+  this->out_chan->close_outfile();
+  if (prof.is_active()) {
+    const double bytes = double(samples_in * sizeof(double));
+    prof.arg("samples_out", double(samples_written));
+    prof.arg("bytes", bytes);
+    mtprof::count("read bytes", bytes);
+  }
+}
+
+std::string resampler::get_info() const {
+  std::ostringstream info_str;
+  info_str << "resampler: ratio " << std::setprecision(12) << this->ratio << "  taps: " << this->taps << "  phases: " << this->phases;
+  info_str << "  samples skip: " << this->samples_skip << "  first pos: " << this->first_pos << "  samples out: " << this->samples_out;
+  return info_str.str();
+}
@@ -0,0 +1,102 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "atss.h"
+
+/*!
+ * @file resampler.h
+ * @brief streaming polyphase resampler: shifts a time series by fractional samples and / or converts to a (slightly) different sample rate
+ *
+ * the interpolation kernel is a Kaiser windowed sinc, tabulated for phases + 1 fractional positions; the coefficients of the
+ * actual position are blended linearly from the two neighbouring phases (Farrow like, first order); each output sample is a dot product of 2 * half_taps
+ * input samples. The input is pushed in blocks, only 2 * half_taps samples of history are kept - memory is bounded by the block size.
+ * In contrast to fir_filter::shift_to_new_start_time (integer samples to full seconds) the output start time can be anything, the fracs
+ * of the input are removed.
+ * \code
+ *   auto rs = std::make_shared<resampler>();
+ *   auto out_chan = rs->set_resampler(chan);          // same sample rate, next possible full second
+ *   out_chan->set_dir(out_dir);
+ *   out_chan->write_header();
+ *   pool->detach_task([rs]() { rs->resample(); });   // one task per channel
+ * \endcode
+ */
+
+class resampler {
+public:
+  /*!
+   * \brief resampler
+   * \param half_taps kernel half length in input samples; 32 gives a flat pass band up to about 0.4 of the (lower) sample rate
+   * \param phases fractional positions tabulated between two input samples
+   * \param beta Kaiser window shape; 8 is about -80 dB stop band
+   * \param rolloff cut off relative to the lower Nyquist frequency
+   */
+  resampler(const size_t &half_taps = 32, const size_t &phases = 512, const double &beta = 8.0, const double &rolloff = 0.9);
+
+  ~resampler();
+
+  /*!
+   * \brief init the stream
+   * \param ratio input sample rate / output sample rate; 1 is a pure shift
+   * \param first_pos position of the first output sample in input samples, counted from the first pushed sample; must be >= half_taps - 1
+   */
+  void init(const double &ratio, const double &first_pos);
+
+  /*!
+   * \brief push a block of input; appends all output samples which have a complete kernel
+   * \return output samples appended
+   */
+  size_t push(const std::vector<double> &in, std::vector<double> &out);
+
+  /*!
+   * \brief set_resampler prepares the channel wise resampling, like fir_filter::set_filter
+   * \param chan input channel
+   * \param new_sample_rate output sample rate, 0 keeps the sample rate (fractional shift only)
+   * \param new_start start time of the output; empty (tt == 0) gives the next full second with a complete kernel
+   * \param actual_sample_rate the true sample rate of the input, e.g. a drifting clock measured against GPS; 0 takes the header sample rate
+   * \return the output channel; start time and sample rate set
+   */
+  std::shared_ptr<channel> set_resampler(std::shared_ptr<channel> &chan, const double &new_sample_rate = 0.0, const p_timer &new_start = p_timer(),
+                                         const double &actual_sample_rate = 0.0);
+
+  /*!
+   * \brief resample does the actual resampling inside a thread: reads the atss of the input block wise and writes the output channel
+   */
+  void resample();
+
+  std::string get_info() const;
+
+  size_t get_half_taps() const {
+    return this->half_taps;
+  }
+
+private:
+  size_t half_taps = 32;     //!< kernel half length
+  size_t taps = 64;          //!< 2 * half_taps
+  size_t phases = 512;       //!< fractional positions between two input samples
+  double beta = 8.0;         //!< Kaiser window
+  double rolloff = 0.9;      //!< cut off relative to the lower Nyquist frequency
+  double cutoff = 0.0;       //!< cut off of the table, relative to the input Nyquist frequency
+  std::vector<double> table; //!< (phases + 1) rows of taps coefficients, row p is the kernel for the fraction p / phases
+
+  double ratio = 1.0;        //!< input sample rate / output sample rate
+  double pos = 0.0;          //!< position of the next output sample relative to hist[0], in input samples
+  double pos0 = 0.0;         //!< position of the first output sample
+  size_t n_made = 0;         //!< output samples made since init
+  size_t consumed = 0;       //!< input samples dropped from hist since init
+  std::vector<double> hist;  //!< input samples not consumed yet
+
+  std::shared_ptr<channel> in_chan, out_chan;
+  size_t samples_skip = 0;   //!< whole input samples before the first kernel
+  double first_pos = 0.0;    //!< position of the first output sample after skipping
+  size_t samples_out = 0;    //!< output samples which have a complete kernel inside the input
+  size_t block_size = 65536; //!< input samples read at once
+
+  void make_table(const double &cutoff);
+};
+
+#endif // RESAMPLER_H
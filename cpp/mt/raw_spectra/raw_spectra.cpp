@@ -1,4 +1,5 @@
 #include "raw_spectra.h"
+#include "math_vector.h"
 
 void raw_spectra::move_raw_spectra(std::shared_ptr<channel> chan) {
 
@@ -12,8 +13,6 @@ void raw_spectra::advanced_stack_all(const double &fraction_to_use) {
     err_str << "::no spectra for stacking available";
     throw std::runtime_error(err_str.str());
   }
-  std::cerr << "pushing tasks to thread pool" << std::endl;
-
   for (auto &ac : this->sa) {
     if (fraction_to_use < 0.0 || fraction_to_use > 1.0) {
       std::ostringstream err_str(__func__, std::ios_base::ate);
@@ -35,6 +34,191 @@ void raw_spectra::advanced_stack_all(const double &fraction_to_use) {
   }
 }
 
+size_t raw_spectra::select_stacks(const size_t &bands, const double &min_coherence, const double &max_slope_dev) {
+  std::vector<std::pair<std::shared_ptr<std::vector<std::vector<std::complex<double>>>>, std::shared_ptr<std::vector<std::vector<std::complex<double>>>>>> eh;
+  for (const auto &p : std::vector<std::pair<std::string, std::string>>{{"Ex", "Hy"}, {"Ey", "Hx"}}) {
+    auto e = this->find(std::make_pair(p.first, std::string()));
+    auto h = this->find(std::make_pair(p.second, std::string()));
+    if ((e != this->end()) && (h != this->end()))
+      eh.emplace_back(e->second, h->second);
+  }
+  if (!eh.size()) {
+    std::ostringstream err_str(__func__, std::ios_base::ate);
+    err_str << "::need Ex and Hy or Ey and Hx spectra for the stack selection";
+    throw std::runtime_error(err_str.str());
+  }
+  const size_t n_stacks = eh.front().first->size();
+  const size_t nf = n_stacks ? eh.front().first->at(0).size() : 0;
+  for (const auto &p : eh) {
+    if ((p.first->size() != n_stacks) || (p.second->size() != n_stacks)) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::E and H spectra have different stacks";
+      throw std::runtime_error(err_str.str());
+    }
+  }
+  if (!bands || (nf < 4)) {
+    std::ostringstream err_str(__func__, std::ios_base::ate);
+    err_str << "::need at least one band and 4 frequencies, have " << bands << " bands and " << nf << " frequencies";
+    throw std::runtime_error(err_str.str());
+  }
+
+  mtprof::scoped_timer prof("select_stacks", this->prof_name());
+  const size_t nb = std::min(bands, nf / 4);
+  this->stack_sel.assign(nb, bitmask(n_stacks, true));
+  this->stack_sel_bands.resize(nb + 1);
+  for (size_t b = 0; b <= nb; ++b)
+    this->stack_sel_bands[b] = b * nf / nb;
+
+  std::vector<double> x, y, coh(n_stacks), slopes;
+  std::vector<statrec> recs;
+  for (size_t b = 0; b < nb; ++b) {
+    const size_t fb = this->stack_sel_bands[b], fe = this->stack_sel_bands[b + 1];
+    bitmask &sel = this->stack_sel[b];
+    for (const auto &p : eh) {
+      // x = |H|, y = |E| in the batch_stats layout [frequency * n_stacks + stack]; the coherence per stack over the band
+      x.resize((fe - fb) * n_stacks);
+      y.resize(x.size());
+      for (size_t s = 0; s < n_stacks; ++s) {
+        const auto &e = p.first->at(s);
+        const auto &h = p.second->at(s);
+        std::complex<double> eh_sum(0.0);
+        double ee = 0.0, hh = 0.0;
+        for (size_t i = fb; i < fe; ++i) {
+          eh_sum += e[i] * std::conj(h[i]);
+          ee += std::norm(e[i]);
+          hh += std::norm(h[i]);
+          x[(i - fb) * n_stacks + s] = std::abs(h[i]);
+          y[(i - fb) * n_stacks + s] = std::abs(e[i]);
+        }
+        coh[s] = ((ee > 0.0) && (hh > 0.0)) ? std::norm(eh_sum) / (ee * hh) : 0.0;
+      }
+      batch_stats::linreg(x, y, n_stacks, recs);
+
+      bitmask pair_sel(n_stacks);
+      slopes.clear();
+      for (size_t s = 0; s < n_stacks; ++s) {
+        if (recs[s].has(g_stat::slope_xy) && std::isfinite(recs[s][g_stat::slope_xy]) && (coh[s] >= min_coherence)) {
+          pair_sel.set(s);
+          slopes.push_back(recs[s][g_stat::slope_xy]);
+        }
+      }
+      if ((max_slope_dev > 0.0) && (slopes.size() > 2)) {
+        const double med = bvec::median(slopes);
+        for (auto &sl : slopes)
+          sl = std::fabs(sl - med);
+        const double limit = max_slope_dev * 1.4826 * bvec::median(slopes);
+        if (limit > 0.0) {
+          pair_sel.for_each_set([&](const size_t s) {
+            if (std::fabs(recs[s][g_stat::slope_xy] - med) > limit)
+              pair_sel.reset(s);
+          });
+        }
+      }
+      sel &= pair_sel;
+    }
+  }
+
+  bitmask used_everywhere(n_stacks, true);
+  for (const auto &sel : this->stack_sel)
+    used_everywhere &= sel;
+  const size_t rejected = n_stacks - used_everywhere.count();
+  prof.arg("stacks", double(n_stacks));
+  prof.arg("rejected", double(rejected));
+  prof.arg("empty bands", double(this->empty_stack_bands()));
+  return rejected;
+}
+
+size_t raw_spectra::empty_stack_bands() const {
+  return size_t(std::count_if(this->stack_sel.cbegin(), this->stack_sel.cend(), [](const bitmask &sel) { return sel.none(); }));
+}
+
+void raw_spectra::clear_stack_selection() {
+  this->stack_sel.clear();
+  this->stack_sel_bands.clear();
+}
+
+const bitmask *raw_spectra::stack_mask(const size_t &fidx) const {
+  if (!this->stack_sel.size())
+    return nullptr;
+  // first band whose end is beyond fidx
+  auto it = std::upper_bound(this->stack_sel_bands.cbegin() + 1, this->stack_sel_bands.cend(), fidx);
+  if (it == this->stack_sel_bands.cend())
+    return nullptr;
+  return &this->stack_sel[size_t(std::distance(this->stack_sel_bands.cbegin() + 1, it))];
+}
+
+void raw_spectra::advanced_stack(const std::pair<std::string, std::string> &name, const double &fraction_to_use) {
+  if (this->size() == 0) {
+    std::ostringstream err_str(__func__, std::ios_base::ate);
+    err_str << "::no spectra for stacking available";
+    throw std::runtime_error(err_str.str());
+  }
+  if (fraction_to_use < 0.0 || fraction_to_use > 1.0) {
+    std::ostringstream err_str(__func__, std::ios_base::ate);
+    err_str << "::fraction_to_use must be between 0.01 and 1.0";
+    throw std::runtime_error(err_str.str());
+  }
+  if (sa.is_auto_spc(name))
+    this->do_advanced_stack_auto(name, fraction_to_use);
+  else
+    this->do_advanced_stack_cross(name, fraction_to_use);
+}
+
+void raw_spectra::init_online_stack(const double &fraction_to_use) {
+  if (this->sa.size() == 0) {
+    std::ostringstream err_str(__func__, std::ios_base::ate);
+    err_str << "::no sa spectra prepared for online stacking";
+    throw std::runtime_error(err_str.str());
+  }
+  if (fraction_to_use < 0.0 || fraction_to_use > 1.0) {
+    std::ostringstream err_str(__func__, std::ios_base::ate);
+    err_str << "::fraction_to_use must be between 0.01 and 1.0";
+    throw std::runtime_error(err_str.str());
+  }
+  this->online.clear();
+  for (const auto &ac : this->sa) {
+    this->online.emplace(ac.first, online_stack(fraction_to_use));
+  }
+}
+
+void raw_spectra::add_online_window(const std::map<std::string, std::vector<std::complex<double>>> &window) {
+  for (auto &acc : this->online) {
+    auto it1 = window.find(acc.first.first);
+    if (it1 == window.end()) {
+      std::ostringstream err_str(__func__, std::ios_base::ate);
+      err_str << "::no window for " << acc.first.first;
+      throw std::runtime_error(err_str.str());
+    }
+    if (this->sa.is_auto_spc(acc.first)) {
+      acc.second.add_auto(it1->second);
+    } else {
+      auto it2 = window.find(acc.first.second);
+      if (it2 == window.end()) {
+        std::ostringstream err_str(__func__, std::ios_base::ate);
+        err_str << "::no window for " << acc.first.second;
+        throw std::runtime_error(err_str.str());
+      }
+      acc.second.add_cross(it1->second, it2->second);
+    }
+  }
+}
+
+size_t raw_spectra::finish_online_stack() {
+  size_t stacks = 0;
+  for (auto &acc : this->online) {
+    auto out = this->sa.get_spectra(acc.first);
+    *out = acc.second.result();
+    auto xpow = std::vector<std::complex<double>>(acc.second.mean_cross_power());
+    if (this->sa_xpow.find(acc.first) == this->sa_xpow.end())
+      this->sa_xpow.add_spectra(acc.first, xpow, 0.0, true);
+    else
+      *this->sa_xpow.get_spectra(acc.first) = std::move(xpow);
+    stacks = acc.second.count();
+  }
+  this->online.clear();
+  return stacks;
+}
+
 void raw_spectra::parzen_stack_all() {
   // no previously stacked spectra
   if (this->sa.size() == 0) {
@@ -43,8 +227,8 @@ void raw_spectra::parzen_stack_all() {
     throw std::runtime_error(err_str.str());
   }
 
-  std::cerr << "pushing tasks to thread pool" << std::endl;
-
+  mtprof::scoped_timer prof("parzen", this->prof_name());
+  prof.arg("spectra", double(this->sa_prz.size()));
   for (auto &ac : this->sa_prz) {
     // get the key from sa_prz, which is the same as in sa
     auto result = this->sa_prz.get_spectra(ac.first); // put the result into sa_prz
@@ -239,13 +423,22 @@ void raw_spectra::dump_sa_prz_spectra() const {
 }
 
 void raw_spectra::do_advanced_stack_auto(const std::pair<std::string, std::string> &name, const double &fraction_to_use) {
+  mtprof::scoped_timer prof("stack", this->prof_name(name));
   auto in = this->get_spectra(name.first); // complex spectra, vector of vectors from raw_spectra
   size_t n = in->at(0).size();             // stack size
   auto out = this->sa.get_spectra(name);   // double spectra, vector, we reserved the space in advance
   bool adv = (fraction_to_use < 1.0);
+  this->check_stack_selection(in->size(), n, __func__);
   out->resize(n, 0.0);
-  for (size_t i = 0; i < n; ++i) {                  //   for frequencies
-    auto ff = bvec::absv(bvec::get_fslice(*in, i)); // get all stacks,
+  std::vector<double> ff;
+  for (size_t i = 0; i < n; ++i) { //   for frequencies
+    const bitmask *sel = this->stack_mask(i);
+    if ((sel == nullptr) || sel->none()) { // no selection or all stacks of the band rejected (counted by empty_stack_bands)
+      ff = bvec::absv(bvec::get_fslice(*in, i)); // get all stacks,
+    } else {
+      ff.clear(); // rejected stacks are not touched
+      sel->for_each_set([&](const size_t s) { ff.push_back(std::abs((*in)[s][i])); });
+    }
     if (!adv) {
       out->at(i) = bvec::mean(ff);
     } else {
@@ -253,9 +446,11 @@ void raw_spectra::do_advanced_stack_auto(const std::pair<std::string, std::strin
     }
   }
   // out is a shared pointer to a vector of doubles, we don't need to return it or copy it
+  prof.arg("stacks", double(in->size()));
 }
 
 void raw_spectra::do_advanced_stack_cross(const std::pair<std::string, std::string> &name, const double &fraction_to_use) {
+  mtprof::scoped_timer prof("stack", this->prof_name(name));
   auto in1 = this->get_spectra(name.first);  // complex spectra, vector of vectors
   auto in2 = this->get_spectra(name.second); // complex spectra, vector of vectors
   auto out = this->sa.get_spectra(name);     // double spectra vector, we reserved the space in advance
@@ -263,14 +458,44 @@ void raw_spectra::do_advanced_stack_cross(const std::pair<std::string, std::stri
   bool adv = (fraction_to_use < 1.0);
   out->resize(n, 0.0); // stack size
 
-  for (size_t i = 0; i < n; ++i) {        // for all stacks
-    auto ff1 = bvec::get_fslice(*in1, i); // get all stacks
-    auto ff2 = bvec::get_fslice(*in2, i); // get all stacks
-    std::vector<double> ff = bvec::make_cross_sqrt_conj_abs(ff1, ff2);
+  this->check_stack_selection(in1->size(), n, __func__);
+  std::vector<double> ff;
+  for (size_t i = 0; i < n; ++i) { // for all stacks
+    const bitmask *sel = this->stack_mask(i);
+    if ((sel == nullptr) || sel->none()) {
+      auto ff1 = bvec::get_fslice(*in1, i); // get all stacks
+      auto ff2 = bvec::get_fslice(*in2, i); // get all stacks
+      ff = bvec::make_cross_sqrt_conj_abs(ff1, ff2);
+    } else {
+      ff.clear();
+      sel->for_each_set([&](const size_t s) { ff.push_back(std::sqrt(std::abs((*in1)[s][i] * std::conj((*in2)[s][i])))); });
+    }
     if (!adv) {
       out->at(i) = bvec::mean(ff);
     } else {
       out->at(i) = bvec::median_range_mean(ff, fraction_to_use);
     }
   }
+  prof.arg("stacks", double(in1->size()));
+}
+
+void raw_spectra::check_stack_selection(const size_t &n_stacks, const size_t &nf, const char *func) const {
+  if (!this->stack_sel.size())
+    return;
+  if ((this->stack_sel.front().size() != n_stacks) || (this->stack_sel_bands.back() != nf)) {
+    std::ostringstream err_str(func, std::ios_base::ate);
+    err_str << "::stack selection is for " << this->stack_sel.front().size() << " stacks and " << this->stack_sel_bands.back()
+            << " frequencies, spectra have " << n_stacks << " and " << nf;
+    throw std::runtime_error(err_str.str());
+  }
+}
+
+std::string raw_spectra::prof_name(const std::pair<std::string, std::string> &name) const {
+  if (!mtprof::enabled() || !this->channels.size())
+    return std::string();
+  auto run_dir = this->channels.front()->get_run_dir();
+  std::string result((run_dir.parent_path().filename() / run_dir.filename()).string());
+  if (name.first.size())
+    result += " " + name.first + name.second;
+  return result;
 }
@@ -12,9 +12,11 @@
 #include "BS_thread_pool.h"
 #include "atss.h"
 #include "base_constants.h"
+#include "bitmask.h"
 #include "freqs.h"
 #include "prz_vector.h"
 #include "spc_base.h"
+#include "stack_accumulators.h"
 #include "vector_math.h"
 
 #include <filesystem>
@@ -87,6 +89,61 @@ public:
    */
   void advanced_stack_all(const double &fraction_to_use = 1.0);
 
+  /*!
+   * @brief select_stacks pre-selection before stacking: the spectra are cut into bands; per stack and band the E-H coherence
+   * (Ex-Hy, Ey-Hx, where available) and the slope of |E| = slope * |H| over the band frequencies (batch_stats::linreg) are computed.
+   * A stack is rejected in a band if the coherence is below min_coherence or the slope deviates more than max_slope_dev
+   * (normalized) median absolute deviations from the median slope of the coherent stacks; a pair rejects for both.
+   * The result goes to stack_sel; advanced_stack_all / advanced_stack use only the selected stacks; a band where all stacks fail
+   * stays empty in stack_sel and is stacked with all stacks (sa gets no gaps for the parzening); empty_stack_bands counts these bands.
+   * Call after the raw spectra are complete and before stacking; a following select_stacks replaces the selection.
+   \param bands number of bands, each band gets at least 4 frequencies
+   \param min_coherence 0 ... 1, 0 switches the coherence test off
+   \param max_slope_dev 0 switches the slope test off
+   \return stacks rejected in at least one band
+   */
+  size_t select_stacks(const size_t &bands = 8, const double &min_coherence = 0.8, const double &max_slope_dev = 3.0);
+
+  /*!
+   * @brief empty_stack_bands number of bands of the last select_stacks where all stacks were rejected
+   */
+  size_t empty_stack_bands() const;
+
+  /*!
+   * @brief clear_stack_selection stacking uses all stacks again
+   */
+  void clear_stack_selection();
+
+  /*!
+   * @brief stack_mask selection of the band containing frequency index fidx (index of the spectra)
+   * \return nullptr if there is no selection
+   */
+  const bitmask *stack_mask(const size_t &fidx) const;
+
+  /*!
+   * @brief advanced_stack stacks ONE sa spectrum in the calling thread, same as advanced_stack_all does in the pool; for task graphs (task_dag.h)
+   */
+  void advanced_stack(const std::pair<std::string, std::string> &name, const double &fraction_to_use = 1.0);
+
+  /*!
+   * @brief init_online_stack prepares streaming accumulators for all sa spectra - the online counterpart of advanced_stack_all
+   * the sa spectra have to be created before; windows are added with add_online_window and NOT kept; memory is O(frequencies)
+   \param fraction_to_use same as advanced_stack_all; values < 1 use an approximate median range mean (quantile_sketch)
+   */
+  void init_online_stack(const double &fraction_to_use = 1.0);
+
+  /*!
+   * @brief add_online_window adds the spectra of ONE window of all channels; not thread safe - call from a single thread per run
+   * \param window spectra by name (spc_base::spectra_name, e.g. Hx, RHx), all of the same window
+   */
+  void add_online_window(const std::map<std::string, std::vector<std::complex<double>>> &window);
+
+  /*!
+   * @brief finish_online_stack writes the online results into sa (and the complex cross power into sa_xpow) and frees the accumulators
+   * \return stacks
+   */
+  size_t finish_online_stack();
+
   // void simple_stack_all_div(const std::shared_ptr<raw_spectra> raw, const std::string &channel_type);
 
   /*!
@@ -115,7 +172,14 @@ public:
 
   spc_base<double> sa;     //!< stack all amplitude spectra from fft
   spc_base<double> sa_prz; //!< stack all amplitude spectra smoothed (parzening) from fft
+  spc_base<std::complex<double>> sa_xpow; //!< stacked complex auto / cross power a * conj(b), filled by online stacking only
+
+  std::vector<bitmask> stack_sel;      //!< from select_stacks, one mask per band: bit s set = stack s is used; empty = all stacks
+  std::vector<size_t> stack_sel_bands; //!< first frequency index of each band of stack_sel, followed by the spectra size
 private:
+  std::map<std::pair<std::string, std::string>, online_stack> online; //!< accumulators for online stacking, key as in sa
+  std::string prof_name(const std::pair<std::string, std::string> &name = {}) const; //!< station/run and spectra for the profiler, empty if off
+  void check_stack_selection(const size_t &n_stacks, const size_t &nf, const char *func) const; //!< throws if stack_sel does not match the spectra
   void do_advanced_stack_auto(const std::pair<std::string, std::string> &name, const double &fraction_to_use);
   void do_advanced_stack_cross(const std::pair<std::string, std::string> &name, const double &fraction_to_use);
 };
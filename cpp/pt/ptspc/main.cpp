@@ -19,9 +19,11 @@
 #include "gnuplotter.h"
 #include "merge_abs_spectra.h"
 #include "mini_math.h"
+#include "profiler.h"
 #include "raw_spectra.h"
 #include "sqlite_handler.h"
 #include "strings_etc.h"
+#include "task_dag.h"
 #include "vector_math.h"
 
 // remark:
@@ -41,6 +43,12 @@ int main(int argc, char *argv[]) {
   std::cout << "reads data from a survey containing PT data" << std::endl;
   std::cout << " -u /home/bfr/tmp/ptr -highres -c Hx Hy Hz -s pt_1 -r 1 2" << std::endl;
   std::cout << " -ref Ey ... use Ey as reference channel for E/H" << std::endl;
+  std::cout << " -online ... stack while reading, raw spectra are not kept (long runs / low memory)" << std::endl;
+  std::cout << " -gplt_file ... send the plot data to gnuplot through temporary binary files instead of the pipe" << std::endl;
+  std::cout << " -mem_budget 4096 ... MB for the spectra of all runs; runs are kept in memory, spilled to disk or stacked online" << std::endl;
+  std::cout << " -spill_dir /tmp ... directory for the spill files of -mem_budget" << std::endl;
+  std::cout << " -select_stacks 8 0.8 3 ... bands, min coherence, max slope deviation: reject stacks before stacking (raw spectra only, not -online)" << std::endl;
+  std::cout << " -profile trace.json ... time per run / channel / task: summary table and Chrome trace file" << std::endl;
   std::cout << std::endl
             << "*******************************************************************************" << std::endl
             << std::endl;
@@ -60,7 +68,7 @@ int main(int argc, char *argv[]) {
   std::vector<std::shared_ptr<fftw_freqs>> tmp_fft_freqs; // fftw_freqs for labels
 
   std::vector<std::shared_ptr<run_d>> runs;
-  auto pool = std::make_shared<BS::thread_pool>(8);
+  auto pool = std::make_shared<BS::thread_pool>(); // hardware concurrency
   // try to make a stable reference by dividing by E in general
   std::string ref_channel;
 
@@ -68,6 +76,15 @@ int main(int argc, char *argv[]) {
   bool lowres = false;             // low resolution plot only
   bool highres = false;            // high resolution plot only
   bool normalize = false;          // normalize the calibration amplitude by f (old style)
+  bool online = false;             // stack while reading, do not keep the raw spectra
+  bool gplt_file = false;          // plot data via binary files
+  size_t mem_budget_mb = 0;        // memory budget for the spectra, 0 is unlimited
+  fs::path spill_dir;              // directory for spill files, default temp
+  fs::path profile_file;           // Chrome trace of the processing, empty: no profiling
+  bool select_stacks = false;      // coherence / slope pre-selection of the stacks
+  size_t sel_bands = 8;            // bands for the pre-selection
+  double sel_min_coh = 0.8;        // minimum E-H coherence of a stack
+  double sel_max_dev = 3.0;        // maximum slope deviation in median absolute deviations
 
   std::pair<double, double> f_range = {0, 0}; // frequency range
   std::pair<double, double> a_range = {0, 0}; // amplitude range
@@ -194,6 +211,33 @@ int main(int argc, char *argv[]) {
       if (marg.compare("-highres") == 0) {
         highres = true; // only high resolution plot - standard plots
       }
+      if (marg.compare("-gplt_file") == 0) {
+        gplt_file = true;
+      }
+      if (marg.compare("-online") == 0) {
+        online = true; // stack while reading
+      }
+      if (marg.compare("-profile") == 0) {
+        profile_file = std::string(argv[++l]);
+        mtprof::enable();
+      }
+      if ((marg.compare("-select_stacks") == 0) && (l < unsigned(argc - 3))) {
+        select_stacks = true;
+        sel_bands = std::stoul(std::string(argv[++l]));
+        sel_min_coh = mstr::mystod(std::string(argv[++l]));
+        sel_max_dev = mstr::mystod(std::string(argv[++l]));
+      }
+      if (marg.compare("-mem_budget") == 0) {
+        mem_budget_mb = std::stoul(std::string(argv[++l]));
+      }
+      if (marg.compare("-spill_dir") == 0) {
+        spill_dir = std::string(argv[++l]);
+        if (!fs::is_directory(spill_dir)) {
+          std::ostringstream err_str(__func__, std::ios_base::ate);
+          err_str << " -spill_dir needs an existing directory" << std::endl;
+          throw std::runtime_error(err_str.str());
+        }
+      }
       if (marg.compare("-r") == 0) {
         br = true; // prepare for runs
       }
@@ -282,6 +326,10 @@ int main(int argc, char *argv[]) {
     std::cout << " exit failure setting axis " << std::endl;
     return EXIT_FAILURE;
   }
+  if (select_stacks && online) {
+    std::cerr << "-select_stacks needs the raw spectra, -online does not keep them" << std::endl;
+    return EXIT_FAILURE;
+  }
 
   if (!lowres && !highres) {
     std::cout << "no plot option given, use -lowres or -highres" << std::endl;
@@ -340,28 +388,7 @@ int main(int argc, char *argv[]) {
       std::cout << "use sample rates of " << f_or_s << " " << unit << std::endl;
     }
   }
-  size_t thread_index = 0;
-  for (const auto &irun : run_numbers) {
-    for (const auto &schan : channel_types) {
-      try {
-        std::cout << "push thread " << thread_index++ << std::endl;
-        // the read_all_fftw pushes the fftw slices into a queue inside the channel object
-        // pool->push_task(&channel::read_all_fftw, station->at(irun, schan), false, nullptr); // each channel is read in parallel
-        pool->detach_task([irun, schan, &station]() { station->at(irun, schan)->read_all_fftw(false, nullptr); });
-      }
-
-      catch (const std::runtime_error &error) {
-        std::cerr << error.what() << std::endl;
-        std::cerr << "could not execute fftw" << std::endl;
-        return EXIT_FAILURE;
-      } catch (...) {
-        std::cerr << "could not execute fftw" << std::endl;
-        return EXIT_FAILURE;
-      }
-    }
-  }
-  pool->wait(); // wait for all tasks to finish, read time series and perform fftw
-
+  // the frequency range and the calibration do not depend on the data; set them BEFORE reading, so that each run can be processed on its own
   inner_outer<double> innerouter; // inner and outer range for the resulting spectra, we do not want all frequencies
   for (const auto &irun : run_numbers) {
     for (const auto &schan : channel_types) {
@@ -404,50 +431,21 @@ int main(int argc, char *argv[]) {
             chan->cal->join_lower_theo_and_measured_interpolated();
           }
         }
-        // all spectra a still in a queue, we have to fetch them into a vector of vectors
-        // push task can not use default arguments, supply all arguments
-        // the prepare_raw_spc pushes the raw spectra queue into a vector spc inside the channel object
-        // calibration is done if !no_cal_plot -> so cal_plot is done; true at end means that the fft window calibration is on additionally
-        // pool->push_task(&channel::prepare_raw_spc, chan, !no_cal_plot, true);
-
-        // do not use &chan here, because the channel pointer is not valid in the lambda function while the main loop is calling the next channel!
-        pool->detach_task([chan, no_cal_plot]() { chan->prepare_raw_spc(!no_cal_plot, true); });
-        // after this we have the spc vector of vectors in the channel object
       }
 
       catch (const std::runtime_error &error) {
         std::cerr << error.what() << std::endl;
-        std::cerr << "could not prepare_raw_spc" << std::endl;
+        std::cerr << "could not set frequency range and calibration" << std::endl;
         return EXIT_FAILURE;
       } catch (...) {
-        std::cerr << "could not prepare_raw_spc" << std::endl;
+        std::cerr << "could not set frequency range and calibration" << std::endl;
         return EXIT_FAILURE;
       }
     }
   }
-  pool->wait(); // wait for all tasks to finish
-
-  for (auto &run : runs) {
-    run->fetch_raw_spectra(); // fetch the raw spectra from the thread pool; move operation (fast); also initializes the ac_spectra!
-    // raw spectra also contains the channel pointer and therewith the channel name and FFT properties
-  }
-  pool->wait(); // wait for all tasks to finish
-  // ******************************** F I N I S H E D  R E A D I N G  D A T A *********************************************************************
-  // ******************************** F I N I S H E D  S I N G L E  S P E C T R A *********************************************************************
-
-  // for (auto &run : runs) {
-  //   run->init_ac_spectra(pool); // init the ac_spectra for all channels
-  //   for (auto &cross : cross_spectra_names) {
-  //     run->ac_spc->add_spectra(cross["first"], cross["second"], run->raw_spc->get_raw_spectra(cross["first"]), run->raw_spc->get_raw_spectra(cross["second"]));
-  //   }
-  // }
-
-  // the data has been transformed into the raw_spectra
-  // the run->raw_spc contains the raw spectra Ex, Ey, Ez, Hx, Hy, Hz or what was given
-  // in this SW we want to calculate the STACKED auto- and cross-spectra
-  // we want not to store HxHx ... HxHz as full data, but only the stacked spectra inside the raw_spectra object as sa and sa_prz
 
   // create the necessary auto and cross spectra; each run has its own raw_spectra object
+  // we want not to store HxHx ... HxHz as full data, but only the stacked spectra inside the raw_spectra object as sa and sa_prz
   for (auto &run : runs) {
     std::cout << "setting auto- and cross- spectra ";
     for (auto &ac : auto_cross_spectra_names) {
@@ -457,19 +455,133 @@ int main(int argc, char *argv[]) {
     }
     std::cout << std::endl;
   }
-  std::cout << "stacking" << std::endl;
-  thread_index = 0;
-  for (auto &run : runs) {
-    // run raw spectra fires up all channels; USE wait_for_tasks() after this
-    run->raw_spc->advanced_stack_all(median_limit); // stack all auto and cross spectra
+
+  std::vector<double> target_freqs; // target frequencies from SQL table, for parzening
+  if (lowres) {
+    // start to set the targe frequencies and create the parzen vectors
+    std::string sql_query = "SELECT * FROM default_mt_frequencies"; // ORDER by will not work - it is TEXT
+    auto sql_info = std::make_unique<sqlite_handler>(sqlfile);
+
+    try {
+      target_freqs = sql_info->sqlite_vector_double(sql_query);
+      std::sort(target_freqs.begin(), target_freqs.end());
+    } catch (const std::runtime_error &error) {
+      std::cerr << error.what() << std::endl;
+      std::cerr << "could not read default_mt_frequencies" << std::endl;
+      return EXIT_FAILURE;
+    } catch (...) {
+      std::cerr << "could not read default_mt_frequencies" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // if the vector contains value 15, remove 15.0000
+    auto it = std::find(target_freqs.begin(), target_freqs.end(), 15.0);
+    if (it != target_freqs.end()) {
+      target_freqs.erase(it);
+    }
+  }
+
+  // ******************************** memory budget ******************************************************************************
+  // choose for each run: raw spectra in memory, spilled to a memory mapped file or stacked online
+  memory_budget mem_budget(mem_budget_mb * 1024 * 1024, spill_dir);
+  std::vector<run_memory_estimate> mem_plan;
+  std::vector<std::string> run_names;
+  for (const auto &run : runs) {
+    mem_plan.emplace_back(run->memory_estimate(auto_cross_spectra_names.size()));
+    run_names.emplace_back(run->get_name());
+  }
+  mem_budget.plan(mem_plan, median_limit);
+  if (online) {
+    for (auto &mp : mem_plan) {
+      mp.mode = spc_mode::online;
+      mp.planned = mp.online;
+    }
   }
-  pool->wait(); // wait for all tasks to finish
-  std::cout << "done" << std::endl;
+  mem_budget.report(mem_plan, run_names);
+  if (select_stacks) {
+    for (size_t i = 0; i < mem_plan.size(); ++i) {
+      if (mem_plan[i].mode != spc_mode::in_memory) {
+        std::cerr << "-select_stacks needs the raw spectra in memory, " << run_names[i] << " does not fit into -mem_budget" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  // ******************************** task graph *********************************************************************************
+  // each run goes through its own stages: read (channel) -> prepare_raw_spc (channel) -> fetch -> stack (auto / cross) -> scale -> parzen
+  // a stage starts as soon as its inputs of the SAME run are ready; there is no barrier between the runs
+  // online and spill: read, prepare, fetch and stack are one task per run
+
   // double sd = 1.0 / (1000.0 * 1000.0 * std::sqrt(2));
-  double sd = 1.0 / (1000.0 * 1000.0);
-  for (auto &run : runs) {
-    run->raw_spc->multiply_sa_spectra(sd); // parzen stack all auto and cross spectra
+  const double sd = 1.0 / (1000.0 * 1000.0);
+  task_dag dag(pool);
+  try {
+    size_t irp = 0;
+    for (auto &run : runs) {
+      std::vector<size_t> stacked;
+      const spc_mode mode = mem_plan.at(irp++).mode;
+      if (mode == spc_mode::online) {
+        stacked.push_back(dag.add([run, median_limit, no_cal_plot]() { run->stack_online(median_limit, !no_cal_plot, true); }, {}, run->get_name() + " stack online"));
+      } else if (mode == spc_mode::spill) {
+        auto sdir = mem_budget.get_spill_dir();
+        stacked.push_back(dag.add([run, median_limit, no_cal_plot, sdir]() { run->stack_spilled(median_limit, sdir, !no_cal_plot, true); }, {}, run->get_name() + " stack spilled"));
+      } else {
+        std::vector<size_t> prepared;
+        for (const auto &schan : channel_types) {
+          auto chan = run->get_channel(schan);
+          // the read_all_fftw pushes the fftw slices into a queue inside the channel object
+          auto read = dag.add([chan]() { chan->read_all_fftw(false, nullptr); }, {}, run->get_name() + " read " + schan);
+          // the prepare_raw_spc pushes the raw spectra queue into a vector spc inside the channel object
+          // calibration is done if !no_cal_plot -> so cal_plot is done; true at end means that the fft window calibration is on additionally
+          prepared.push_back(dag.add([chan, no_cal_plot]() { chan->prepare_raw_spc(!no_cal_plot, true); }, {read}, run->get_name() + " prepare " + schan));
+        }
+        // move operation (fast); raw spectra also contains the channel pointer and therewith the channel name and FFT properties
+        auto fetched = dag.add([run]() { run->fetch_raw_spectra(); }, prepared, run->get_name() + " fetch");
+        if (select_stacks) {
+          fetched = dag.add([run, sel_bands, sel_min_coh, sel_max_dev]() {
+            auto rejected = run->raw_spc->select_stacks(sel_bands, sel_min_coh, sel_max_dev);
+            std::ostringstream msg;
+            msg << run->get_name() << " select stacks: " << rejected << " rejected";
+            if (run->raw_spc->empty_stack_bands())
+              msg << ", " << run->raw_spc->empty_stack_bands() << " bands without stacks, stacked with all";
+            std::cout << msg.str() << std::endl; }, {fetched}, run->get_name() + " select stacks");
+        }
+        for (const auto &ac : auto_cross_spectra_names) {
+          stacked.push_back(dag.add([run, ac, median_limit]() { run->raw_spc->advanced_stack(ac, median_limit); }, {fetched}, run->get_name() + " stack " + ac.first + ac.second));
+        }
+      }
+      const bool free_raw = (mem_budget.get_budget() > 0); // with a budget the raw spectra are not needed after stacking
+      auto scaled = dag.add([run, sd, free_raw]() {
+        if (free_raw)
+          run->raw_spc->clear();
+        run->raw_spc->multiply_sa_spectra(sd); }, stacked, run->get_name() + " scale");
+      if (lowres) {
+        // for each run has a raw_spc object with same pazendists vector
+        auto parzen = [run, &target_freqs]() {
+          run->raw_spc->fft_freqs->set_target_freqs(target_freqs, 0.15);
+          run->raw_spc->fft_freqs->create_parzen_vectors();
+          run->raw_spc->parzen_stack_all();
+        };
+        dag.add(parzen, {scaled}, run->get_name() + " parzen");
+      }
+    }
+    std::cout << "processing " << dag.size() << " tasks on " << pool->get_thread_count() << " threads" << std::endl;
+    dag.wait();
+  } catch (const std::exception &e) {
+    std::cerr << dag.failed_task() << " " << e.what() << std::endl;
+    std::cerr << "could not process all runs" << std::endl;
+    return EXIT_FAILURE;
   }
+  std::cout << "done, peak memory " << memory_budget::to_mb(memory_budget::peak_rss()) << " MB" << std::endl;
+  if (!profile_file.empty()) {
+    mtprof::summary(std::cout);
+    if (mtprof::write_chrome_trace(profile_file))
+      std::cout << "trace written to " << profile_file.string() << " (chrome://tracing or ui.perfetto.dev)" << std::endl;
+    else
+      std::cerr << "could not write " << profile_file.string() << std::endl;
+  }
+  // ******************************** F I N I S H E D  R E A D I N G  D A T A *********************************************************************
+  // ******************************** F I N I S H E D  S I N G L E  S P E C T R A *********************************************************************
 
   size_t i;
   std::string init_err;
@@ -533,6 +645,8 @@ int main(int argc, char *argv[]) {
       std::cout << init_err << std::endl;
       return EXIT_FAILURE;
     }
+    if (gplt_file)
+      gplt->set_data_file();
 
     gplt->cmd << "set terminal qt size 2048,768 enhanced" << std::endl;
     gplt->cmd << "set title '" << all_coils_title << "'" << std::endl;
@@ -657,66 +771,7 @@ int main(int argc, char *argv[]) {
   if (lowres) {
     std::cout << "parzening" << std::endl;
 
-    // start to set the targe frequencies and create the parzen vectors
-    std::string sql_query = "SELECT * FROM default_mt_frequencies"; // ORDER by will not work - it is TEXT
-    std::vector<double> target_freqs;                               // target frequencies from SQL table
-    auto sql_info = std::make_unique<sqlite_handler>(sqlfile);
-
-    try {
-      target_freqs = sql_info->sqlite_vector_double(sql_query);
-      std::sort(target_freqs.begin(), target_freqs.end());
-    } catch (const std::runtime_error &error) {
-      std::cerr << error.what() << std::endl;
-      std::cerr << "could not read default_mt_frequencies" << std::endl;
-      return EXIT_FAILURE;
-    } catch (...) {
-      std::cerr << "could not read default_mt_frequencies" << std::endl;
-      return EXIT_FAILURE;
-    }
-
-    // if the vector contains value 15, remove 15.0000
-    auto it = std::find(target_freqs.begin(), target_freqs.end(), 15.0);
-    if (it != target_freqs.end()) {
-      target_freqs.erase(it);
-    }
-
-    try {
-      for (auto &irun : run_numbers) { // for each run has a raw_spc object with same pazendists vector
-        // for (auto &ac : auto_cross_spectra_names) {
-        station->get_run(irun)->raw_spc->fft_freqs->set_target_freqs(target_freqs, 0.15);
-        // fft_freq->set_target_freqs(target_freqs, 0.15);
-        // pool->push_task(&fftw_freqs::create_parzen_vectors, station->get_run(irun)->raw_spc->fft_freqs);
-        pool->detach_task([irun, &station]() { station->get_run(irun)->raw_spc->fft_freqs->create_parzen_vectors(); });
-        // }
-      }
-
-    } catch (const std::runtime_error &error) {
-      std::cerr << error.what() << std::endl;
-      return EXIT_FAILURE;
-    } catch (const std::exception &e) {
-      std::cerr << "error: " << e.what() << std::endl;
-      return EXIT_FAILURE;
-    } catch (...) {
-      std::cerr << "could not allocate all channels" << std::endl;
-      return EXIT_FAILURE;
-    }
-    pool->wait(); // always wait for tasks for parzening
-
-    try {
-      for (auto &run : runs) {
-        run->raw_spc->parzen_stack_all(); // start the thread pool for parzening
-      }
-    } catch (const std::runtime_error &error) {
-      std::cerr << error.what() << std::endl;
-      return EXIT_FAILURE;
-    } catch (const std::exception &e) {
-      std::cerr << "error: " << e.what() << std::endl;
-      return EXIT_FAILURE;
-    } catch (...) {
-      std::cerr << "could not allocate all channels" << std::endl;
-      return EXIT_FAILURE;
-    }
-    pool->wait(); // always wait for tasks
+    // the parzen spectra have been created in the task graph
 
     auto merge_spc = std::make_shared<merge_spectra<double>>();
 
@@ -752,6 +807,8 @@ int main(int argc, char *argv[]) {
       std::cout << init_err << std::endl;
       return EXIT_FAILURE;
     }
+    if (gplt_file)
+      gplt_prz->set_data_file();
 
     gplt_prz->cmd << "set terminal qt size 2048,768 enhanced" << std::endl;
     // gplt_prz->cmd << "set title 'FFT Parzen'" << std::endl;
@@ -852,6 +909,8 @@ int main(int argc, char *argv[]) {
   if (!no_cal_plot) {
     init_err.clear();
     auto gplt_cal_a = std::make_shared<gnuplotter<double, double>>(init_err);
+    if (gplt_file)
+      gplt_cal_a->set_data_file();
     gplt_cal_a->cmd << "set terminal qt size 1024,768 enhanced" << std::endl;
     gplt_cal_a->cmd << "set title 'Calibration'" << std::endl;
     gplt_cal_a->cmd << "set xlabel 'frequency [Hz]'" << std::endl;
@@ -907,6 +966,8 @@ int main(int argc, char *argv[]) {
 
     init_err.clear();
     auto gplt_cal_p = std::make_shared<gnuplotter<double, double>>(init_err);
+    if (gplt_file)
+      gplt_cal_p->set_data_file();
     gplt_cal_p->cmd << "set terminal qt size 1024,768 enhanced" << std::endl;
     gplt_cal_p->cmd << "set title 'Calibration'" << std::endl;
     gplt_cal_p->cmd << "set xlabel 'frequency [Hz]'" << std::endl;
@@ -14,7 +14,7 @@
 
 #include "gnuplotter.h"
 #include "raw_spectra.h"
-#include <random>
+#include "ts_generator.h"
 
 int main(int argc, char *argv[]) {
 
@@ -105,28 +105,15 @@ int main(int argc, char *argv[]) {
       return EXIT_FAILURE;
     }
 
-    std::random_device rd{};
-    std::mt19937 gen{rd()};
-    std::normal_distribution<> dist{0, 2};
     std::vector<double> noise_data(wl * max_fact * 12); // stacks "for fun"
     double sin_freq = 50;
     double sin_freq2 = 50.5;
 
-    double sn = 0;
-
-    if (loop == 0) {
-      for (auto &nd : noise_data) {
-        nd = dist(gen) / 5. + (sin(sin_freq * (2 * M_PI) * sn / sample_freq));
-        sn++;
-      }
-    }
-
-    else {
-      for (auto &nd : noise_data) {
-        nd = dist(gen) / 5. + (sin(sin_freq * (2 * M_PI) * sn / sample_freq)) + (sin(sin_freq2 * (2 * M_PI) * sn / sample_freq));
-        sn++;
-      }
-    }
+    // noise mean 0, sigma 2 / 5; same noise for both loops
+    tsgen::fill_normal(noise_data, 0.0, 2.0 / 5., 1, pool);
+    tsgen::add_sine(noise_data, sin_freq, sample_freq, 1.0, 0.0, pool);
+    if (loop != 0)
+      tsgen::add_sine(noise_data, sin_freq2, sample_freq, 1.0, 0.0, pool);
 
     // **** here I do the FFT
     for (auto &chan : channels) {
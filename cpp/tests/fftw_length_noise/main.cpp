@@ -14,7 +14,7 @@
 
 #include "gnuplotter.h"
 #include "raw_spectra.h"
-#include <random>
+#include "ts_generator.h"
 
 int main() {
 
@@ -79,20 +79,14 @@ int main() {
     chan->init_fftw(fft_fres);
   }
 
-  std::random_device rd{};
-  std::mt19937 gen{rd()};
-  std::normal_distribution<> dist{5, 2};
   std::vector<double> noise_data(16385 * 512);
   double sin_freq = 60;
-  double sn = 0;
 
-  //        for (auto &nd : noise_data) {
-  //            nd = dist(gen) + (sin(sin_freq * (2 * M_PI) * sn++ / sample_freq)) / 10.0;
-  //        }
+  // noise with mean 5, sigma 2 and a sine of 1/10:
+  // tsgen::fill_normal(noise_data, 5.0, 2.0, 1);
+  // tsgen::add_sine(noise_data, sin_freq, sample_freq, 1.0 / 10.0);
 
-  for (auto &nd : noise_data) {
-    nd = (sin(sin_freq * (2 * M_PI) * sn++ / sample_freq));
-  }
+  tsgen::add_sine(noise_data, sin_freq, sample_freq);
 
   // **** here I do the FFT
   for (auto &chan : channels) {
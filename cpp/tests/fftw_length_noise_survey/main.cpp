@@ -14,7 +14,6 @@
 
 #include "mini_math.h"
 #include "raw_spectra.h"
-#include <random>
 
 namespace fs = std::filesystem;
 
@@ -147,10 +146,6 @@ int main(int argc, char *argv[]) {
   size_t wl = 0;
   size_t padded = 1024; // min padded
 
-  std::random_device rd{};
-  std::mt19937 gen{rd()};
-  std::normal_distribution<> dist{0, 2}; // mean 0, sigma 2
-
   for (auto &run : runs) {
 
     // shared pointer from survey
@@ -17,7 +17,7 @@
 #include "atss_to_ats.h"
 #include "gnuplotter.h"
 #include "raw_spectra.h"
-#include <random>
+#include "ts_generator.h"
 
 // #include "BS_thread_pool.h"
 
@@ -80,14 +80,9 @@ int main(int argc, char *argv[]) {
   std::vector<double> base_noise_data(dat_sz); // the base noise data for all channels
   auto pool = std::make_shared<BS::thread_pool>();
 
-  // I add 1% noise floor
-  std::random_device rd{};
-  std::mt19937 gen{rd()};
-  std::normal_distribution<> dist{0, 2}; // mean 0, sigma 2
-
+  // I add 1% noise floor: mean 0, sigma 2 / 100
   // create the base noise data without the sine ***************************************************************************************************
-  for (auto &v : base_noise_data)
-    v = dist(gen) / 100.;
+  tsgen::fill_normal(base_noise_data, 0.0, 2.0 / 100., 1, pool);
 
   // add the 3 different sine frequencies to the data
   std::vector<double> sin_freqs(num_stations);
@@ -95,7 +90,7 @@ int main(int argc, char *argv[]) {
   sin_freqs[1] = 256;
   sin_freqs[2] = 180;
   sin_freqs[3] = 64;
-  double sn;
+  size_t sn;
   i = 0;
   // same noise all channels
   for (auto &snr : station_names_runs) {
@@ -109,10 +104,9 @@ int main(int argc, char *argv[]) {
     sn = 0;
 
     for (auto &chan : channels) {
-      if (i) {                                                           // no sine for the first station
-        for (auto &v : chan->ts_slice) {                                 // same sine for all channels of same station
-          v += (sin(sin_freqs.at(i) * (2 * M_PI) * sn++ / sample_rate)); // add the sine to the noise
-        }
+      if (i) { // no sine for the first station; same sine for all channels of same station
+        tsgen::add_sine(chan->ts_slice.data(), chan->ts_slice.size(), sin_freqs.at(i), sample_rate, 1.0, 0.0, sn);
+        sn += chan->ts_slice.size();
       }
       chan->write_header(); // write the header
       chan->write_slice();  // write the slice, survey is not written
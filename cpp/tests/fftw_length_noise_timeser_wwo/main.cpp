@@ -14,7 +14,7 @@
 
 #include "gnuplotter.h"
 #include "raw_spectra.h"
-#include <random>
+#include "ts_generator.h"
 
 // #include "BS_thread_pool.h"
 
@@ -76,14 +76,8 @@ int main(int argc, char *argv[]) {
 
   auto pool = std::make_shared<BS::thread_pool>();
 
-  // I add 1% noise floor
-  std::random_device rd{};
-  std::mt19937 gen{rd()};
-  std::normal_distribution<> dist{0, 2}; // mean 0, sigma 2
-  i = 0;
-
-  for (auto &v : base_noise_data)
-    v = dist(gen) / 100.;
+  // I add 1% noise floor: mean 0, sigma 2 / 100
+  tsgen::fill_normal(base_noise_data, 0.0, 2.0 / 100., 1, pool);
 
   // same noise all channels
   for (auto &nd : noise_data) {
@@ -96,19 +90,14 @@ int main(int argc, char *argv[]) {
   sin_freqs[2] = 64;
 
   // add the sine to the data
-  double sn = 0;
   i = 0;
   for (auto &nd : noise_data) {
-    sn = 0;
-    for (auto &v : nd)
-      v += (sin(sin_freqs.at(i) * (2 * M_PI) * sn++ / sample_freq));
+    tsgen::add_sine(nd, sin_freqs.at(i), sample_freq, 1.0, 0.0, pool);
     ++i;
   }
 
   // add a single sine for spectra later
-  sn = 0;
-  for (auto &v : base_noise_data)
-    v += (sin(sin_freqs.at(1) * (2 * M_PI) * sn++ / sample_freq));
+  tsgen::add_sine(base_noise_data, sin_freqs.at(1), sample_freq, 1.0, 0.0, pool);
 
   const size_t ts_beg = 0, ts_end(sin_freqs.at(0) / 4);
   std::vector<double> xax(ts_end - ts_beg);
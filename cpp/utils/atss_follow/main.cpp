@@ -0,0 +1,128 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "atss.h"
+#include "atss_follow.h"
+
+// follows a growing atss file (observatory, rsync / WebDAV streaming) and dumps the running stacked spectra
+// ./atss_follow -wl 1024 -ovl 50 -every 64 -idle 600 /survey/obs/stations/obs_1/run_001/084_ADU-08e_C02_THx_128Hz.json
+
+namespace fs = std::filesystem;
+
+static std::atomic<bool> stop_follow(false);
+
+static void handle_signal(int) {
+  stop_follow = true;
+}
+
+static void dump_spectra(const fs::path &outfile, const std::vector<double> &f, const std::vector<double> &v, const size_t &stacks) {
+  // write to a tmp file and rename - a plotting process never sees a half written file
+  fs::path tmp(outfile);
+  tmp += ".tmp";
+  std::ofstream out(tmp);
+  if (!out) {
+    std::ostringstream err_str(__func__, std::ios_base::ate);
+    err_str << "::cannot open file " << tmp;
+    throw std::runtime_error(err_str.str());
+  }
+  out << "# stacks " << stacks << std::endl;
+  for (size_t i = 0; i < f.size() && i < v.size(); ++i) {
+    out << f[i] << " " << v[i] << std::endl;
+  }
+  out.close();
+  fs::rename(tmp, outfile);
+}
+
+int main(int argc, char *argv[]) {
+
+  size_t wl = 1024;
+  double overlap = 0.0; // percent
+  size_t every = 64;    // dump after n new windows
+  size_t idle = 0;      // seconds without data before we stop; 0 is for ever
+  fs::path outdir;
+  fs::path infile;
+
+  unsigned l = 1;
+  try {
+    while (argc > 1 && (l < unsigned(argc)) && *argv[l] == '-') {
+      std::string marg(argv[l]);
+      if (marg.compare("-wl") == 0) {
+        wl = std::stoul(std::string(argv[++l]));
+      } else if (marg.compare("-ovl") == 0) {
+        overlap = std::stod(std::string(argv[++l]));
+      } else if (marg.compare("-every") == 0) {
+        every = std::stoul(std::string(argv[++l]));
+      } else if (marg.compare("-idle") == 0) {
+        idle = std::stoul(std::string(argv[++l]));
+      } else if (marg.compare("-outdir") == 0) {
+        outdir = fs::path(std::string(argv[++l]));
+      } else {
+        std::cerr << "\nunrecognized option " << argv[l] << std::endl;
+        return EXIT_FAILURE;
+      }
+      ++l;
+    }
+    if (l < unsigned(argc))
+      infile = fs::path(std::string(argv[l]));
+  } catch (const std::invalid_argument &ia) {
+    std::cerr << ia.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (infile.empty()) {
+    std::cout << "usage: " << argv[0] << " -wl 1024 -ovl 50 -every 64 -idle 600 -outdir /tmp channel.json" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if ((overlap < 0.0) || (overlap >= 100.0)) {
+    std::cerr << "overlap must be between 0 and < 100 %" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!every)
+    every = 1;
+
+  std::signal(SIGINT, handle_signal);
+  std::signal(SIGTERM, handle_signal);
+
+  try {
+    auto chan = std::make_shared<channel>(infile);
+    chan->init_fftw(nullptr, false, wl, wl);
+    size_t hop = wl - size_t(double(wl) * overlap / 100.0);
+    atss_follow follower(chan, hop, false, true);
+    auto f = chan->fft_freqs->get_frequencies();
+
+    if (outdir.empty())
+      outdir = chan->get_run_dir();
+    fs::path outfile = outdir / (chan->get_filepath_wo_ext().filename().string() + "_follow.dat");
+
+    std::cout << "following " << chan->get_atss_filepath() << (follower.uses_inotify() ? " (inotify)" : " (polling)") << std::endl;
+    std::cout << "dumping to " << outfile << " every " << every << " windows" << std::endl;
+
+    size_t since_dump = 0;
+    auto on_window = [&](const std::vector<std::complex<double>> &spc) {
+      if (++since_dump >= every) {
+        dump_spectra(outfile, f, follower.get_abs_stacked_spectra(), follower.get_stacks());
+        since_dump = 0;
+      }
+    };
+    follower.follow(on_window, stop_follow, std::chrono::milliseconds(500), std::chrono::milliseconds(idle * 1000));
+    if (follower.get_stacks())
+      dump_spectra(outfile, f, follower.get_abs_stacked_spectra(), follower.get_stacks());
+    std::cout << "stacks: " << follower.get_stacks() << ", last sample: " << follower.get_next_pos() << std::endl;
+
+  } catch (const std::runtime_error &error) {
+    std::cerr << error.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (const std::exception &e) {
+    std::cerr << "error: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
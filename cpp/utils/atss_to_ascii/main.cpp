@@ -5,21 +5,34 @@
 
 int main(int argc, char *argv[]) {
   std::vector<std::shared_ptr<channel>> channels;
+  int precision = 6;
+  std::filesystem::path outdir;
   // Check if the channel argument is provided
   if (argc < 2) {
-    std::cout << "Usage: " << argv[0] << " file" << std::endl;
+    std::cout << "Usage: " << argv[0] << " [-precision 6 (0 = exact) -outdir dir] file" << std::endl;
     return 1;
-  } else {
-    for (int i = 1; i < argc; i++) {
-      std::string filename(argv[i]);
-      channels.push_back(std::make_shared<channel>(filename));
+  }
+  int l = 1;
+  while (argc > 1 && (l < argc) && *argv[l] == '-') {
+    std::string marg(argv[l]);
+    if (marg.compare("-precision") == 0) {
+      precision = std::stoi(argv[++l]);
+    }
+    if (marg.compare("-outdir") == 0) {
+      outdir = std::string(argv[++l]);
     }
+    ++l;
+  }
+  for (int i = l; i < argc; i++) {
+    std::string filename(argv[i]);
+    channels.push_back(std::make_shared<channel>(filename));
   }
 
+  auto pool = std::make_shared<BS::thread_pool>();
   for (auto &ch : channels) {
     std::cout << "writing ascii file for " << ch->filename() << "\n";
-    ch->to_ascii();
+    ch->to_ascii(outdir, pool, precision);
   }
 
   return 0;
-}
\ No newline at end of file
+}
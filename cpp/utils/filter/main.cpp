@@ -14,7 +14,7 @@
 #include <thread>
 #include <vector>
 
-#include <random>
+#include "ts_generator.h"
 
 int main() {
 
@@ -75,17 +75,14 @@ int main() {
   std::string unit;
   // mstr::sample_rate_to_str(chan->get_sample_rate(), f_or_s, unit);
 
-  std::random_device rd{};
-  std::mt19937 gen{rd()};
-  std::normal_distribution<> dist{5, 2};
   size_t nstacks = 32;
   size_t min_size = nstacks * sample_freq;
   std::vector<double> noise_data(size_t(max_freq) * nstacks); // at least 64 stacks
   double sin_freq = sample_freq / 4.;
-  double sn = 0;
-  // sin(sin_freq * (2 * pi) * i / sample_freq);
-  for (auto &nd : noise_data) {
-    nd = dist(gen) + (sin(sin_freq * (2 * M_PI) * sn++ / sample_freq)) / 8.0;
+  {
+    auto gen_pool = std::make_shared<BS::thread_pool>();
+    tsgen::fill_normal(noise_data, 5.0, 2.0, 1, gen_pool);
+    tsgen::add_sine(noise_data, sin_freq, sample_freq, 1.0 / 8.0, 0.0, gen_pool);
   }
 
   // ****************** loop for frequencies
@@ -14,7 +14,7 @@
 #include <vector>
 
 #include "raw_spectra.h"
-#include <random>
+#include "ts_generator.h"
 
 int main() {
 
@@ -77,20 +77,17 @@ int main() {
   std::string unit;
   // mstr::sample_rate_to_str(chan->get_sample_rate(), f_or_s, unit);
 
-  std::random_device rd{};
-  std::mt19937 gen{rd()};
-  std::normal_distribution<> dist{5, 2};
   size_t nstacks = 32;
   size_t min_size = nstacks * 1024;
   std::vector<double> noise_data(size_t(max_freq) * nstacks); // at least n stacks
   double sin_freq = sample_freq / 4.;
   double sin_freq2 = sample_freq / 16.;
-  double sn = 0;
-  // sin(sin_freq * (2 * pi) * i / sample_freq);
-  for (auto &nd : noise_data) {
-    // nd = dist(gen) + (sin(sin_freq * (2 * M_PI) * sn++ / sample_freq)) / 8.0;
-    nd = dist(gen) + ((sin(sin_freq * (2 * M_PI) * sn / sample_freq)) / 8.0) + ((sin(sin_freq2 * (2 * M_PI) * sn / sample_freq)) / 8.0);
-    ++sn;
+  // gaussian noise mean 5, sigma 2 plus two sines; the noise key makes the data set reproducible
+  {
+    auto gen_pool = std::make_shared<BS::thread_pool>();
+    tsgen::fill_normal(noise_data, 5.0, 2.0, 1, gen_pool);
+    tsgen::add_sine(noise_data, sin_freq, sample_freq, 1.0 / 8.0, 0.0, gen_pool);
+    tsgen::add_sine(noise_data, sin_freq2, sample_freq, 1.0 / 8.0, 0.0, gen_pool);
   }
 
   // ****************** loop for sample frequencies range
@@ -207,11 +204,12 @@ int main() {
     // for the new file fomat
     i = 0;
     std::filesystem::path last_run_created;
+    atss_header_writer header_writer; // headers are written in the background while we create the next runs
     for (auto &chan : channels) {
       // if (i) last_run_created = survey->add_create_run(last_station, chan);
       // will be added to the same run if same sample rate and different channel number
       survey->add_create_run(last_station, chan);
-      chan->write_header(); // we have added a calibration already, no external CAL here
+      chan->write_header(header_writer); // we have added a calibration already, no external CAL here
       // chan->write_all_data(noise_data);
       ++i;
     }
@@ -223,11 +221,15 @@ int main() {
         pool->detach_task([&chan, &noise_data_sub]() { chan->write_all_data(noise_data_sub); });
       }
       pool->wait();
+      header_writer.flush();
     } catch (const std::string &error) {
       std::cerr << error << std::endl;
       return EXIT_FAILURE;
     } catch (std::filesystem::filesystem_error &e) {
       std::cerr << e.what() << std::endl;
+    } catch (const std::runtime_error &error) {
+      std::cerr << error.what() << std::endl;
+      return EXIT_FAILURE;
     } catch (...) {
       std::cerr << "could not execute all threads" << std::endl;
       return EXIT_FAILURE;
@@ -0,0 +1,108 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "BS_thread_pool.h"
+#include "mth5.h"
+#include "survey.h"
+
+int main(int argc, char *argv[]) {
+
+  mth5_options opts;
+  std::filesystem::path survey_dir;
+  std::filesystem::path h5file;
+  bool do_export = false;
+  bool do_import = false;
+  bool list = false;
+  size_t threads = 0;
+
+  int l = 1;
+  while (argc > 1 && (l < argc) && *argv[l] == '-') {
+    std::string marg(argv[l]);
+    if (marg.compare("-export") == 0) {
+      do_export = true;
+    }
+    if (marg.compare("-import") == 0) {
+      do_import = true;
+    }
+    if (marg.compare("-ls") == 0) {
+      list = true;
+    }
+    if (marg.compare("-chunk") == 0) {
+      opts.chunk = size_t(std::stoul(argv[++l]));
+    }
+    if (marg.compare("-deflate") == 0) {
+      opts.deflate = unsigned(std::stoul(argv[++l]));
+    }
+    if (marg.compare("-noshuffle") == 0) {
+      opts.shuffle = false;
+    }
+    if (marg.compare("-threads") == 0) {
+      threads = size_t(std::stoul(argv[++l]));
+    }
+    if ((marg.compare("-") == 0) || (marg.compare("--help") == 0)) {
+      std::cout << "mth5tool -export [-chunk 65536 -deflate 4 -noshuffle -threads n] survey_dir file.h5" << std::endl;
+      std::cout << "mth5tool -import file.h5 new_survey_dir" << std::endl;
+      std::cout << "mth5tool -ls file.h5" << std::endl;
+      return EXIT_SUCCESS;
+    }
+    ++l;
+  }
+
+  if (do_export && (argc > l + 1)) {
+    survey_dir = argv[l];
+    h5file = argv[l + 1];
+  } else if (do_import && (argc > l + 1)) {
+    h5file = argv[l];
+    survey_dir = argv[l + 1];
+  } else if (list && (argc > l)) {
+    h5file = argv[l];
+  } else {
+    std::cerr << "need -export survey_dir file.h5 or -import file.h5 survey_dir or -ls file.h5; - for help" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  try {
+    if (do_export) {
+      auto survey = std::make_shared<survey_d>(survey_dir);
+      std::shared_ptr<BS::thread_pool> pool;
+      if (threads)
+        pool = std::make_shared<BS::thread_pool>(threads);
+      else
+        pool = std::make_shared<BS::thread_pool>();
+      mth5_writer writer(h5file, opts);
+      const size_t samples = writer.write_survey(survey, pool);
+      std::cout << "exported " << samples << " samples to " << h5file << ", " << std::filesystem::file_size(h5file) << " bytes" << std::endl;
+    }
+    if (do_import) {
+      mth5_reader reader(h5file, opts);
+      const size_t n_chan = reader.to_survey(survey_dir);
+      std::cout << "imported " << n_chan << " channels to " << survey_dir << std::endl;
+    }
+    if (list) {
+      mth5_reader reader(h5file, opts);
+      for (const auto &station : reader.get_station_names()) {
+        std::cout << station << std::endl;
+        for (const auto &run : reader.get_run_names(station)) {
+          std::cout << "    " << run << std::endl;
+          for (const auto &chan : reader.get_channels(station, run)) {
+            std::cout << "        " << chan->filename() << " " << chan->start_datetime() << " " << chan->pt.samples << " samples" << std::endl;
+          }
+        }
+      }
+    }
+  } catch (const std::runtime_error &error) {
+    std::cerr << error.what() << std::endl;
+    return EXIT_FAILURE;
+  } catch (const std::exception &error) {
+    std::cerr << error.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  auto stop = std::chrono::steady_clock::now();
+  std::cout << "done in " << std::chrono::duration<double>(stop - start).count() << " s" << std::endl;
+
+  return EXIT_SUCCESS;
+}
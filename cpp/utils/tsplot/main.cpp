@@ -1,4 +1,5 @@
 #include "atss.h"
+#include "atss_overview.h"
 #include "freqs.h"
 #include "gnuplotter.h"
 #include <algorithm>
@@ -8,6 +9,7 @@
 #include <filesystem>
 #include <iostream>
 #include <memory>
+#include <numeric>
 #include <string>
 #include <vector>
 
@@ -37,7 +39,9 @@ int main(int argc, char *argv[]) {
             << std::endl;
   std::cout << "reads data from a survey (e.g. Northern Mining, Station Sarıçam" << std::endl;
   std::cout << "-u survey -s site -c [Ex, Ex, Hx, Hy, Hz] -r  1 2 ... " << std::endl;
-  std::cout << "-start 0 -use 1024" << std::endl;
+  std::cout << "-start 0 -use 1024  (-use 0 or missing: all samples from start)" << std::endl;
+  std::cout << "-pixels 2048 ... plot min / max envelope with that many points if the range is larger (overview pyramid .atsov, built on first use)" << std::endl;
+  std::cout << "-full ... plot all samples, no envelope" << std::endl;
   std::cout << "\nOR give directly files \n"
             << std::endl;
   std::cout << "file1 file2 " << std::endl;
@@ -48,6 +52,8 @@ int main(int argc, char *argv[]) {
   size_t start = 0;
   size_t use = 0;
   bool bdetrend = false;
+  size_t pixels = 2048; // screen width, the envelope has 2 points per pixel
+  bool bfull = false;   // plot every sample
   unsigned l = 1;
   try {
     get_args_single_survey(argc, argv);      // get all survey, station, run, channel arguments
@@ -64,6 +70,12 @@ int main(int argc, char *argv[]) {
       if (marg.compare("-d") == 0) {
         bdetrend = true;
       }
+      if (marg.compare("-pixels") == 0) {
+        pixels = std::stoul(argv[++l]);
+      }
+      if (marg.compare("-full") == 0) {
+        bfull = true;
+      }
       if (marg.compare("-") == 0) {
         std::cerr << "\nunrecognized option " << argv[l] << std::endl;
         return EXIT_FAILURE;
@@ -102,14 +114,34 @@ int main(int argc, char *argv[]) {
   gplt->cmd << "set ylabel 'amplitude [mV || mV/km]'" << std::endl;
   gplt->cmd << "set key font \"Hack, 10\"" << std::endl;
 
-  std::vector<double> x;
-  for (size_t i = start; i < use + start; ++i) {
-    x.push_back(double(i));
-  }
-
   for (auto &chan : channels) {
-
-    gplt->set_xy_lines(x, chan->read_single(use, start, bdetrend), chan->channel_type, 1);
+    const size_t chan_use = use ? use : (chan->samples() > start ? chan->samples() - start : 0);
+    if (bfull || !pixels || (chan_use <= 2 * pixels)) {
+      std::vector<double> x;
+      for (size_t i = start; i < chan_use + start; ++i) {
+        x.push_back(double(i));
+      }
+      gplt->set_xy_lines(x, chan->read_single(chan_use, start, bdetrend), chan->channel_type, 1);
+      continue;
+    }
+    // min / max envelope: never more points than pixels, independent of the length of the file
+    std::vector<double> x, y;
+    try {
+      atss_overview ovr(chan->get_atss_filepath());
+      if (ovr.open())
+        std::cout << "overview created " << ovr.sidecar_path() << std::endl;
+      ovr.envelope(x, y, start, chan_use, pixels);
+    } catch (const std::exception &e) {
+      std::cerr << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (bdetrend) {
+      // the envelope can not be detrended exactly; remove the offset only
+      const double offset = std::accumulate(y.begin(), y.end(), 0.0) / double(y.size());
+      for (auto &v : y)
+        v -= offset;
+    }
+    gplt->set_xy_lines(x, y, chan->channel_type + " (envelope)", 1);
   }
 
   gplt->plot();